@@ -0,0 +1,152 @@
+/**
+ *  @file
+ *  @copyright defined in eos/LICENSE
+ */
+#include <eosio/chain/access_set.hpp>
+#include <eosio/chain/config.hpp>
+#include <eosio/chain/transaction.hpp>
+
+#include <map>
+#include <numeric>
+#include <tuple>
+
+namespace eosio { namespace chain {
+
+namespace {
+
+   /// @return true if the sorted sets a and b have an element in common
+   bool intersects( const flat_set<state_key>& a, const flat_set<state_key>& b ) {
+      auto ai = a.begin();
+      auto bi = b.begin();
+      while( ai != a.end() && bi != b.end() ) {
+         if( *ai < *bi )
+            ++ai;
+         else if( *bi < *ai )
+            ++bi;
+         else
+            return true;
+      }
+      return false;
+   }
+
+}
+
+bool access_set::conflicts_with( const access_set& other )const {
+   return serial || other.serial
+          || intersects( writes, other.writes )
+          || intersects( writes, other.reads )
+          || intersects( reads, other.writes );
+}
+
+vector<uint32_t> schedule_waves( const vector<access_set>& transactions ) {
+   vector<uint32_t> waves;
+   waves.reserve( transactions.size() );
+
+   // per key, one past the last wave that wrote or read it
+   std::map<state_key, uint32_t> after_write;
+   std::map<state_key, uint32_t> after_read;
+   uint32_t after_serial = 0; ///< one past the wave of the last serial transaction
+   uint32_t after_all    = 0; ///< one past the last wave used
+
+   auto after = []( const std::map<state_key, uint32_t>& m, const state_key& k ) {
+      auto itr = m.find( k );
+      return itr == m.end() ? 0 : itr->second;
+   };
+
+   for( const auto& t : transactions ) {
+      uint32_t wave = after_serial;
+      if( t.serial ) {
+         wave = after_all;
+      } else {
+         for( const auto& k : t.reads )
+            wave = std::max( wave, after( after_write, k ) );
+         for( const auto& k : t.writes )
+            wave = std::max( wave, std::max( after( after_write, k ), after( after_read, k ) ) );
+      }
+      waves.push_back( wave );
+
+      if( t.serial )
+         after_serial = wave + 1;
+      for( const auto& k : t.reads ) {
+         auto& a = after_read[k];
+         a = std::max( a, wave + 1 );
+      }
+      for( const auto& k : t.writes )
+         after_write[k] = wave + 1;
+      after_all = std::max( after_all, wave + 1 );
+   }
+
+   return waves;
+}
+
+access_set predict_access( const transaction& trx ) {
+   access_set s;
+   for( const auto& act : trx.actions ) {
+      s.record_write( act.account, name(), name() ); // stands for every table of the contract
+      for( const auto& auth : act.authorization )
+         s.record_write( config::system_account_name, auth.actor, N(bandwidth) );
+   }
+   return s;
+}
+
+vector<size_t> plan_block( const vector<access_set>& transactions, const vector<uint64_t>& priorities ) {
+   const size_t n = transactions.size();
+
+   // union-find over the transactions, the root of a group is its first transaction
+   vector<size_t> group( n );
+   std::iota( group.begin(), group.end(), 0 );
+   auto find = [&group]( size_t i ) {
+      while( group[i] != i ) {
+         group[i] = group[group[i]];
+         i = group[i];
+      }
+      return i;
+   };
+   auto join = [&]( size_t a, size_t b ) {
+      a = find( a );
+      b = find( b );
+      if( a < b )
+         group[b] = a;
+      else
+         group[a] = b;
+   };
+
+   // readers do not conflict with each other, only with the writers of a key
+   std::map<state_key, size_t> first_writer;
+   for( size_t i = 0; i < n; ++i ) {
+      for( const auto& k : transactions[i].writes ) {
+         auto itr = first_writer.emplace( k, i ).first;
+         join( itr->second, i );
+      }
+   }
+   for( size_t i = 0; i < n; ++i ) {
+      for( const auto& k : transactions[i].reads ) {
+         auto itr = first_writer.find( k );
+         if( itr != first_writer.end() )
+            join( itr->second, i );
+      }
+   }
+   for( size_t i = 0; i < n; ++i ) {
+      if( transactions[i].serial ) {
+         for( size_t j = 0; j < n; ++j )
+            join( i, j );
+         break;
+      }
+   }
+
+   vector<uint64_t> group_priority( n, 0 );
+   for( size_t i = 0; i < n; ++i ) {
+      group[i] = find( i );
+      group_priority[group[i]] = std::max( group_priority[group[i]], priorities[i] );
+   }
+
+   vector<size_t> order( n );
+   std::iota( order.begin(), order.end(), 0 );
+   std::stable_sort( order.begin(), order.end(), [&]( size_t a, size_t b ) {
+      const auto ga = group[a], gb = group[b];
+      return std::make_tuple( group_priority[gb], ga ) < std::make_tuple( group_priority[ga], gb );
+   });
+   return order;
+}
+
+} } /// eosio::chain
@@ -15,13 +15,13 @@ using boost::container::flat_set;
 
 namespace eosio { namespace chain {
 
-static inline void print_debug(account_name receiver, const action_trace& ar) {
+static inline void print_debug(account_name receiver, const action& act, const action_trace& ar) {
    if (!ar.console.empty()) {
       auto prefix = fc::format_string(
                                       "\n[(${a},${n})->${r}]",
                                       fc::mutable_variant_object()
-                                      ("a", ar.act.account)
-                                      ("n", ar.act.name)
+                                      ("a", act.account)
+                                      ("n", act.name)
                                       ("r", receiver));
       dlog(prefix + ": CONSOLE OUTPUT BEGIN =====================\n"
            + ar.console
@@ -31,6 +31,7 @@ static inline void print_debug(account_name receiver, const action_trace& ar) {
 
 void apply_context::exec_one( action_trace& trace )
 {
+   block_profiler::scope execution( control.get_block_profiler(), receiver, act.name );
    auto start = fc::time_point::now();
 
    action_receipt r;
@@ -41,7 +42,8 @@ void apply_context::exec_one( action_trace& trace )
    trace.block_num = control.pending_block_state()->block_num;
    trace.block_time = control.pending_block_time();
    trace.producer_block_id = control.pending_producer_block_id();
-   trace.act = act;
+   if( !defer_trace_act && &trace.act != &act ) // already there when the action was moved into its trace
+      trace.act = act;
    trace.context_free = context_free;
 
    const auto& cfg = control.get_global_properties().configuration;
@@ -51,6 +53,7 @@ void apply_context::exec_one( action_trace& trace )
          privileged = a.privileged;
          auto native = control.find_apply_handler( receiver, act.account, act.name );
          if( native ) {
+            trx_context.state_access.serial = true; // native handlers change state that is not tracked per table
             if( trx_context.enforce_whiteblacklist && control.is_producing_block() ) {
                control.check_contract_list( receiver );
                control.check_action_list( act.account, act.name );
@@ -95,7 +98,7 @@ void apply_context::exec_one( action_trace& trace )
    finalize_trace( trace, start );
 
    if ( control.contracts_console() ) {
-      print_debug(receiver, trace);
+      print_debug(receiver, act, trace);
    }
 }
 
@@ -114,6 +117,7 @@ void apply_context::exec( action_trace& trace )
 {
    _notified.push_back(receiver);
    exec_one( trace );
+   defer_trace_act = false; // notified receivers get their own copy
    for( uint32_t i = 1; i < _notified.size(); ++i ) {
       receiver = _notified[i];
       trace.inline_traces.emplace_back( );
@@ -125,14 +129,17 @@ void apply_context::exec( action_trace& trace )
                   transaction_exception, "max inline action depth per transaction reached" );
    }
 
-   for( const auto& inline_action : _cfa_inline_actions ) {
+   // the queued actions are not needed after they are dispatched, so they are moved into their traces
+   for( auto& inline_action : _cfa_inline_actions ) {
+      const account_name receiver = inline_action.account;
       trace.inline_traces.emplace_back();
-      trx_context.dispatch_action( trace.inline_traces.back(), inline_action, inline_action.account, true, recurse_depth + 1 );
+      trx_context.dispatch_action( trace.inline_traces.back(), std::move(inline_action), receiver, true, recurse_depth + 1 );
    }
 
-   for( const auto& inline_action : _inline_actions ) {
+   for( auto& inline_action : _inline_actions ) {
+      const account_name receiver = inline_action.account;
       trace.inline_traces.emplace_back();
-      trx_context.dispatch_action( trace.inline_traces.back(), inline_action, inline_action.account, false, recurse_depth + 1 );
+      trx_context.dispatch_action( trace.inline_traces.back(), std::move(inline_action), receiver, false, recurse_depth + 1 );
    }
 
 } /// exec()
@@ -236,11 +243,15 @@ void apply_context::execute_inline( action&& a ) {
       control.check_actor_list( actors );
    }
 
+   // the action is moved rather than copied into the list check_authorization takes, and queued from there
+   vector<action> inline_action;
+   inline_action.emplace_back( move(a) );
+
    // No need to check authorization if replaying irreversible blocks or contract is privileged
    if( !control.skip_auth_check() && !privileged ) {
       try {
          control.get_authorization_manager()
-                .check_authorization( {a},
+                .check_authorization( inline_action,
                                       {},
                                       {{receiver, config::eosio_code_name}},
                                       control.pending_block_time() - trx_context.published,
@@ -271,7 +282,7 @@ void apply_context::execute_inline( action&& a ) {
       }
    }
 
-   _inline_actions.emplace_back( move(a) );
+   _inline_actions.emplace_back( move(inline_action.back()) );
 }
 
 void apply_context::execute_context_free_inline( action&& a ) {
@@ -294,6 +305,7 @@ void apply_context::schedule_deferred_transaction( const uint128_t& sender_id, a
    bool enforce_actor_whitelist_blacklist = trx_context.enforce_whiteblacklist && control.is_producing_block()
                                              && !control.sender_avoids_whitelist_blacklist_enforcement( receiver );
    trx_context.validate_referenced_accounts( trx, enforce_actor_whitelist_blacklist );
+   trx_context.state_access.serial = true;
 
    // Charge ahead of time for the additional net usage needed to retire the deferred transaction
    // whether that be by successfully executing, soft failure, hard failure, or expiration.
@@ -400,6 +412,7 @@ void apply_context::schedule_deferred_transaction( const uint128_t& sender_id, a
 }
 
 bool apply_context::cancel_deferred_transaction( const uint128_t& sender_id, account_name sender ) {
+   trx_context.state_access.serial = true;
    auto& generated_transaction_idx = db.get_mutable_index<generated_transaction_multi_index>();
    const auto* gto = db.find<generated_transaction_object,by_sender_id>(boost::make_tuple(sender, sender_id));
    if ( gto ) {
@@ -410,10 +423,14 @@ bool apply_context::cancel_deferred_transaction( const uint128_t& sender_id, acc
 }
 
 const table_id_object* apply_context::find_table( name code, name scope, name table ) {
+   if( trx_context.track_state_access )
+      trx_context.state_access.record_read( code, scope, table );
    return db.find<table_id_object, by_code_scope_table>(boost::make_tuple(code, scope, table));
 }
 
 const table_id_object& apply_context::find_or_create_table( name code, name scope, name table, const account_name &payer ) {
+   if( trx_context.track_state_access )
+      trx_context.state_access.record_write( code, scope, table );
    const auto* existing_tid =  db.find<table_id_object, by_code_scope_table>(boost::make_tuple(code, scope, table));
    if (existing_tid != nullptr) {
       return *existing_tid;
@@ -430,10 +447,16 @@ const table_id_object& apply_context::find_or_create_table( name code, name scop
 }
 
 void apply_context::remove_table( const table_id_object& tid ) {
+   record_table_write( tid );
    update_db_usage(tid.payer, - config::billable_size_v<table_id_object>);
    db.remove(tid);
 }
 
+void apply_context::record_table_write( const table_id_object& tid ) {
+   if( trx_context.track_state_access )
+      trx_context.state_access.record_write( tid.code, tid.scope, tid.table );
+}
+
 vector<account_name> apply_context::get_active_producers() const {
    const auto& ap = control.active_producers();
    vector<account_name> accounts; accounts.reserve( ap.producers.size() );
@@ -543,6 +566,7 @@ void apply_context::db_update_i64( int iterator, account_name payer, const char*
    EOS_ASSERT( table_obj.code == receiver, table_access_violation, "db access violation" );
 
 //   require_write_lock( table_obj.scope );
+   record_table_write( table_obj );
 
    const int64_t overhead = config::billable_size_v<key_value_object>;
    int64_t old_size = (int64_t)(obj.value.size() + overhead);
@@ -573,6 +597,7 @@ void apply_context::db_remove_i64( int iterator ) {
    EOS_ASSERT( table_obj.code == receiver, table_access_violation, "db access violation" );
 
 //   require_write_lock( table_obj.scope );
+   record_table_write( table_obj );
 
    update_db_usage( obj.payer,  -(obj.value.size() + config::billable_size_v<key_value_object>) );
 
@@ -615,6 +640,35 @@ int apply_context::db_next_i64( int iterator, uint64_t& primary ) {
    return keyval_cache.add( *itr );
 }
 
+int apply_context::db_get_batch_i64( int iterator, char* buffer, size_t buffer_size, uint32_t& rows ) {
+   static constexpr size_t row_header_size = sizeof(uint64_t) + sizeof(uint32_t);
+
+   rows = 0;
+   if( iterator < -1 ) return iterator; // end iterator of table, nothing left to copy
+
+   const auto& obj = keyval_cache.get( iterator ); // Check for iterator != -1 happens in this call
+   const auto& idx = db.get_index<key_value_index, by_scope_primary>();
+
+   // only the iterator returned is added to the cache, not one per row copied
+   size_t offset = 0;
+   auto itr = idx.iterator_to( obj );
+   for( ; itr != idx.end() && itr->t_id == obj.t_id; ++itr ) {
+      const uint32_t value_size = itr->value.size();
+      if( buffer_size - offset < row_header_size + value_size ) break;
+
+      memcpy( buffer + offset, &itr->primary_key, sizeof(uint64_t) );
+      memcpy( buffer + offset + sizeof(uint64_t), &value_size, sizeof(uint32_t) );
+      memcpy( buffer + offset + row_header_size, itr->value.data(), value_size );
+      offset += row_header_size + value_size;
+      ++rows;
+   }
+
+   if( rows == 0 ) return iterator;
+   if( itr == idx.end() || itr->t_id != obj.t_id ) return keyval_cache.get_end_iterator_by_table_id( obj.t_id );
+
+   return keyval_cache.add( *itr );
+}
+
 int apply_context::db_previous_i64( int iterator, uint64_t& primary ) {
    const auto& idx = db.get_index<key_value_index, by_scope_primary>();
 
@@ -7,6 +7,7 @@
 #include <eosio/chain/exceptions.hpp>
 #include <eosio/chain/permission_object.hpp>
 #include <eosio/chain/permission_link_object.hpp>
+#include <eosio/chain/authorization_version_object.hpp>
 #include <eosio/chain/authority_checker.hpp>
 #include <eosio/chain/controller.hpp>
 #include <eosio/chain/global_property_object.hpp>
@@ -29,6 +30,7 @@ namespace eosio { namespace chain {
 
    void authorization_manager::add_indices() {
       authorization_index_set::add_indices(_db);
+      _db.add_index<authorization_version_multi_index>();
    }
 
    void authorization_manager::initialize_database() {
@@ -145,6 +147,8 @@ namespace eosio { namespace chain {
          creation_time = _control.pending_block_time();
       }
 
+      invalidate_authorization_cache();
+
       const auto& perm_usage = _db.create<permission_usage_object>([&](auto& p) {
          p.last_used = creation_time;
       });
@@ -172,6 +176,8 @@ namespace eosio { namespace chain {
          creation_time = _control.pending_block_time();
       }
 
+      invalidate_authorization_cache();
+
       const auto& perm_usage = _db.create<permission_usage_object>([&](auto& p) {
          p.last_used = creation_time;
       });
@@ -188,6 +194,7 @@ namespace eosio { namespace chain {
    }
 
    void authorization_manager::modify_permission( const permission_object& permission, const authority& auth ) {
+      invalidate_authorization_cache();
       _db.modify( permission, [&](permission_object& po) {
          po.auth = auth;
          po.last_updated = _control.pending_block_time();
@@ -200,10 +207,31 @@ namespace eosio { namespace chain {
       EOS_ASSERT( range.first == range.second, action_validate_exception,
                   "Cannot remove a permission which has children. Remove the children first.");
 
+      invalidate_authorization_cache();
       _db.get_mutable_index<permission_usage_index>().remove_object( permission.usage_id._id );
       _db.remove( permission );
    }
 
+   void authorization_manager::invalidate_authorization_cache() {
+      const auto* v = _db.find<authorization_version_object>();
+      // past every version set so far, also when an undo took the current version back
+      _last_authorization_version = std::max( _last_authorization_version, v ? v->version : 0 ) + 1;
+      if( v ) {
+         _db.modify( *v, [&]( auto& o ) {
+            o.version = _last_authorization_version;
+         });
+      } else {
+         _db.create<authorization_version_object>( [&]( auto& o ) {
+            o.version = _last_authorization_version;
+         });
+      }
+   }
+
+   uint64_t authorization_manager::authorization_version()const {
+      const auto* v = _db.find<authorization_version_object>();
+      return v ? v->version : 0;
+   }
+
    void authorization_manager::update_permission_usage( const permission_object& permission ) {
       const auto& puo = _db.get<permission_usage_object, by_id>( permission.usage_id );
       _db.modify( puo, [&](permission_usage_object& p) {
@@ -451,6 +479,13 @@ namespace eosio { namespace chain {
 
       map<permission_level, fc::microseconds> permissions_to_satisfy;
 
+      const uint64_t version = authorization_version();
+      const uint16_t depth_limit = _control.get_global_properties().configuration.max_authority_depth;
+      if( _cached_satisfied_permissions.size() + _cached_relevant_authorizations.size() > config::authorization_cache_size ) {
+         _cached_satisfied_permissions.clear();
+         _cached_relevant_authorizations.clear();
+      }
+
       for( const auto& act : actions ) {
          bool special_case = false;
          fc::microseconds delay = effective_provided_delay;
@@ -477,7 +512,8 @@ namespace eosio { namespace chain {
 
             checktime();
 
-            if( !special_case ) {
+            auto relevant_key = std::make_tuple( version, declared_auth, act.account, act.name );
+            if( !special_case && _cached_relevant_authorizations.count( relevant_key ) == 0 ) {
                auto min_permission_name = lookup_minimum_permission(declared_auth.actor, act.account, act.name);
                if( min_permission_name ) { // since special cases were already handled, it should only be false if the permission is eosio.any
                   const auto& min_permission = get_permission({declared_auth.actor, *min_permission_name});
@@ -487,6 +523,7 @@ namespace eosio { namespace chain {
                               "action declares irrelevant authority '${auth}'; minimum authority is ${min}",
                               ("auth", declared_auth)("min", permission_level{min_permission.owner, min_permission.name}) );
                }
+               _cached_relevant_authorizations.insert( std::move(relevant_key) );
             }
 
             if( satisfied_authorizations.find( declared_auth ) == satisfied_authorizations.end() ) {
@@ -507,7 +544,17 @@ namespace eosio { namespace chain {
       // ascending order of the actor name with ties broken by ascending order of the permission name.
       for( const auto& p : permissions_to_satisfy ) {
          checktime(); // TODO: this should eventually move into authority_checker instead
-         EOS_ASSERT( checker.satisfied( p.first, p.second ), unsatisfied_authorization,
+
+         // repeat signers skip the evaluation, but their keys must still count as used
+         satisfied_authorization_key key{ version, p.first, p.second, depth_limit, provided_keys, provided_permissions };
+         auto cached = _cached_satisfied_permissions.find( key );
+         if( cached != _cached_satisfied_permissions.end() ) {
+            checker.use_keys( cached->second );
+            continue;
+         }
+
+         vector<bool> used_keys;
+         EOS_ASSERT( checker.satisfied_using_keys( p.first, p.second, used_keys ), unsatisfied_authorization,
                      "transaction declares authority '${auth}', "
                      "but does not have signatures for it under a provided delay of ${provided_delay} ms, "
                      "provided permissions ${provided_permissions}, provided keys ${provided_keys}, "
@@ -518,7 +565,7 @@ namespace eosio { namespace chain {
                      ("provided_keys", provided_keys)
                      ("delay_max_limit_ms", delay_max_limit.count()/1000)
                    );
-
+         _cached_satisfied_permissions.emplace( std::move(key), std::move(used_keys) );
       }
 
       if( !allow_unused_keys ) {
@@ -5,7 +5,12 @@
 #include <eosio/chain/block_log.hpp>
 #include <eosio/chain/exceptions.hpp>
 #include <fstream>
+#include <future>
 #include <fc/io/raw.hpp>
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+#include <regex>
+#include <thread>
 
 #define LOG_READ  (std::ios::in | std::ios::binary)
 #define LOG_WRITE (std::ios::out | std::ios::binary | std::ios::app)
@@ -23,59 +28,297 @@ namespace eosio { namespace chain {
    const uint32_t block_log::max_supported_version = 2;
 
    namespace detail {
+      namespace bip = boost::interprocess;
+
+      static uint64_t read_index( const char* index_data, uint32_t first_block_num, uint32_t block_num ) {
+         uint64_t pos;
+         memcpy( &pos, index_data + sizeof(uint64_t) * (block_num - first_block_num), sizeof(pos) );
+         return pos;
+      }
+
+      static signed_block_ptr read_block( const char* block_data, uint64_t block_size, uint64_t pos, uint64_t* next_pos = nullptr ) {
+         EOS_ASSERT( pos < block_size, block_log_exception,
+                     "Position ${pos} is past the end of the block log", ("pos", pos) );
+         fc::datastream<const char*> ds( block_data + pos, block_size - pos );
+         auto b = std::make_shared<signed_block>();
+         fc::raw::unpack( ds, *b );
+         if( next_pos )
+            *next_pos = pos + ds.tellp() + sizeof(uint64_t);
+         return b;
+      }
+
+      /**
+       * A completed part of the block log, blocks-<first>-<last>.log and blocks-<first>-<last>.index.
+       * Segments use the same format as blocks.log and are never written again.
+       */
+      struct block_log_segment {
+         uint32_t                            first_block_num = 0;
+         uint32_t                            last_block_num = 0;
+         fc::path                            block_file;
+         fc::path                            index_file;
+         std::shared_ptr<bip::mapped_region> block_region;
+         std::shared_ptr<bip::mapped_region> index_region;
+
+         const char* block_data()const { return static_cast<const char*>(block_region->get_address()); }
+         const char* index_data()const { return static_cast<const char*>(index_region->get_address()); }
+         uint64_t    block_size()const { return block_region->get_size(); }
+
+         static fc::path file_name( const fc::path& dir, uint32_t first, uint32_t last, const char* ext ) {
+            return dir / ("blocks-" + std::to_string( first ) + "-" + std::to_string( last ) + ext);
+         }
+
+         void map() {
+            bip::file_mapping block_mapping( block_file.generic_string().c_str(), bip::read_only );
+            block_region = std::make_shared<bip::mapped_region>( block_mapping, bip::read_only );
+            bip::file_mapping index_mapping( index_file.generic_string().c_str(), bip::read_only );
+            index_region = std::make_shared<bip::mapped_region>( index_mapping, bip::read_only );
+            EOS_ASSERT( index_region->get_size() == sizeof(uint64_t) * (last_block_num - first_block_num + 1), block_log_exception,
+                        "Block log index ${i} does not match its block numbers", ("i", index_file.generic_string()) );
+         }
+
+         signed_block_ptr read_block_by_num( uint32_t block_num )const {
+            return detail::read_block( block_data(), block_size(), read_index( index_data(), first_block_num, block_num ) );
+         }
+      };
+      using block_log_segments = std::map<uint32_t, std::shared_ptr<const block_log_segment>>; ///< by last block number
+
+      /**
+       * Read only memory mapping of the block log and index as of the last append. Readers take a
+       * reference to the currently published view, so appends never invalidate data a reader uses.
+       */
+      struct block_log_view {
+         std::shared_ptr<bip::mapped_region> block_region;
+         std::shared_ptr<bip::mapped_region> index_region;
+         uint64_t                            block_size = 0; ///< readable bytes of the block file
+         uint64_t                            index_size = 0; ///< readable bytes of the index file
+         uint32_t                            first_block_num = 0;
+         uint32_t                            head_num = 0;
+         std::shared_ptr<const block_log_segments> segments; ///< completed segments, never null
+
+         const char* block_data()const { return static_cast<const char*>(block_region->get_address()); }
+         const char* index_data()const { return static_cast<const char*>(index_region->get_address()); }
+      };
+
+
       class block_log_impl {
          public:
             signed_block_ptr         head;
             block_id_type            head_id;
-            std::fstream             block_stream;
-            std::fstream             index_stream;
+            std::fstream             block_stream; ///< append only
+            std::fstream             index_stream; ///< append only
+            fc::path                 data_dir;
             fc::path                 block_file;
             fc::path                 index_file;
-            bool                     block_write;
-            bool                     index_write;
+            uint64_t                 block_size = 0;
+            uint64_t                 index_size = 0;
             bool                     genesis_written_to_block_log = false;
             uint32_t                 version = 0;
             uint32_t                 first_block_num = 0;
+            vector<char>             genesis_data; ///< packed genesis_state, written to the header of every segment
+            block_log_config         config;
+            std::shared_ptr<const block_log_segments> segments = std::make_shared<block_log_segments>();
+            bool                     files_replaced = false; ///< blocks.log was renamed, the published mappings are of the old file
 
-            inline void check_block_read() {
-               if (block_write) {
-                  block_stream.close();
-                  block_stream.open(block_file.generic_string().c_str(), LOG_READ);
-                  block_write = false;
-               }
+            std::shared_ptr<const block_log_view> current_view()const {
+               return std::atomic_load( &view );
             }
 
-            inline void check_block_write() {
-               if (!block_write) {
-                  block_stream.close();
-                  block_stream.open(block_file.generic_string().c_str(), LOG_WRITE);
-                  block_write = true;
+            /**
+             * Make everything written so far visible to readers. The files are mapped with room to grow,
+             * so they only need to be mapped again once an append goes past the end of the mapping.
+             */
+            void publish() {
+               auto old = files_replaced ? nullptr : current_view();
+               files_replaced = false;
+               auto v = std::make_shared<block_log_view>();
+               v->block_region = map_file( block_file, block_size, old ? old->block_region : nullptr, min_block_mapping );
+               v->index_region = map_file( index_file, index_size, old ? old->index_region : nullptr, min_index_mapping );
+               v->block_size = v->block_region ? block_size : 0;
+               v->index_size = v->index_region ? index_size : 0;
+               v->first_block_num = first_block_num;
+               v->head_num = head ? block_header::num_from_id( head_id ) : 0;
+               v->segments = segments;
+               std::atomic_store( &view, std::shared_ptr<const block_log_view>( std::move( v ) ) );
+            }
+
+            /// write the header of a new blocks.log starting at first_block_num
+            void write_header( uint32_t log_version ) {
+               version = log_version;
+               block_stream.write((char*)&version, sizeof(version));
+               block_stream.write((char*)&first_block_num, sizeof(first_block_num));
+               block_stream.write(genesis_data.data(), genesis_data.size());
+               genesis_written_to_block_log = true;
+
+               // append a totem to indicate the division between blocks and header
+               auto totem = block_log::npos;
+               block_stream.write((char*)&totem, sizeof(totem));
+               block_size = sizeof(version) + sizeof(first_block_num) + genesis_data.size() + sizeof(totem);
+               index_size = 0;
+            }
+
+            /// find the completed segments of the block log in data_dir
+            void load_segments() {
+               static const std::regex segment_regex( "blocks-([0-9]+)-([0-9]+)\\.log" );
+               auto loaded = std::make_shared<block_log_segments>();
+               for( fc::directory_iterator itr( data_dir ), end; itr != end; ++itr ) {
+                  std::smatch match;
+                  const fc::path file = *itr;
+                  const std::string name = file.filename().generic_string();
+                  if( !std::regex_match( name, match, segment_regex ) )
+                     continue;
+                  auto segment = std::make_shared<block_log_segment>();
+                  segment->first_block_num = std::stoul( match[1].str() );
+                  segment->last_block_num = std::stoul( match[2].str() );
+                  segment->block_file = file;
+                  segment->index_file = block_log_segment::file_name( data_dir, segment->first_block_num, segment->last_block_num, ".index" );
+                  if( !fc::exists( segment->index_file ) ) {
+                     ilog( "Reconstructing index of block log segment ${f}", ("f", name) );
+                     block_log::build_index( segment->block_file, segment->index_file, std::thread::hardware_concurrency() );
+                  }
+                  segment->map();
+                  loaded->emplace( segment->last_block_num, std::move( segment ) );
                }
+               uint32_t next = 0;
+               for( const auto& item : *loaded ) {
+                  if( next && item.second->first_block_num != next )
+                     wlog( "Block log segments are missing blocks ${f} to ${l}", ("f", next)("l", item.second->first_block_num - 1) );
+                  next = item.first + 1;
+               }
+               segments = std::move( loaded );
             }
 
-            inline void check_index_read() {
-               try {
-                  if (index_write) {
-                     index_stream.close();
-                     index_stream.open(index_file.generic_string().c_str(), LOG_READ);
-                     index_write = false;
+            /// move blocks.log to a completed segment and start a new blocks.log at the next block
+            void rotate() {
+               block_stream.close();
+               index_stream.close();
+
+               auto segment = std::make_shared<block_log_segment>();
+               segment->first_block_num = first_block_num;
+               segment->last_block_num = block_header::num_from_id( head_id );
+               segment->block_file = block_log_segment::file_name( data_dir, segment->first_block_num, segment->last_block_num, ".log" );
+               segment->index_file = block_log_segment::file_name( data_dir, segment->first_block_num, segment->last_block_num, ".index" );
+               fc::rename( index_file, segment->index_file );
+               fc::rename( block_file, segment->block_file );
+               files_replaced = true;
+               segment->map();
+               ilog( "Block log split at block ${n}, completed segment ${f}", ("n", segment->last_block_num)("f", segment->block_file.generic_string()) );
+
+               auto updated = std::make_shared<block_log_segments>( *segments );
+               updated->emplace( segment->last_block_num, segment );
+               segments = std::move( updated );
+
+               block_stream.open(block_file.generic_string().c_str(), LOG_WRITE);
+               index_stream.open(index_file.generic_string().c_str(), LOG_WRITE);
+               first_block_num = segment->last_block_num + 1;
+               write_header( block_log::max_supported_version );
+               flush();
+
+               retire_segments();
+            }
+
+            /// prune or archive the segments that are no longer retained
+            void retire_segments() {
+               auto updated = std::make_shared<block_log_segments>( *segments );
+               const uint32_t head_num = block_header::num_from_id( head_id );
+               while( !updated->empty() ) {
+                  const auto& oldest = *updated->begin()->second;
+                  if( config.retain_blocks && oldest.last_block_num + config.retain_blocks <= head_num ) {
+                     ilog( "Pruning block log segment ${f}", ("f", oldest.block_file.generic_string()) );
+                     fc::remove_all( oldest.block_file );
+                     fc::remove_all( oldest.index_file );
+                  } else if( updated->size() > config.max_retained_files ) {
+                     if( config.archive_dir.empty() ) {
+                        ilog( "Removing block log segment ${f}", ("f", oldest.block_file.generic_string()) );
+                        fc::remove_all( oldest.block_file );
+                        fc::remove_all( oldest.index_file );
+                     } else {
+                        ilog( "Archiving block log segment ${f} to ${d}", ("f", oldest.block_file.generic_string())("d", config.archive_dir.generic_string()) );
+                        if( !fc::is_directory( config.archive_dir ) )
+                           fc::create_directories( config.archive_dir );
+                        move_file( oldest.block_file, config.archive_dir / oldest.block_file.filename() );
+                        move_file( oldest.index_file, config.archive_dir / oldest.index_file.filename() );
+                     }
+                  } else {
+                     break;
                   }
+                  updated->erase( updated->begin() );
+               }
+               segments = std::move( updated );
+            }
+
+            /// write b to the streams without flushing or publishing it
+            uint64_t append( const signed_block_ptr& b ) {
+               EOS_ASSERT( genesis_written_to_block_log, block_log_append_fail, "Cannot append to block log until the genesis is first written" );
+
+               if( config.stride && index_size && (b->block_num() - 1) % config.stride == 0 ) {
+                  rotate();
                }
-               FC_LOG_AND_RETHROW()
+
+               uint64_t pos = block_size;
+               EOS_ASSERT(index_size == sizeof(uint64_t) * (b->block_num() - first_block_num),
+                         block_log_append_fail,
+                         "Append to index file occuring at wrong position.",
+                         ("position", index_size)
+                         ("expected", (b->block_num() - first_block_num) * sizeof(uint64_t)));
+               auto data = fc::raw::pack(*b);
+               block_stream.write(data.data(), data.size());
+               block_stream.write((char*)&pos, sizeof(pos));
+               index_stream.write((char*)&pos, sizeof(pos));
+               block_size += data.size() + sizeof(pos);
+               index_size += sizeof(pos);
+               head = b;
+               head_id = b->id();
+               return pos;
+            }
+
+            void flush() {
+               block_stream.flush();
+               index_stream.flush();
             }
 
-            inline void check_index_write() {
-               if (!index_write) {
+            void close() {
+               if (block_stream.is_open())
+                  block_stream.close();
+               if (index_stream.is_open())
                   index_stream.close();
-                  index_stream.open(index_file.generic_string().c_str(), LOG_WRITE);
-                  index_write = true;
+               std::atomic_store( &view, std::shared_ptr<const block_log_view>() );
+            }
+
+         private:
+            static void move_file( const fc::path& from, const fc::path& to ) {
+               try {
+                  fc::rename( from, to );
+               } catch( const fc::exception& ) {
+                  // archive directory on another file system
+                  fc::copy( from, to );
+                  fc::remove_all( from );
                }
             }
+
+            static constexpr uint64_t min_block_mapping = 1024*1024*1024;
+            static constexpr uint64_t min_index_mapping = 64*1024*1024;
+
+            static std::shared_ptr<bip::mapped_region> map_file( const fc::path& file, uint64_t size,
+                                                                 const std::shared_ptr<bip::mapped_region>& current,
+                                                                 uint64_t min_mapping ) {
+               if( size == 0 )
+                  return nullptr;
+               if( current && size <= current->get_size() )
+                  return current;
+               // only the part up to size is ever read, pages past the end of the file are never touched
+               bip::file_mapping mapping( file.generic_string().c_str(), bip::read_only );
+               return std::make_shared<bip::mapped_region>( mapping, bip::read_only, 0, std::max( size * 2, min_mapping ) );
+            }
+
+            std::shared_ptr<const block_log_view> view; ///< only accessed with atomic_load/atomic_store
       };
    }
 
-   block_log::block_log(const fc::path& data_dir)
+   block_log::block_log(const fc::path& data_dir, const block_log_config& config)
    :my(new detail::block_log_impl()) {
+      my->config = config;
+      if( my->config.retain_blocks && !my->config.stride )
+         my->config.stride = my->config.retain_blocks;
       my->block_stream.exceptions(std::fstream::failbit | std::fstream::badbit);
       my->index_stream.exceptions(std::fstream::failbit | std::fstream::badbit);
       open(data_dir);
@@ -93,21 +336,17 @@ namespace eosio { namespace chain {
    }
 
    void block_log::open(const fc::path& data_dir) {
-      if (my->block_stream.is_open())
-         my->block_stream.close();
-      if (my->index_stream.is_open())
-         my->index_stream.close();
+      my->close();
 
       if (!fc::is_directory(data_dir))
          fc::create_directories(data_dir);
+      my->data_dir = data_dir;
       my->block_file = data_dir / "blocks.log";
       my->index_file = data_dir / "blocks.index";
 
       //ilog("Opening block log at ${path}", ("path", my->block_file.generic_string()));
       my->block_stream.open(my->block_file.generic_string().c_str(), LOG_WRITE);
       my->index_stream.open(my->index_file.generic_string().c_str(), LOG_WRITE);
-      my->block_write = true;
-      my->index_write = true;
 
       /* On startup of the block log, there are several states the log file and the index file can be
        * in relation to each other.
@@ -129,13 +368,37 @@ namespace eosio { namespace chain {
        */
       auto log_size = fc::file_size(my->block_file);
       auto index_size = fc::file_size(my->index_file);
+      my->block_size = log_size;
+      my->index_size = index_size;
+      my->head.reset();
+      my->head_id = block_id_type();
+      my->load_segments();
+
+      if (!log_size && !my->segments->empty()) {
+         ilog("Log is empty, starting it after the last block log segment");
+         const auto& last = *my->segments->rbegin()->second;
+         fc::datastream<const char*> ds( last.block_data(), last.block_size() );
+         uint32_t version = 0;
+         ds.read( (char*)&version, sizeof(version) );
+         EOS_ASSERT( version > 1, block_log_exception, "Block log segment ${f} was not setup properly", ("f", last.block_file.generic_string()) );
+         ds.skip( sizeof(uint32_t) ); // first block num
+         genesis_state gs;
+         fc::raw::unpack( ds, gs );
+         my->genesis_data = fc::raw::pack( gs );
+         my->first_block_num = last.last_block_num + 1;
+         my->write_header( max_supported_version );
+         my->flush();
+         log_size = my->block_size;
+         index_size = 0;
+      }
 
       if (log_size) {
          ilog("Log is nonempty");
-         my->check_block_read();
-         my->block_stream.seekg( 0 );
+         my->publish();
+         auto view = my->current_view();
+         fc::datastream<const char*> ds( view->block_data(), view->block_size );
          my->version = 0;
-         my->block_stream.read( (char*)&my->version, sizeof(my->version) );
+         ds.read( (char*)&my->version, sizeof(my->version) );
          EOS_ASSERT( my->version > 0, block_log_exception, "Block log was not setup properly" );
          EOS_ASSERT( my->version >= min_supported_version && my->version <= max_supported_version, block_log_unsupported_version,
                  "Unsupported version of block log. Block log version is ${version} while code supports version(s) [${min},${max}]",
@@ -145,27 +408,39 @@ namespace eosio { namespace chain {
          my->genesis_written_to_block_log = true; // Assume it was constructed properly.
          if (my->version > 1){
             my->first_block_num = 0;
-            my->block_stream.read( (char*)&my->first_block_num, sizeof(my->first_block_num) );
+            ds.read( (char*)&my->first_block_num, sizeof(my->first_block_num) );
             EOS_ASSERT(my->first_block_num > 0, block_log_exception, "Block log is malformed, first recorded block number is 0 but must be greater than or equal to 1");
          } else {
             my->first_block_num = 1;
          }
+         genesis_state gs;
+         fc::raw::unpack( ds, gs );
+         my->genesis_data = fc::raw::pack( gs );
 
+         // the head may be in the last segment when blocks.log has no blocks yet
          my->head = read_head();
-         my->head_id = my->head->id();
-
-         if (index_size) {
-            my->check_block_read();
-            my->check_index_read();
-
+         if (my->head)
+            my->head_id = my->head->id();
+
+         uint64_t last_pos;
+         memcpy( &last_pos, view->block_data() + view->block_size - sizeof(last_pos), sizeof(last_pos) );
+
+         if (last_pos == npos) {
+            // log that was started after a snapshot or a segment, before its first block was appended
+            if (index_size) {
+               ilog("Log has no blocks, remove its index");
+               my->index_stream.close();
+               fc::remove_all(my->index_file);
+               my->index_stream.open(my->index_file.generic_string().c_str(), LOG_WRITE);
+               my->index_size = 0;
+            }
+         } else if (index_size) {
             ilog("Index is nonempty");
             uint64_t block_pos;
-            my->block_stream.seekg(-sizeof(uint64_t), std::ios::end);
-            my->block_stream.read((char*)&block_pos, sizeof(block_pos));
+            memcpy( &block_pos, view->block_data() + view->block_size - sizeof(block_pos), sizeof(block_pos) );
 
             uint64_t index_pos;
-            my->index_stream.seekg(-sizeof(uint64_t), std::ios::end);
-            my->index_stream.read((char*)&index_pos, sizeof(index_pos));
+            memcpy( &index_pos, view->index_data() + view->index_size - sizeof(index_pos), sizeof(index_pos) );
 
             if (block_pos < index_pos) {
                ilog("block_pos < index_pos, close and reopen index_stream");
@@ -183,31 +458,34 @@ namespace eosio { namespace chain {
          my->index_stream.close();
          fc::remove_all(my->index_file);
          my->index_stream.open(my->index_file.generic_string().c_str(), LOG_WRITE);
-         my->index_write = true;
+         my->index_size = 0;
       }
+      my->publish();
    }
 
    uint64_t block_log::append(const signed_block_ptr& b) {
       try {
-         EOS_ASSERT( my->genesis_written_to_block_log, block_log_append_fail, "Cannot append to block log until the genesis is first written" );
-
-         my->check_block_write();
-         my->check_index_write();
-
-         uint64_t pos = my->block_stream.tellp();
-         EOS_ASSERT(my->index_stream.tellp() == sizeof(uint64_t) * (b->block_num() - my->first_block_num),
-                   block_log_append_fail,
-                   "Append to index file occuring at wrong position.",
-                   ("position", (uint64_t) my->index_stream.tellp())
-                   ("expected", (b->block_num() - my->first_block_num) * sizeof(uint64_t)));
-         auto data = fc::raw::pack(*b);
-         my->block_stream.write(data.data(), data.size());
-         my->block_stream.write((char*)&pos, sizeof(pos));
-         my->index_stream.write((char*)&pos, sizeof(pos));
-         my->head = b;
-         my->head_id = b->id();
+         uint64_t pos = my->append( b );
 
          flush();
+         my->publish();
+
+         return pos;
+      }
+      FC_LOG_AND_RETHROW()
+   }
+
+   uint64_t block_log::append(const vector<signed_block_ptr>& blocks) {
+      try {
+         uint64_t pos = npos;
+         for( const auto& b : blocks ) {
+            pos = my->append( b );
+         }
+
+         if( !blocks.empty() ) {
+            flush();
+            my->publish();
+         }
 
          return pos;
       }
@@ -215,42 +493,41 @@ namespace eosio { namespace chain {
    }
 
    void block_log::flush() {
-      my->block_stream.flush();
-      my->index_stream.flush();
+      my->flush();
    }
 
    void block_log::reset( const genesis_state& gs, const signed_block_ptr& first_block, uint32_t first_block_num ) {
-      if (my->block_stream.is_open())
-         my->block_stream.close();
-      if (my->index_stream.is_open())
-         my->index_stream.close();
+      my->close();
 
       fc::remove_all(my->block_file);
       fc::remove_all(my->index_file);
 
+      // segments with the same or later blocks belong to the log that is replaced
+      auto retained = std::make_shared<detail::block_log_segments>();
+      for( const auto& item : *my->segments ) {
+         if( item.second->last_block_num < first_block_num ) {
+            retained->insert( item );
+         } else {
+            fc::remove_all( item.second->block_file );
+            fc::remove_all( item.second->index_file );
+         }
+      }
+      my->segments = std::move( retained );
+
       my->block_stream.open(my->block_file.generic_string().c_str(), LOG_WRITE);
       my->index_stream.open(my->index_file.generic_string().c_str(), LOG_WRITE);
-      my->block_write = true;
-      my->index_write = true;
+      my->head.reset();
+      my->head_id = block_id_type();
 
-      auto data = fc::raw::pack(gs);
-      my->version = 0; // version of 0 is invalid; it indicates that the genesis was not properly written to the block log
+      my->genesis_data = fc::raw::pack(gs);
       my->first_block_num = first_block_num;
-      my->block_stream.write((char*)&my->version, sizeof(my->version));
-      my->block_stream.write((char*)&my->first_block_num, sizeof(my->first_block_num));
-      my->block_stream.write(data.data(), data.size());
-      my->genesis_written_to_block_log = true;
-
-      // append a totem to indicate the division between blocks and header
-      auto totem = npos;
-      my->block_stream.write((char*)&totem, sizeof(totem));
+      // version of 0 is invalid; it indicates that the genesis was not properly written to the block log
+      my->write_header( 0 );
 
       if (first_block) {
          append(first_block);
       }
 
-      auto pos = my->block_stream.tellp();
-
       my->block_stream.close();
       my->block_stream.open(my->block_file.generic_string().c_str(), std::ios::in | std::ios::out | std::ios::binary ); // Bypass append-only writing just once
 
@@ -258,30 +535,39 @@ namespace eosio { namespace chain {
       my->version = block_log::max_supported_version;
       my->block_stream.seekp( 0 );
       my->block_stream.write( (char*)&my->version, sizeof(my->version) );
-      my->block_stream.seekp( pos );
-      flush();
+      my->block_stream.close();
 
-      my->block_write = false;
-      my->check_block_write(); // Reset to append-only writing.
+      my->block_stream.open(my->block_file.generic_string().c_str(), LOG_WRITE); // Reset to append-only writing.
+      my->publish();
    }
 
    std::pair<signed_block_ptr, uint64_t> block_log::read_block(uint64_t pos)const {
-      my->check_block_read();
-
-      my->block_stream.seekg(pos);
+      auto view = my->current_view();
+      EOS_ASSERT( view, block_log_exception, "Block log is not open" );
       std::pair<signed_block_ptr,uint64_t> result;
-      result.first = std::make_shared<signed_block>();
-      fc::raw::unpack(my->block_stream, *result.first);
-      result.second = uint64_t(my->block_stream.tellg()) + 8;
+      result.first = detail::read_block( view->block_data(), view->block_size, pos, &result.second );
       return result;
    }
 
    signed_block_ptr block_log::read_block_by_num(uint32_t block_num)const {
       try {
+         auto view = my->current_view();
+         if (!view)
+            return {};
+
          signed_block_ptr b;
-         uint64_t pos = get_block_pos(block_num);
-         if (pos != npos) {
-            b = read_block(pos).first;
+         if (block_num >= view->first_block_num) {
+            if (view->head_num && block_num <= view->head_num &&
+                sizeof(uint64_t) * (block_num - view->first_block_num + 1) <= view->index_size) {
+               b = detail::read_block( view->block_data(), view->block_size,
+                                       detail::read_index( view->index_data(), view->first_block_num, block_num ) );
+            }
+         } else {
+            auto itr = view->segments->lower_bound( block_num );
+            if (itr != view->segments->end() && itr->second->first_block_num <= block_num)
+               b = itr->second->read_block_by_num( block_num );
+         }
+         if (b) {
             EOS_ASSERT(b->block_num() == block_num, reversible_blocks_exception,
                       "Wrong block was read from block log.", ("returned", b->block_num())("expected", block_num));
          }
@@ -290,29 +576,28 @@ namespace eosio { namespace chain {
    }
 
    uint64_t block_log::get_block_pos(uint32_t block_num) const {
-      my->check_index_read();
-      if (!(my->head && block_num <= block_header::num_from_id(my->head_id) && block_num >= my->first_block_num))
+      auto view = my->current_view();
+      if (!(view && view->head_num && block_num <= view->head_num && block_num >= view->first_block_num))
+         return npos;
+      if (sizeof(uint64_t) * (block_num - view->first_block_num + 1) > view->index_size)
          return npos;
-      my->index_stream.seekg(sizeof(uint64_t) * (block_num - my->first_block_num));
-      uint64_t pos;
-      my->index_stream.read((char*)&pos, sizeof(pos));
-      return pos;
+      return detail::read_index( view->index_data(), view->first_block_num, block_num );
    }
 
    signed_block_ptr block_log::read_head()const {
-      my->check_block_read();
+      auto view = my->current_view();
 
-      uint64_t pos;
+      uint64_t pos = npos;
 
       // Check that the file is not empty
-      my->block_stream.seekg(0, std::ios::end);
-      if (my->block_stream.tellg() <= sizeof(pos))
-         return {};
+      if (view && view->block_size > sizeof(pos))
+         memcpy( &pos, view->block_data() + view->block_size - sizeof(pos), sizeof(pos) );
 
-      my->block_stream.seekg(-sizeof(pos), std::ios::end);
-      my->block_stream.read((char*)&pos, sizeof(pos));
       if (pos != npos) {
          return read_block(pos).first;
+      } else if (view && !view->segments->empty()) {
+         // blocks.log was just started, the head is the last block of the last segment
+         return view->segments->rbegin()->second->read_block_by_num( view->segments->rbegin()->first );
       } else {
          return {};
       }
@@ -330,41 +615,161 @@ namespace eosio { namespace chain {
       ilog("Reconstructing Block Log Index...");
       my->index_stream.close();
       fc::remove_all(my->index_file);
-      my->index_stream.open(my->index_file.generic_string().c_str(), LOG_WRITE);
-      my->index_write = true;
 
-      uint64_t end_pos;
-      my->check_block_read();
+      auto last_report = fc::time_point::now();
+      const uint64_t blocks = build_index( my->block_file, my->index_file, std::thread::hardware_concurrency(),
+                                           [&last_report]( uint64_t done, uint64_t total ) {
+         auto now = fc::time_point::now();
+         if( now - last_report >= fc::seconds(5) ) {
+            ilog( "Block log index reconstructed for ${p}% of the block log", ("p", done * 100 / total) );
+            last_report = now;
+         }
+      } );
 
-      my->block_stream.seekg(-sizeof( uint64_t), std::ios::end);
-      my->block_stream.read((char*)&end_pos, sizeof(end_pos));
-      signed_block tmp;
+      my->index_stream.open(my->index_file.generic_string().c_str(), LOG_WRITE);
+      my->index_size = blocks * sizeof(uint64_t);
+      const uint32_t head_num = block_header::num_from_id(my->head_id);
+      EOS_ASSERT( blocks == head_num - my->first_block_num + 1, block_log_exception,
+                  "Reconstructed block log index has ${n} blocks but the block log has blocks ${f} to ${h}",
+                  ("n", blocks)("f", my->first_block_num)("h", head_num) );
+   } // construct_index
 
-      uint64_t pos = 0;
-      if (my->version == 1) {
-         pos = 4; // Skip version which should have already been checked.
-      } else {
-         pos = 8; // Skip version and first block offset which should have already been checked
+   namespace detail {
+      /// sanity limit of a block's size when looking for block boundaries
+      constexpr uint64_t max_indexed_block_size = 64*1024*1024;
+
+      /// @return true if a block ends at trailer and the position stored in trailer is where that block starts
+      static bool is_trailer( const char* data, uint64_t blocks_begin, uint64_t trailer ) {
+         uint64_t pos;
+         memcpy( &pos, data + trailer, sizeof(pos) );
+         if( pos < blocks_begin || pos >= trailer || trailer - pos > max_indexed_block_size )
+            return false;
+         try {
+            fc::datastream<const char*> ds( data + pos, trailer - pos );
+            signed_block b;
+            fc::raw::unpack( ds, b );
+            return uint64_t(ds.tellp()) == trailer - pos;
+         } catch( ... ) {
+            return false;
+         }
       }
-      my->block_stream.seekg(pos);
 
-      genesis_state gs;
-      fc::raw::unpack(my->block_stream, gs);
+      /// @return start of the first block after the last trailer ending at or before end_limit, 0 if none within the search range
+      static uint64_t find_block_start( const char* data, uint64_t blocks_begin, uint64_t end_limit ) {
+         const uint64_t lower = std::max( blocks_begin + sizeof(uint64_t),
+                                          end_limit > max_indexed_block_size ? end_limit - max_indexed_block_size : 0 );
+         for( uint64_t end = end_limit; end >= lower; --end ) {
+            if( is_trailer( data, blocks_begin, end - sizeof(uint64_t) ) )
+               return end;
+         }
+         return 0;
+      }
 
-      // skip the totem
-      if (my->version > 1) {
-         uint64_t totem;
-         my->block_stream.read((char*) &totem, sizeof(totem));
+      /**
+       * Follow the position trailers back from the block ending at chunk_end to the block starting at chunk_begin.
+       * @return positions of the blocks in the chunk, in block order
+       */
+      static vector<uint64_t> walk_trailers( const char* data, uint64_t chunk_begin, uint64_t chunk_end,
+                                             std::atomic<uint64_t>& bytes_done ) {
+         constexpr uint64_t report_bytes = 16*1024*1024;
+         vector<uint64_t> positions;
+         uint64_t trailer = chunk_end - sizeof(uint64_t);
+         uint64_t reported = chunk_end;
+         while( true ) {
+            uint64_t pos;
+            memcpy( &pos, data + trailer, sizeof(pos) );
+            EOS_ASSERT( pos >= chunk_begin && pos < trailer, block_log_exception,
+                        "Block log position trailer at ${t} does not point to a block in ${b} to ${e}",
+                        ("t", trailer)("b", chunk_begin)("e", chunk_end) );
+            positions.push_back( pos );
+            if( pos == chunk_begin )
+               break;
+            EOS_ASSERT( pos >= chunk_begin + sizeof(uint64_t), block_log_exception,
+                        "Block log position trailer at ${t} points into the previous trailer", ("t", trailer) );
+            trailer = pos - sizeof(uint64_t);
+            if( reported - pos >= report_bytes ) {
+               bytes_done += reported - pos;
+               reported = pos;
+            }
+         }
+         bytes_done += reported - chunk_begin;
+         std::reverse( positions.begin(), positions.end() );
+         return positions;
       }
+   }
 
-      while( pos < end_pos ) {
-         fc::raw::unpack(my->block_stream, tmp);
-         my->block_stream.read((char*)&pos, sizeof(pos));
-         if(tmp.block_num() % 1000 == 0)
-            ilog( "Block log index reconstructed for block ${n}", ("n", tmp.block_num()));
-         my->index_stream.write((char*)&pos, sizeof(pos));
+   uint64_t block_log::build_index( const fc::path& block_file, const fc::path& index_file, uint32_t threads,
+                                    const std::function<void(uint64_t, uint64_t)>& progress ) {
+      namespace bip = boost::interprocess;
+      bip::file_mapping mapping( block_file.generic_string().c_str(), bip::read_only );
+      bip::mapped_region region( mapping, bip::read_only );
+      const char* const data = static_cast<const char*>( region.get_address() );
+      const uint64_t size = region.get_size();
+
+      fc::datastream<const char*> ds( data, size );
+      uint32_t version = 0;
+      ds.read( (char*)&version, sizeof(version) );
+      EOS_ASSERT( version >= min_supported_version && version <= max_supported_version, block_log_unsupported_version,
+                  "Unsupported version of block log. Block log version is ${version} while code supports version(s) [${min},${max}]",
+                  ("version", version)("min", block_log::min_supported_version)("max", block_log::max_supported_version) );
+      if( version > 1 )
+         ds.skip( sizeof(uint32_t) ); // first block num
+      genesis_state gs;
+      fc::raw::unpack( ds, gs );
+      if( version > 1 )
+         ds.skip( sizeof(uint64_t) ); // totem
+      const uint64_t blocks_begin = ds.tellp();
+
+      vector<uint64_t> positions;
+      if( size > blocks_begin ) {
+         threads = std::max<uint32_t>( threads, 1 );
+         const uint64_t blocks_size = size - blocks_begin;
+
+         // split the blocks at the block boundaries nearest below evenly spaced offsets
+         vector<uint64_t> bounds{ blocks_begin };
+         for( uint32_t i = 1; i < threads; ++i ) {
+            auto start = detail::find_block_start( data, blocks_begin, blocks_begin + blocks_size * i / threads );
+            if( start > bounds.back() && start < size )
+               bounds.push_back( start );
+         }
+         bounds.push_back( size );
+
+         std::atomic<uint64_t> bytes_done{0};
+         vector<std::future<vector<uint64_t>>> chunks;
+         for( size_t i = 0; i + 1 < bounds.size(); ++i ) {
+            chunks.emplace_back( std::async( std::launch::async, [data, &bounds, i, &bytes_done]() {
+               return detail::walk_trailers( data, bounds[i], bounds[i + 1], bytes_done );
+            } ) );
+         }
+         for( auto& chunk : chunks ) {
+            while( progress && chunk.wait_for( std::chrono::milliseconds(500) ) != std::future_status::ready ) {
+               progress( bytes_done.load(), blocks_size );
+            }
+         }
+         try {
+            for( auto& chunk : chunks ) {
+               auto chunk_positions = chunk.get();
+               positions.insert( positions.end(), chunk_positions.begin(), chunk_positions.end() );
+            }
+         } catch( const block_log_exception& e ) {
+            if( bounds.size() <= 2 )
+               throw;
+            // a split point that was taken for a block boundary but is not one, follow all trailers from the end
+            wlog( "Unable to reconstruct the block log index in parallel, retrying in one thread: ${e}", ("e", e.to_string()) );
+            bytes_done = 0;
+            positions = detail::walk_trailers( data, blocks_begin, size, bytes_done );
+         }
+         if( progress )
+            progress( blocks_size, blocks_size );
       }
-   } // construct_index
+
+      std::ofstream index_stream;
+      index_stream.exceptions( std::ofstream::failbit | std::ofstream::badbit );
+      index_stream.open( index_file.generic_string().c_str(), std::ios::out | std::ios::binary | std::ios::trunc );
+      index_stream.write( (const char*)positions.data(), positions.size() * sizeof(uint64_t) );
+      index_stream.close();
+      return positions.size();
+   }
 
    fc::path block_log::repair_log( const fc::path& data_dir, uint32_t truncate_at_block ) {
       ilog("Recovering Block Log...");
@@ -392,6 +797,14 @@ namespace eosio { namespace chain {
       fc::create_directories(blocks_dir);
       auto block_log_path = blocks_dir / "blocks.log";
 
+      // completed segments are not repaired, they are only written once they are complete
+      static const std::regex segment_regex( "blocks-[0-9]+-[0-9]+\\.(log|index)" );
+      for( fc::directory_iterator itr( backup_dir ), end; itr != end; ++itr ) {
+         const fc::path file = *itr;
+         if( std::regex_match( file.filename().generic_string(), segment_regex ) )
+            fc::copy( file, blocks_dir / file.filename() );
+      }
+
       ilog( "Reconstructing '${new_block_log}' from backed up block log", ("new_block_log", block_log_path) );
 
       std::fstream  old_block_stream;
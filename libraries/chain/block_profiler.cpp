@@ -0,0 +1,94 @@
+/**
+ *  @file
+ *  @copyright defined in eos/LICENSE
+ */
+#include <eosio/chain/block_profiler.hpp>
+#include <eosio/chain/exceptions.hpp>
+
+#include <algorithm>
+
+namespace eosio { namespace chain {
+
+int64_t& block_profile::phase_us( profile_phase phase ) {
+   switch( phase ) {
+      case profile_phase::deserialization:    return deserialization_us;
+      case profile_phase::signature_recovery: return signature_recovery_us;
+      case profile_phase::authorization:      return authorization_us;
+      case profile_phase::wasm_instantiation: return wasm_instantiation_us;
+      case profile_phase::execution:          return execution_us;
+      case profile_phase::database:           return database_us;
+      case profile_phase::signals:            return signals_us;
+      case profile_phase::other:              return other_us;
+   }
+   EOS_THROW( misc_exception, "unknown profile phase ${p}", ("p", static_cast<uint32_t>( phase )) );
+}
+
+void block_profiler::start_block( uint32_t block_num, bool produced ) {
+   abort_block();
+   _current = std::make_shared<block_profile>();
+   _current->block_num = block_num;
+   _current->produced = produced;
+   _start = _last = fc::time_point::now();
+}
+
+block_profile_ptr block_profiler::finish_block( const block_id_type& id, uint32_t transactions ) {
+   if( !_current )
+      return block_profile_ptr();
+   charge();
+
+   auto result = std::move( _current );
+   result->id = id;
+   result->transactions = transactions;
+   result->total_us = (_last - _start).count();
+   std::sort( result->actions.begin(), result->actions.end(), []( const action_profile& a, const action_profile& b ) {
+      return a.time_us > b.time_us;
+   } );
+
+   abort_block();
+   return result;
+}
+
+void block_profiler::abort_block() {
+   _current.reset();
+   _stack.clear();
+   _action_indices.clear();
+}
+
+size_t block_profiler::action_index( account_name receiver, action_name action ) {
+   auto itr = _action_indices.find( std::make_pair( receiver, action ) );
+   if( itr != _action_indices.end() )
+      return itr->second;
+   _current->actions.push_back( action_profile{ receiver, action } );
+   return _action_indices[std::make_pair( receiver, action )] = _current->actions.size() - 1;
+}
+
+void block_profiler::push( profile_phase phase, size_t action ) {
+   charge();
+   _stack.push_back( frame{ phase, action } );
+   if( action != npos )
+      ++_current->actions[action].count;
+}
+
+void block_profiler::pop() {
+   // a block started or finished within a scope, e.g. from a signal handler, leaves no frame to pop
+   if( !_current || _stack.empty() )
+      return;
+   charge();
+   _stack.pop_back();
+}
+
+void block_profiler::charge() {
+   const auto now = fc::time_point::now();
+   const int64_t elapsed = (now - _last).count();
+   _last = now;
+   if( _stack.empty() ) {
+      _current->other_us += elapsed;
+      return;
+   }
+   const auto& top = _stack.back();
+   _current->phase_us( top.phase ) += elapsed;
+   if( top.action != npos )
+      _current->actions[top.action].time_us += elapsed;
+}
+
+} } /// eosio::chain
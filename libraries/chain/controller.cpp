@@ -2,6 +2,7 @@
 #include <eosio/chain/transaction_context.hpp>
 
 #include <eosio/chain/block_log.hpp>
+#include <eosio/chain/block_profiler.hpp>
 #include <eosio/chain/fork_database.hpp>
 #include <eosio/chain/exceptions.hpp>
 
@@ -13,6 +14,8 @@
 #include <eosio/chain/generated_transaction_object.hpp>
 #include <eosio/chain/transaction_object.hpp>
 #include <eosio/chain/reversible_block_object.hpp>
+#include <eosio/chain/feature_activation_object.hpp>
+#include <eosio/chain/database_header_object.hpp>
 
 #include <eosio/chain/authorization_manager.hpp>
 #include <eosio/chain/resource_limits.hpp>
@@ -24,6 +27,11 @@
 #include <fc/scoped_exit.hpp>
 #include <fc/variant_object.hpp>
 
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <thread>
+
 namespace eosio { namespace chain {
 
 using resource_limits::resource_limits_manager;
@@ -36,7 +44,8 @@ using controller_index_set = index_set<
    block_summary_multi_index,
    transaction_multi_index,
    generated_transaction_multi_index,
-   table_id_multi_index
+   table_id_multi_index,
+   feature_activation_multi_index
 >;
 
 using contract_database_index_set = index_set<
@@ -103,6 +112,10 @@ struct pending_state {
 
    vector<action_receipt>             _actions;
 
+   vector<access_set>                 _state_access; ///< of each transaction receipt, if tracked
+
+   flat_set<account_name>             _set_code_accounts; ///< receiving a setcode action of the block
+
    controller::block_status           _block_status = controller::block_status::incomplete;
 
    optional<block_id_type>            _producer_block_id;
@@ -112,6 +125,109 @@ struct pending_state {
    }
 };
 
+/**
+ *  Reads the blocks to replay ahead of the main thread. A reader thread unpacks the blocks from the block log and
+ *  creates their block_state, while the thread pool creates the transaction metadata (ids and, when auth checks are
+ *  not skipped, recovered keys), so that replay on the main thread only needs to apply the blocks.
+ */
+class replay_reader {
+   public:
+      struct replay_block {
+         block_state_ptr                                 header_state;
+         std::future<vector<transaction_metadata_ptr>>   trx_metas;
+      };
+
+      replay_reader( const block_log& blog, boost::asio::thread_pool& thread_pool, const chain_id_type& chain_id,
+                     const block_state_ptr& head, bool force_all_checks, size_t max_read_ahead )
+      :blog( blog ), thread_pool( thread_pool ), chain_id( chain_id ), force_all_checks( force_all_checks ),
+       max_read_ahead( max_read_ahead ), reader( [this, head]() { read( head ); } )
+      {}
+
+      ~replay_reader() {
+         {
+            std::lock_guard<std::mutex> g( mtx );
+            stopping = true;
+         }
+         cv.notify_all();
+         reader.join();
+      }
+
+      /// @return false once all blocks of the block log have been returned
+      bool next( replay_block& rb ) {
+         std::unique_lock<std::mutex> lock( mtx );
+         cv.wait( lock, [this]() { return !queue.empty() || done; } );
+         if( queue.empty() ) {
+            if( except ) std::rethrow_exception( except );
+            return false;
+         }
+         rb = std::move( queue.front() );
+         queue.pop_front();
+         lock.unlock();
+         cv.notify_all();
+         return true;
+      }
+
+   private:
+      void read( block_state_ptr prev ) {
+         try {
+            const bool skip_validate_signee = !force_all_checks;
+            // auth checks of irreversible blocks are only done when all checks are forced
+            const bool recover_keys = force_all_checks;
+            while( auto b = blog.read_block_by_num( prev->block_num + 1 ) ) {
+               EOS_ASSERT( b->previous == prev->id, block_log_exception, "block log does not link at block ${n}",
+                           ("n", b->block_num()) );
+               auto header_state = std::make_shared<block_state>( *prev, b, skip_validate_signee );
+               auto trx_metas = async_thread_pool( thread_pool, [b, chain_id = chain_id, recover_keys]() {
+                  vector<transaction_metadata_ptr> result;
+                  result.reserve( b->transactions.size() );
+                  for( const auto& receipt : b->transactions ) {
+                     if( receipt.trx.contains<packed_transaction>() ) {
+                        auto mtrx = std::make_shared<transaction_metadata>(
+                              std::make_shared<packed_transaction>( receipt.trx.get<packed_transaction>() ) );
+                        if( recover_keys )
+                           mtrx->recover_keys( chain_id );
+                        result.emplace_back( std::move( mtrx ) );
+                     }
+                  }
+                  return result;
+               } );
+
+               {
+                  std::unique_lock<std::mutex> lock( mtx );
+                  cv.wait( lock, [this]() { return stopping || queue.size() < max_read_ahead; } );
+                  if( stopping ) break;
+                  queue.push_back( replay_block{ header_state, std::move( trx_metas ) } );
+               }
+               cv.notify_all();
+               prev = std::move( header_state );
+            }
+         } catch( ... ) {
+            std::lock_guard<std::mutex> g( mtx );
+            except = std::current_exception();
+         }
+         {
+            std::lock_guard<std::mutex> g( mtx );
+            done = true;
+         }
+         cv.notify_all();
+      }
+
+      const block_log&              blog;
+      boost::asio::thread_pool&     thread_pool;
+      const chain_id_type           chain_id;
+      const bool                    force_all_checks;
+      const size_t                  max_read_ahead;
+
+      std::mutex                    mtx;
+      std::condition_variable       cv;
+      deque<replay_block>           queue;
+      bool                          stopping = false;
+      bool                          done = false;
+      std::exception_ptr            except;
+
+      std::thread                   reader; ///< last, so that it starts after the members above are initialized
+};
+
 struct controller_impl {
    controller&                    self;
    chainbase::database            db;
@@ -133,6 +249,12 @@ struct controller_impl {
    bool                           trusted_producer_light_validation = false;
    uint32_t                       snapshot_head_block = 0;
    boost::asio::thread_pool       thread_pool;
+   block_profiler                 profiler;
+
+   static constexpr size_t        replay_read_ahead_blocks = 1000; ///< blocks unpacked ahead of the block being replayed
+
+   /// accounts receiving setcode in each reversible block by block number, precompiled once the block is irreversible
+   std::multimap<uint32_t, pair<block_id_type, flat_set<account_name>>> set_code_accounts;
 
    typedef pair<scope_name,action_name>                   handler_key;
    map< account_name, map<handler_key, apply_handler> >   apply_handlers;
@@ -164,6 +286,15 @@ struct controller_impl {
    }
 
 
+   static block_log_config make_block_log_config( const controller::config& cfg ) {
+      block_log_config result;
+      result.stride = cfg.blocks_log_stride;
+      result.max_retained_files = cfg.max_retained_block_files;
+      result.archive_dir = cfg.blocks_archive_dir;
+      result.retain_blocks = cfg.block_log_retain_blocks;
+      return result;
+   }
+
    void set_apply_handler( account_name receiver, account_name contract, action_name action, apply_handler v ) {
       apply_handlers[receiver][make_pair(contract,action)] = v;
    }
@@ -176,9 +307,9 @@ struct controller_impl {
     reversible_blocks( cfg.blocks_dir/config::reversible_blocks_dir_name,
         cfg.read_only ? database::read_only : database::read_write,
         cfg.reversible_cache_size ),
-    blog( cfg.blocks_dir ),
+    blog( cfg.blocks_dir, make_block_log_config( cfg ) ),
     fork_db( cfg.state_dir ),
-    wasmif( cfg.wasm_runtime ),
+    wasmif( cfg.wasm_runtime, cfg.wasm_cache_size, cfg.wasm_code_cache_dir, cfg.wasm_code_cache_size ),
     resource_limits( db ),
     authorization( s, db ),
     conf( cfg ),
@@ -205,8 +336,8 @@ struct controller_impl {
 
    SET_APP_HANDLER( eosio, eosio, canceldelay );
 
-   fork_db.irreversible.connect( [&]( auto b ) {
-                                 on_irreversible(b);
+   fork_db.irreversible.connect( [&]( const auto& blocks ) {
+                                 on_irreversible(blocks);
                                  });
 
    }
@@ -222,6 +353,7 @@ struct controller_impl {
     */
    template<typename Signal, typename Arg>
    void emit( const Signal& s, Arg&& a ) {
+      block_profiler::scope signals( profiler, profile_phase::signals );
       try {
         s(std::forward<Arg>(a));
       } catch (boost::interprocess::bad_alloc& e) {
@@ -237,46 +369,73 @@ struct controller_impl {
       }
    }
 
-   void on_irreversible( const block_state_ptr& s ) {
+   /**
+    * Commit consecutive blocks that became irreversible together, oldest first. A jump of the LIB is committed
+    * with one undo stack commit, one block log write and one pass over the reversible blocks, the
+    * irreversible_block signal is still emitted once per block.
+    */
+   void on_irreversible( const branch_type& blocks ) {
+      if( blocks.empty() )
+         return;
+
       if( !blog.head() )
          blog.read_head();
 
-      const auto& log_head = blog.head();
-      bool append_to_blog = false;
-      if (!log_head) {
-         if (s->block) {
-            EOS_ASSERT(s->block_num == blog.first_block_num(), block_log_exception, "block log has no blocks and is appending the wrong first block.  Expected ${expected}, but received: ${actual}",
-                      ("expected", blog.first_block_num())("actual", s->block_num));
-            append_to_blog = true;
+      signed_block_ptr log_head = blog.head();
+      vector<signed_block_ptr> append_to_blog;
+      append_to_blog.reserve( blocks.size() );
+      for( const auto& s : blocks ) {
+         if (!log_head) {
+            if (s->block) {
+               EOS_ASSERT(s->block_num == blog.first_block_num(), block_log_exception, "block log has no blocks and is appending the wrong first block.  Expected ${expected}, but received: ${actual}",
+                         ("expected", blog.first_block_num())("actual", s->block_num));
+               append_to_blog.push_back(s->block);
+               log_head = s->block;
+            } else {
+               EOS_ASSERT(s->block_num == blog.first_block_num() - 1, block_log_exception, "block log has no blocks and is not properly set up to start after the snapshot");
+            }
          } else {
-            EOS_ASSERT(s->block_num == blog.first_block_num() - 1, block_log_exception, "block log has no blocks and is not properly set up to start after the snapshot");
-         }
-      } else {
-         auto lh_block_num = log_head->block_num();
-         if (s->block_num > lh_block_num) {
-            EOS_ASSERT(s->block_num - 1 == lh_block_num, unlinkable_block_exception, "unlinkable block", ("s->block_num", s->block_num)("lh_block_num", lh_block_num));
-            EOS_ASSERT(s->block->previous == log_head->id(), unlinkable_block_exception, "irreversible doesn't link to block log head");
-            append_to_blog = true;
+            auto lh_block_num = log_head->block_num();
+            if (s->block_num > lh_block_num) {
+               EOS_ASSERT(s->block_num - 1 == lh_block_num, unlinkable_block_exception, "unlinkable block", ("s->block_num", s->block_num)("lh_block_num", lh_block_num));
+               EOS_ASSERT(s->block->previous == log_head->id(), unlinkable_block_exception, "irreversible doesn't link to block log head");
+               append_to_blog.push_back(s->block);
+               log_head = s->block;
+            }
          }
       }
 
-
-      db.commit( s->block_num );
-
-      if( append_to_blog ) {
-         blog.append(s->block);
+      const uint32_t lib_num = blocks.back()->block_num;
+      {
+         block_profiler::scope database( profiler, profile_phase::database );
+         db.commit( lib_num );
       }
 
+      blog.append( append_to_blog );
+
       const auto& ubi = reversible_blocks.get_index<reversible_block_index,by_num>();
       auto objitr = ubi.begin();
-      while( objitr != ubi.end() && objitr->blocknum <= s->block_num ) {
-         reversible_blocks.remove( *objitr );
-         objitr = ubi.begin();
+      while( objitr != ubi.end() && objitr->blocknum <= lib_num ) {
+         const auto& obj = *objitr;
+         ++objitr;
+         reversible_blocks.remove( obj );
+      }
+
+      for( const auto& s : blocks ) {
+         apply_irreversible( s );
       }
 
+      if (read_mode == db_read_mode::IRREVERSIBLE) {
+         // as when committing one block at a time, only the undo session of the last applied block is kept
+         db.commit( lib_num - 1 );
+      }
+   }
+
+   void apply_irreversible( const block_state_ptr& s ) {
       // the "head" block when a snapshot is loaded is virtual and has no block data, all of its effects
       // should already have been loaded from the snapshot so, it cannot be applied
       if (s->block) {
+
          if (read_mode == db_read_mode::IRREVERSIBLE) {
             // when applying a snapshot, head may not be present
             // when not applying a snapshot, make sure this is the next block
@@ -293,10 +452,75 @@ struct controller_impl {
             fork_db.mark_in_current_chain(head, true);
             fork_db.set_validity(head, true);
          }
+         if( !replaying )
+            precompile_set_code( *s );
          emit(self.irreversible_block, s);
       }
    }
 
+   /// compile the current code of accounts in the background, ahead of their next use
+   void precompile_contracts( const flat_set<account_name>& accounts, bool startup = false ) {
+      for( const auto& n : accounts ) {
+         const auto* a = db.find<account_object,by_name>( n );
+         if( a && a->code.size() > 0 )
+            wasmif.precompile( a->code_version, bytes( a->code.begin(), a->code.end() ), startup );
+      }
+   }
+
+   /// note the accounts receiving setcode in traces, including inline actions and deferred or msig transactions
+   void record_set_code( const vector<action_trace>& traces ) {
+      for( const auto& t : traces ) {
+         if( t.receipt.receiver == config::system_account_name && t.act.account == config::system_account_name && t.act.name == N(setcode) )
+            pending->_set_code_accounts.insert( fc::raw::unpack<account_name>( t.act.data ) ); // setcode starts with the account
+         record_set_code( t.inline_traces );
+      }
+   }
+
+   /// precompile the contracts set by an irreversible block, and forget the blocks it forked out
+   void precompile_set_code( const block_state& s ) {
+      auto end = set_code_accounts.upper_bound( s.block_num );
+      for( auto itr = set_code_accounts.begin(); itr != end; ++itr ) {
+         if( itr->second.first == s.id )
+            precompile_contracts( itr->second.second );
+      }
+      set_code_accounts.erase( set_code_accounts.begin(), end );
+   }
+
+   /// precompile the contracts receiving the most actions in the last blocks of the block log
+   void precompile_hot_contracts() {
+      if( conf.wasm_precompile_contracts == 0 || !blog.head() )
+         return;
+
+      std::map<account_name, uint32_t> actions_received;
+      const uint32_t last = blog.head()->block_num();
+      const uint32_t first = std::max( blog.first_block_num(),
+                                       last > config::wasm_precompile_lookback_blocks ? last - config::wasm_precompile_lookback_blocks + 1 : 1 );
+      for( uint32_t n = first; n <= last; ++n ) {
+         auto b = blog.read_block_by_num( n );
+         if( !b )
+            continue;
+         for( const auto& receipt : b->transactions ) {
+            if( !receipt.trx.contains<packed_transaction>() )
+               continue;
+            for( const auto& act : receipt.trx.get<packed_transaction>().get_transaction().actions ) {
+               ++actions_received[act.account];
+            }
+         }
+      }
+
+      vector<pair<uint32_t, account_name>> by_count;
+      for( const auto& c : actions_received )
+         by_count.emplace_back( c.second, c.first );
+      std::sort( by_count.begin(), by_count.end(), std::greater<pair<uint32_t, account_name>>() );
+      by_count.resize( std::min<size_t>( by_count.size(), conf.wasm_precompile_contracts ) );
+
+      flat_set<account_name> accounts;
+      for( const auto& c : by_count )
+         accounts.insert( c.second );
+      ilog( "precompiling ${n} contracts most used in blocks ${f} to ${l}", ("n", accounts.size())("f", first)("l", last) );
+      precompile_contracts( accounts, true );
+   }
+
    void replay(std::function<bool()> shutdown) {
       auto blog_head = blog.read_head();
       auto blog_head_time = blog_head->timestamp.to_time_point();
@@ -307,11 +531,19 @@ struct controller_impl {
             ("s", start_block_num)("n", blog_head->block_num()) );
 
       auto start = fc::time_point::now();
-      while( auto next = blog.read_block_by_num( head->block_num + 1 ) ) {
-         replay_push_block( next, controller::block_status::irreversible );
-         if( next->block_num() % 500 == 0 ) {
-            ilog( "${n} of ${head}", ("n", next->block_num())("head", blog_head->block_num()) );
-            if( shutdown() ) break;
+      {
+         // the irreversible blocks are all in the block log, the fork database is journaled once they are applied
+         fork_db.suspend_journal();
+         auto resume_journal = fc::make_scoped_exit( [this]() { fork_db.resume_journal(); } );
+         replay_reader reader( blog, thread_pool, chain_id, head, conf.force_all_checks, replay_read_ahead_blocks );
+         replay_reader::replay_block rb;
+         while( reader.next( rb ) ) {
+            const auto next = rb.header_state->block;
+            replay_push_block( next, controller::block_status::irreversible, rb.header_state, rb.trx_metas.get() );
+            if( next->block_num() % 500 == 0 ) {
+               ilog( "${n} of ${head}", ("n", next->block_num())("head", blog_head->block_num()) );
+               if( shutdown() ) break;
+            }
          }
       }
       ilog( "${n} blocks replayed", ("n", head->block_num - start_block_num) );
@@ -338,6 +570,15 @@ struct controller_impl {
 
    void init(std::function<bool()> shutdown, const snapshot_reader_ptr& snapshot) {
 
+      if( head && !snapshot ) { // an existing state database, new ones are created with a header below
+         const auto* header = db.find<database_header_object>();
+         EOS_ASSERT( header, bad_database_version_exception,
+                     "state database predates versioning, replay the blockchain or start from a snapshot" );
+         EOS_ASSERT( header->version == database_header_object::current_version, bad_database_version_exception,
+                     "state database version ${v} is not ${current}, replay the blockchain or start from a snapshot",
+                     ("v", header->version)("current", database_header_object::current_version) );
+      }
+
       bool report_integrity_hash = !!snapshot;
       if (snapshot) {
          EOS_ASSERT( !head, fork_database_exception, "" );
@@ -412,6 +653,7 @@ struct controller_impl {
    void add_indices() {
       reversible_blocks.add_index<reversible_block_index>();
 
+      db.add_index<database_header_multi_index>();
       controller_index_set::add_indices(db);
       contract_database_index_set::add_indices(db);
 
@@ -514,8 +756,8 @@ struct controller_impl {
    }
 
    void read_from_snapshot( const snapshot_reader_ptr& snapshot ) {
-      snapshot->read_section<chain_snapshot_header>([this]( auto &section ){
-         chain_snapshot_header header;
+      chain_snapshot_header header;
+      snapshot->read_section<chain_snapshot_header>([this, &header]( auto &section ){
          section.read_row(header, db);
          header.validate();
       });
@@ -533,7 +775,7 @@ struct controller_impl {
          snapshot_head_block = head->block_num;
       });
 
-      controller_index_set::walk_indices([this, &snapshot]( auto utils ){
+      controller_index_set::walk_indices([this, &snapshot, &header]( auto utils ){
          using value_t = typename decltype(utils)::index_t::value_type;
 
          // skip the table_id_object as its inlined with contract tables section
@@ -541,6 +783,11 @@ struct controller_impl {
             return;
          }
 
+         // no feature was activated before snapshots recorded them
+         if (std::is_same<value_t, feature_activation_object>::value && header.version < 2) {
+            return;
+         }
+
          snapshot->read_section<value_t>([this]( auto& section ) {
             bool more = !section.empty();
             while(more) {
@@ -554,8 +801,9 @@ struct controller_impl {
       read_contract_tables_from_snapshot(snapshot);
 
       authorization.read_from_snapshot(snapshot);
-      resource_limits.read_from_snapshot(snapshot);
+      resource_limits.read_from_snapshot(snapshot, header.version);
 
+      db.create<database_header_object>([](auto&){});
       db.set_revision( head->block_num );
    }
 
@@ -624,6 +872,8 @@ struct controller_impl {
    }
 
    void initialize_database() {
+      db.create<database_header_object>([](auto&){});
+
       // Initialize block summary index
       for (int i = 0; i < 0x10000; i++)
          db.create<block_summary_object>([&](block_summary_object&) {});
@@ -693,6 +943,18 @@ struct controller_impl {
          }
 
          emit( self.accepted_block, pending->_pending_block_state );
+
+         if( !replaying && !pending->_set_code_accounts.empty() ) {
+            set_code_accounts.emplace( pending->_pending_block_state->block_num,
+                                       std::make_pair( pending->_pending_block_state->id, std::move( pending->_set_code_accounts ) ) );
+         }
+
+         if( conf.track_state_access && !pending->_state_access.empty() ) {
+            auto waves = schedule_waves( pending->_state_access );
+            ilog( "block ${n}: ${t} transactions could execute in ${w} conflict-free waves",
+                  ("n", pending->_pending_block_state->block_num)("t", waves.size())
+                  ("w", *std::max_element( waves.begin(), waves.end() ) + 1) );
+         }
       } catch (...) {
          // dont bother resetting pending, instead abort the block
          reset_pending_on_exit.cancel();
@@ -701,7 +963,21 @@ struct controller_impl {
       }
 
       // push the state for pending.
-      pending->push();
+      {
+         block_profiler::scope database( profiler, profile_phase::database );
+         pending->push();
+      }
+
+      if( profiler.active() ) {
+         const auto& bsp = pending->_pending_block_state;
+         emit( self.block_profiled, profiler.finish_block( bsp->id, bsp->block->transactions.size() ) );
+      }
+   }
+
+   /// squashes the undo session of a transaction, as database time of the block being profiled
+   void squash( maybe_session& session ) {
+      block_profiler::scope database( profiler, profile_phase::database );
+      session.squash();
    }
 
    // The returned scoped_exit should not exceed the lifetime of the pending which existed when make_block_restore_point was called.
@@ -709,15 +985,18 @@ struct controller_impl {
       auto orig_block_transactions_size = pending->_pending_block_state->block->transactions.size();
       auto orig_state_transactions_size = pending->_pending_block_state->trxs.size();
       auto orig_state_actions_size      = pending->_actions.size();
+      auto orig_state_access_size       = pending->_state_access.size();
 
       std::function<void()> callback = [this,
                                         orig_block_transactions_size,
                                         orig_state_transactions_size,
-                                        orig_state_actions_size]()
+                                        orig_state_actions_size,
+                                        orig_state_access_size]()
       {
          pending->_pending_block_state->block->transactions.resize(orig_block_transactions_size);
          pending->_pending_block_state->trxs.resize(orig_state_transactions_size);
          pending->_actions.resize(orig_state_actions_size);
+         pending->_state_access.resize(orig_state_access_size);
       };
 
       return fc::make_scoped_exit( std::move(callback) );
@@ -740,6 +1019,7 @@ struct controller_impl {
       etrx.set_reference_block( self.head_block_id() );
 
       transaction_context trx_context( self, etrx, etrx.id(), start );
+      trx_context.track_state_access = conf.track_state_access;
       trx_context.deadline = deadline;
       trx_context.explicit_billed_cpu_time = explicit_billed_cpu_time;
       trx_context.billed_cpu_time_us = billed_cpu_time_us;
@@ -749,7 +1029,11 @@ struct controller_impl {
          trx_context.init_for_implicit_trx();
          trx_context.published = gtrx.published;
          trx_context.trace->action_traces.emplace_back();
-         trx_context.dispatch_action( trx_context.trace->action_traces.back(), etrx.actions.back(), gtrx.sender );
+         auto& onerror_trace = trx_context.trace->action_traces.back();
+         auto move_onerror = fc::make_scoped_exit([&](){ // etrx is discarded afterwards, so its action is moved into the trace
+            onerror_trace.act = std::move( etrx.actions.back() );
+         });
+         trx_context.dispatch_owned_action( onerror_trace, etrx.actions.back(), gtrx.sender );
          trx_context.finalize(); // Automatically rounds up network and CPU usage in trace and bills payers if successful
 
          auto restore = make_block_restore_point();
@@ -810,6 +1094,7 @@ struct controller_impl {
 
    transaction_trace_ptr push_scheduled_transaction( const generated_transaction_object& gto, fc::time_point deadline, uint32_t billed_cpu_time_us, bool explicit_billed_cpu_time = false )
    { try {
+      block_profiler::scope execution( profiler, profile_phase::execution );
       maybe_session undo_session;
       if ( !self.skip_db_sessions() )
          undo_session = maybe_session(db);
@@ -846,7 +1131,7 @@ struct controller_impl {
          trace->receipt = push_receipt( gtrx.trx_id, transaction_receipt::expired, billed_cpu_time_us, 0 ); // expire the transaction
          emit( self.accepted_transaction, trx );
          emit( self.applied_transaction, trace );
-         undo_session.squash();
+         squash( undo_session );
          return trace;
       }
 
@@ -857,7 +1142,8 @@ struct controller_impl {
 
       uint32_t cpu_time_to_bill_us = billed_cpu_time_us;
 
-      transaction_context trx_context( self, dtrx, gtrx.trx_id );
+      transaction_context trx_context( self, std::move(dtrx), gtrx.trx_id );
+      trx_context.track_state_access = conf.track_state_access;
       trx_context.leeway =  fc::microseconds(0); // avoid stealing cpu resource
       trx_context.deadline = deadline;
       trx_context.explicit_billed_cpu_time = explicit_billed_cpu_time;
@@ -882,12 +1168,13 @@ struct controller_impl {
                                         trace->net_usage );
 
          fc::move_append( pending->_actions, move(trx_context.executed) );
+         record_set_code( trace->action_traces );
 
          emit( self.accepted_transaction, trx );
          emit( self.applied_transaction, trace );
 
          trx_context.squash();
-         undo_session.squash();
+         squash( undo_session );
 
          restore.cancel();
 
@@ -913,7 +1200,7 @@ struct controller_impl {
          if( !trace->except_ptr ) {
             emit( self.accepted_transaction, trx );
             emit( self.applied_transaction, trace );
-            undo_session.squash();
+            squash( undo_session );
             return trace;
          }
          trace->elapsed = fc::time_point::now() - trx_context.start;
@@ -951,7 +1238,7 @@ struct controller_impl {
          emit( self.accepted_transaction, trx );
          emit( self.applied_transaction, trace );
 
-         undo_session.squash();
+         squash( undo_session );
       } else {
          emit( self.accepted_transaction, trx );
          emit( self.applied_transaction, trace );
@@ -966,9 +1253,16 @@ struct controller_impl {
     */
    template<typename T>
    const transaction_receipt& push_receipt( const T& trx, transaction_receipt_header::status_enum status,
-                                            uint64_t cpu_usage_us, uint64_t net_usage ) {
+                                            uint64_t cpu_usage_us, uint64_t net_usage,
+                                            const access_set* state_access = nullptr ) {
       uint64_t net_usage_words = net_usage / 8;
       EOS_ASSERT( net_usage_words*8 == net_usage, transaction_exception, "net_usage is not divisible by 8" );
+      if( conf.track_state_access ) {
+         // deferred transactions always remove their generated transaction, so they conflict with everything
+         access_set serial;
+         serial.serial = true;
+         pending->_state_access.emplace_back( state_access ? *state_access : serial );
+      }
       pending->_pending_block_state->block->transactions.emplace_back( trx );
       transaction_receipt& r = pending->_pending_block_state->block->transactions.back();
       r.cpu_usage_us         = cpu_usage_us;
@@ -991,11 +1285,15 @@ struct controller_impl {
 
       transaction_trace_ptr trace;
       try {
+         block_profiler::scope execution( profiler, profile_phase::execution );
          auto start = fc::time_point::now();
          const bool check_auth = !self.skip_auth_check() && !trx->implicit;
+         optional<block_profiler::scope> signature_recovery;
+         signature_recovery.emplace( profiler, profile_phase::signature_recovery );
          // call recover keys so that trx->sig_cpu_usage is set correctly
          const fc::microseconds sig_cpu_usage = check_auth ? std::get<0>( trx->recover_keys( chain_id ) ) : fc::microseconds();
          const flat_set<public_key_type>& recovered_keys = check_auth ? std::get<1>( trx->recover_keys( chain_id ) ) : flat_set<public_key_type>();
+         signature_recovery.reset();
          if( !explicit_billed_cpu_time ) {
             fc::microseconds already_consumed_time( EOS_PERCENT(sig_cpu_usage.count(), conf.sig_cpu_bill_pct) );
 
@@ -1008,6 +1306,7 @@ struct controller_impl {
 
          const signed_transaction& trn = trx->packed_trx->get_signed_transaction();
          transaction_context trx_context(self, trn, trx->id, start);
+         trx_context.track_state_access = conf.track_state_access;
          if ((bool)subjective_cpu_leeway && pending->_block_status == controller::block_status::incomplete) {
             trx_context.leeway = *subjective_cpu_leeway;
          }
@@ -1029,6 +1328,7 @@ struct controller_impl {
             trx_context.delay = fc::seconds(trn.delay_sec);
 
             if( check_auth ) {
+               block_profiler::scope authorization_check( profiler, profile_phase::authorization );
                authorization.check_authorization(
                        trn.actions,
                        recovered_keys,
@@ -1047,7 +1347,8 @@ struct controller_impl {
                transaction_receipt::status_enum s = (trx_context.delay == fc::seconds(0))
                                                     ? transaction_receipt::executed
                                                     : transaction_receipt::delayed;
-               trace->receipt = push_receipt(*trx->packed_trx, s, trx_context.billed_cpu_time_us, trace->net_usage);
+               trace->receipt = push_receipt(*trx->packed_trx, s, trx_context.billed_cpu_time_us, trace->net_usage,
+                                             &trx_context.state_access);
                pending->_pending_block_state->trxs.emplace_back(trx);
             } else {
                transaction_receipt_header r;
@@ -1058,6 +1359,7 @@ struct controller_impl {
             }
 
             fc::move_append(pending->_actions, move(trx_context.executed));
+            record_set_code( trace->action_traces );
 
             // call the accept signal but only once for this transaction
             if (!trx->accepted) {
@@ -1104,6 +1406,7 @@ struct controller_impl {
 
       auto guard_pending = fc::make_scoped_exit([this](){
          pending.reset();
+         profiler.abort_block();
       });
 
       if (!self.skip_db_sessions(s)) {
@@ -1120,6 +1423,9 @@ struct controller_impl {
       pending->_pending_block_state = std::make_shared<block_state>( *head, when ); // promotes pending schedule (if any) to active
       pending->_pending_block_state->in_current_chain = true;
 
+      if( conf.profile_blocks )
+         profiler.start_block( pending->_pending_block_state->block_num, s == controller::block_status::incomplete );
+
       pending->_pending_block_state->set_confirmed(confirm_block_count);
 
       auto was_pending_promoted = pending->_pending_block_state->maybe_promote_pending();
@@ -1182,22 +1488,29 @@ struct controller_impl {
       static_cast<signed_block_header&>(*p->block) = p->header;
    } /// sign_block
 
-   void apply_block( const signed_block_ptr& b, controller::block_status s ) { try {
+   /**
+    * @param trx_metas metadata of the packed transactions of b, in block order, if it was already created
+    */
+   void apply_block( const signed_block_ptr& b, controller::block_status s,
+                     vector<transaction_metadata_ptr> trx_metas = vector<transaction_metadata_ptr>() ) { try {
       try {
          EOS_ASSERT( b->block_extensions.size() == 0, block_validate_exception, "no supported extensions" );
          auto producer_block_id = b->id();
          start_block( b->timestamp, b->confirmed, s , producer_block_id);
 
-         std::vector<transaction_metadata_ptr> packed_transactions;
-         packed_transactions.reserve( b->transactions.size() );
-         for( const auto& receipt : b->transactions ) {
-            if( receipt.trx.contains<packed_transaction>()) {
-               auto& pt = receipt.trx.get<packed_transaction>();
-               auto mtrx = std::make_shared<transaction_metadata>( std::make_shared<packed_transaction>( pt ) );
-               if( !self.skip_auth_check() ) {
-                  transaction_metadata::start_recover_keys( mtrx, thread_pool, chain_id, microseconds::maximum() );
+         std::vector<transaction_metadata_ptr> packed_transactions = std::move( trx_metas );
+         if( packed_transactions.empty() ) {
+            block_profiler::scope deserialization( profiler, profile_phase::deserialization );
+            packed_transactions.reserve( b->transactions.size() );
+            for( const auto& receipt : b->transactions ) {
+               if( receipt.trx.contains<packed_transaction>()) {
+                  auto& pt = receipt.trx.get<packed_transaction>();
+                  auto mtrx = std::make_shared<transaction_metadata>( std::make_shared<packed_transaction>( pt ) );
+                  if( !self.skip_auth_check() ) {
+                     transaction_metadata::start_recover_keys( mtrx, thread_pool, chain_id, microseconds::maximum() );
+                  }
+                  packed_transactions.emplace_back( std::move( mtrx ) );
                }
-               packed_transactions.emplace_back( std::move( mtrx ) );
             }
          }
 
@@ -1305,7 +1618,13 @@ struct controller_impl {
       } FC_LOG_AND_RETHROW( )
    }
 
-   void replay_push_block( const signed_block_ptr& b, controller::block_status s ) {
+   /**
+    * @param header_state block_state of b, if it was already created
+    * @param trx_metas metadata of the packed transactions of b, if it was already created
+    */
+   void replay_push_block( const signed_block_ptr& b, controller::block_status s,
+                           const block_state_ptr& header_state = block_state_ptr(),
+                           vector<transaction_metadata_ptr> trx_metas = vector<transaction_metadata_ptr>() ) {
       self.validate_db_available_size();
       self.validate_reversible_available_size();
 
@@ -1316,13 +1635,18 @@ struct controller_impl {
          EOS_ASSERT( (s == controller::block_status::irreversible || s == controller::block_status::validated),
                      block_validate_exception, "invalid block status for replay" );
          emit( self.pre_accepted_block, b );
-         const bool skip_validate_signee = !conf.force_all_checks;
-         auto new_header_state = fork_db.add( b, skip_validate_signee );
+         block_state_ptr new_header_state;
+         if( header_state ) {
+            new_header_state = fork_db.add( header_state, false );
+         } else {
+            const bool skip_validate_signee = !conf.force_all_checks;
+            new_header_state = fork_db.add( b, skip_validate_signee );
+         }
 
          emit( self.accepted_block_header, new_header_state );
 
          if ( read_mode != db_read_mode::IRREVERSIBLE ) {
-            maybe_switch_forks( s );
+            maybe_switch_forks( s, std::move( trx_metas ) );
          }
 
          // on replay irreversible is not emitted by fork database, so emit it explicitly here
@@ -1332,12 +1656,13 @@ struct controller_impl {
       } FC_LOG_AND_RETHROW( )
    }
 
-   void maybe_switch_forks( controller::block_status s ) {
+   void maybe_switch_forks( controller::block_status s,
+                            vector<transaction_metadata_ptr> trx_metas = vector<transaction_metadata_ptr>() ) {
       auto new_head = fork_db.head();
 
       if( new_head->header.previous == head->id ) {
          try {
-            apply_block( new_head->block, s );
+            apply_block( new_head->block, s, std::move( trx_metas ) );
             fork_db.mark_in_current_chain( new_head, true );
             fork_db.set_validity( new_head, true );
             head = new_head;
@@ -1404,6 +1729,7 @@ struct controller_impl {
          }
          pending.reset();
       }
+      profiler.abort_block();
    }
 
 
@@ -1744,6 +2070,8 @@ void controller::startup( std::function<bool()> shutdown, const snapshot_reader_
          elog( "db storage not configured to have enough storage for the provided snapshot, please increase and retry snapshot" );
       throw e;
    }
+   my->wasmif.precompile_hot_list();
+   my->precompile_hot_contracts();
    if( snapshot ) {
       ilog( "Finished initialization from snapshot" );
    }
@@ -1917,6 +2245,34 @@ block_id_type controller::last_irreversible_block_id() const {
 
 }
 
+void controller::activate_feature( name feature ) {
+   static const std::set<name> supported_features = {
+      config::batch_db_iteration_feature
+   };
+
+   EOS_ASSERT( my->pending, block_validate_exception, "it is not valid to activate a feature when there is no pending block" );
+   EOS_ASSERT( my->pending->_pending_block_state->block_num >= my->conf.feature_activation_block_num, unsupported_feature,
+               "Unsupported Hardfork Detected" );
+   EOS_ASSERT( supported_features.count( feature ), unsupported_feature, "Unsupported Hardfork Detected" );
+   EOS_ASSERT( !my->db.find<feature_activation_object, by_feature>( feature ), feature_already_activated,
+               "feature ${f} is already activated or pending activation", ("f", feature) );
+
+   my->db.create<feature_activation_object>( [&]( auto& fa ) {
+      fa.feature = feature;
+      fa.activation_block_num = my->pending->_pending_block_state->block_num;
+   });
+}
+
+bool controller::is_feature_active( name feature )const {
+   const auto& bs = my->pending ? my->pending->_pending_block_state : my->head;
+   if( bs->block_num < my->conf.feature_activation_block_num ) return false;
+
+   const auto* fa = my->db.find<feature_activation_object, by_feature>( feature );
+   if( !fa ) return false;
+
+   return fa->activation_block_num <= bs->dpos_irreversible_blocknum;
+}
+
 const dynamic_global_property_object& controller::get_dynamic_global_properties()const {
   return my->db.get<dynamic_global_property_object>();
 }
@@ -2113,6 +2469,10 @@ wasm_interface& controller::get_wasm_interface() {
    return my->wasmif;
 }
 
+block_profiler& controller::get_block_profiler() {
+   return my->profiler;
+}
+
 const account_object& controller::get_account( account_name name )const
 { try {
    return my->db.get<account_object, by_name>(name);
@@ -322,6 +322,7 @@ void apply_eosio_linkauth(apply_context& context) {
 
       auto link_key = boost::make_tuple(requirement.account, requirement.code, requirement.type);
       auto link = db.find<permission_link_object, by_action_name>(link_key);
+      context.control.get_mutable_authorization_manager().invalidate_authorization_cache();
 
       if( link ) {
          EOS_ASSERT(link->required_permission != requirement.requirement, action_validate_exception,
@@ -362,6 +363,7 @@ void apply_eosio_unlinkauth(apply_context& context) {
       -(int64_t)(config::billable_size_v<permission_link_object>)
    );
 
+   context.control.get_mutable_authorization_manager().invalidate_authorization_cache();
    db.remove(*link);
 }
 
@@ -7,7 +7,11 @@
 #include <boost/multi_index/mem_fun.hpp>
 #include <boost/multi_index/composite_key.hpp>
 #include <fc/io/fstream.hpp>
+#include <boost/filesystem.hpp>
 #include <fstream>
+#include <algorithm>
+#include <cstring>
+#include <limits>
 
 namespace eosio { namespace chain {
    using boost::multi_index_container;
@@ -42,10 +46,233 @@ namespace eosio { namespace chain {
    > fork_multi_index_type;
 
 
+   namespace detail {
+
+      /// record types of the fork database journal
+      enum class journal_op : uint8_t {
+         add          = 0, ///< a block_state
+         remove       = 1, ///< a block id
+         status       = 2, ///< a block_status_record
+         confirmation = 3, ///< a header_confirmation
+         head         = 4  ///< a block id
+      };
+
+      struct block_status_record {
+         block_id_type  id;
+         bool           validated = false;
+         bool           in_current_chain = false;
+         uint32_t       bft_irreversible_blocknum = 0;
+      };
+
+   }
+
+} } /// eosio::chain
+
+FC_REFLECT( eosio::chain::detail::block_status_record, (id)(validated)(in_current_chain)(bft_irreversible_blocknum) )
+
+namespace eosio { namespace chain {
+   using detail::journal_op;
+   using detail::block_status_record;
+
+   /**
+    * Every change to the database is appended to a journal so that it survives a crash. The journal is
+    * rewritten with only the live states once most of it is obsolete.
+    *
+    * Each block state links to its previous block state and to an older ancestor chosen as in a skip list:
+    * the ancestor of any block number is found in a logarithmic number of steps.
+    */
    struct fork_database_impl {
       fork_multi_index_type index;
       block_state_ptr       head;
       fc::path              datadir;
+
+      std::ofstream         journal;
+      bool                  journaling = false;
+      bool                  suspended = false;
+      uint64_t              journal_size = 0; ///< bytes
+      uint64_t              compacted_size = 0; ///< bytes of the journal when it was last rewritten
+
+      static constexpr uint64_t min_compact_size = 1024*1024;
+
+      /// block number the skip link of a block with this number points to, as in bitcoin's skip list
+      static uint32_t skip_num( uint32_t num ) {
+         auto invert_lowest_one = []( uint32_t n ) { return n & (n - 1); };
+         if( num < 2 )
+            return 0;
+         return (num & 1) ? invert_lowest_one( invert_lowest_one( num - 1 ) ) + 1 : invert_lowest_one( num );
+      }
+
+      void link( const block_state_ptr& s ) {
+         auto prev = index.find( s->header.previous );
+         if( prev == index.end() )
+            return;
+         s->prev_block_state = *prev;
+         s->skip_block_state = ancestor( *prev, skip_num( s->block_num ) );
+      }
+
+      /// @return the ancestor of s numbered num, null if it is not linked
+      block_state_ptr ancestor( block_state_ptr s, uint32_t num )const {
+         while( s && s->block_num > num ) {
+            const auto skip = skip_num( s->block_num );
+            const auto skip_prev = skip_num( s->block_num - 1 );
+            auto skip_state = s->skip_block_state.lock();
+            // only take the skip link if the skip link of the previous block would not get closer to num
+            if( skip_state && (skip == num || (skip > num && !(skip_prev + 2 < skip && skip_prev >= num))) )
+               s = std::move( skip_state );
+            else
+               s = s->prev_block_state.lock();
+         }
+         return s;
+      }
+
+      template<typename T>
+      void write( journal_op op, const T& v ) {
+         if( !journaling )
+            return;
+         const auto data = fc::raw::pack( v );
+         const uint32_t size = data.size();
+         journal.put( static_cast<char>( op ) );
+         journal.write( reinterpret_cast<const char*>( &size ), sizeof( size ) );
+         journal.write( data.data(), data.size() );
+         journal.flush();
+         journal_size += 1 + sizeof( size ) + data.size();
+         maybe_compact();
+      }
+
+      void write_status( const block_state& s ) {
+         write( journal_op::status, block_status_record{ s.id, s.validated, s.in_current_chain, s.bft_irreversible_blocknum } );
+      }
+
+      void set_head( const block_state_ptr& h ) {
+         if( h == head )
+            return;
+         head = h;
+         if( head )
+            write( journal_op::head, head->id );
+      }
+
+      void open_journal() {
+         const auto file = datadir / config::forkdb_journal_filename;
+         journal.exceptions( std::ofstream::failbit | std::ofstream::badbit );
+         journal.open( file.generic_string().c_str(), std::ios::out | std::ios::binary | std::ios::app );
+         journaling = true;
+      }
+
+      /// replays the journal, a record torn by a crash and everything after it is dropped
+      void read_journal() {
+         const auto file = datadir / config::forkdb_journal_filename;
+         string content;
+         fc::read_file_contents( file, content );
+
+         uint64_t valid_size = 0;
+         while( valid_size < content.size() ) {
+            uint32_t size = 0;
+            const uint64_t header_size = 1 + sizeof( size );
+            if( content.size() - valid_size < header_size )
+               break;
+            const auto op = static_cast<journal_op>( content[valid_size] );
+            memcpy( &size, content.data() + valid_size + 1, sizeof( size ) );
+            if( content.size() - valid_size - header_size < size )
+               break;
+            try {
+               fc::datastream<const char*> ds( content.data() + valid_size + header_size, size );
+               apply( op, ds );
+            } catch( const fc::exception& e ) {
+               wlog( "invalid fork database journal record: ${e}", ("e", e.to_string()) );
+               break;
+            }
+            valid_size += header_size + size;
+         }
+         journal_size = valid_size;
+
+         if( valid_size < content.size() ) {
+            wlog( "dropping ${n} bytes at the end of the fork database journal", ("n", content.size() - valid_size) );
+            boost::filesystem::resize_file( file, valid_size );
+         }
+         if( !head && index.size() )
+            head = *index.get<by_lib_block_num>().begin();
+      }
+
+      void apply( journal_op op, fc::datastream<const char*>& ds ) {
+         switch( op ) {
+            case journal_op::add: {
+               auto s = std::make_shared<block_state>();
+               fc::raw::unpack( ds, *s );
+               if( index.insert( s ).second )
+                  link( s );
+               break;
+            }
+            case journal_op::remove: {
+               block_id_type id;
+               fc::raw::unpack( ds, id );
+               index.erase( id );
+               break;
+            }
+            case journal_op::status: {
+               block_status_record r;
+               fc::raw::unpack( ds, r );
+               auto itr = index.find( r.id );
+               if( itr != index.end() ) {
+                  index.modify( itr, [&]( auto& bsp ) {
+                     bsp->validated = r.validated;
+                     bsp->in_current_chain = r.in_current_chain;
+                     bsp->bft_irreversible_blocknum = r.bft_irreversible_blocknum;
+                  });
+               }
+               break;
+            }
+            case journal_op::confirmation: {
+               header_confirmation c;
+               fc::raw::unpack( ds, c );
+               auto itr = index.find( c.block_id );
+               if( itr != index.end() )
+                  (*itr)->confirmations.emplace_back( std::move( c ) );
+               break;
+            }
+            case journal_op::head: {
+               block_id_type id;
+               fc::raw::unpack( ds, id );
+               auto itr = index.find( id );
+               head = itr != index.end() ? *itr : block_state_ptr();
+               break;
+            }
+            default:
+               EOS_THROW( fork_database_exception, "unknown fork database journal record ${op}", ("op", uint32_t(op)) );
+         }
+      }
+
+      /// rewrites the journal with the states currently in the database
+      void compact() {
+         const auto file = datadir / config::forkdb_journal_filename;
+         const auto temp_file = fc::path( file.generic_string() + ".tmp" );
+         if( journal.is_open() )
+            journal.close();
+         journaling = false;
+
+         journal.open( temp_file.generic_string().c_str(), std::ios::out | std::ios::binary | std::ios::trunc );
+         journaling = true;
+         journal_size = 0;
+         compacted_size = std::numeric_limits<uint64_t>::max(); // no compaction while the journal is rewritten
+         // previous blocks are written first so that they are linked when the journal is replayed
+         for( const auto& s : index.get<by_block_num>() ) {
+            write( journal_op::add, *s );
+         }
+         if( head )
+            write( journal_op::head, head->id );
+         journal.close();
+         journaling = false;
+         compacted_size = journal_size;
+
+         fc::rename( temp_file, file );
+         open_journal();
+      }
+
+      /// compact once the journal is mostly records that are no longer live
+      void maybe_compact() {
+         if( journaling && compacted_size != std::numeric_limits<uint64_t>::max()
+             && journal_size > 2 * compacted_size + min_compact_size )
+            compact();
+      }
    };
 
 
@@ -56,7 +283,9 @@ namespace eosio { namespace chain {
          fc::create_directories(my->datadir);
 
       auto fork_db_dat = my->datadir / config::forkdb_filename;
+      auto fork_db_log = my->datadir / config::forkdb_journal_filename;
       if( fc::exists( fork_db_dat ) ) {
+         // written at shutdown by versions without the journal
          string content;
          fc::read_file_contents( fork_db_dat, content );
 
@@ -72,24 +301,42 @@ namespace eosio { namespace chain {
 
          my->head = get_block( head_id );
 
+         // the file is in no particular order, link the states once they are all known
+         for( const auto& s : my->index.get<by_block_num>() )
+            my->link( s );
+         my->compact();
          fc::remove( fork_db_dat );
+      } else {
+         if( fc::exists( fork_db_log ) )
+            my->read_journal();
+         my->open_journal();
+         my->maybe_compact();
       }
    }
 
+   void fork_database::suspend_journal() {
+      if( !my->journaling )
+         return;
+      my->journal.close();
+      my->journaling = false;
+      my->suspended = true;
+   }
+
+   void fork_database::resume_journal() {
+      if( !my->suspended )
+         return;
+      my->suspended = false;
+      my->compact();
+   }
+
    void fork_database::close() {
+      my->suspended = false;
       if( my->index.size() == 0 ) return;
 
-      auto fork_db_dat = my->datadir / config::forkdb_filename;
-      std::ofstream out( fork_db_dat.generic_string().c_str(), std::ios::out | std::ios::binary | std::ofstream::trunc );
-      uint32_t num_blocks_in_fork_db = my->index.size();
-      fc::raw::pack( out, unsigned_int{num_blocks_in_fork_db} );
-      for( const auto& s : my->index ) {
-         fc::raw::pack( out, *s );
-      }
-      if( my->head )
-         fc::raw::pack( out, my->head->id );
-      else
-         fc::raw::pack( out, block_id_type() );
+      // the journal keeps the states as they are now, including the block pruned below
+      my->compact();
+      my->journal.close();
+      my->journaling = false;
 
       /// we don't normally indicate the head block as irreversible
       /// we cannot normally prune the lib if it is the head block because
@@ -116,10 +363,12 @@ namespace eosio { namespace chain {
          //FC_ASSERT( s->block_num == s->header.block_num() );
 
       EOS_ASSERT( result.second, fork_database_exception, "unable to insert block state, duplicate state detected" );
+      my->link( s );
+      my->write( journal_op::add, *s );
       if( !my->head ) {
-         my->head =  s;
+         my->set_head( s );
       } else if( my->head->block_num < s->block_num ) {
-         my->head =  s;
+         my->set_head( s );
       }
    }
 
@@ -140,8 +389,10 @@ namespace eosio { namespace chain {
 
       auto inserted = my->index.insert(n);
       EOS_ASSERT( inserted.second, fork_database_exception, "duplicate block added?" );
+      my->link( n );
+      my->write( journal_op::add, *n );
 
-      my->head = *(--my->index.get<by_block_num>().end());
+      my->set_head( *(--my->index.get<by_block_num>().end()) );
 
       auto lib    = my->head->dpos_irreversible_blocknum;
       auto oldest = *my->index.get<by_block_num>().begin();
@@ -178,41 +429,61 @@ namespace eosio { namespace chain {
    pair< branch_type, branch_type >  fork_database::fetch_branch_from( const block_id_type& first,
                                                                        const block_id_type& second )const {
       pair<branch_type,branch_type> result;
-      auto first_branch = get_block(first);
-      auto second_branch = get_block(second);
-
-      while( first_branch->block_num > second_branch->block_num )
-      {
-         result.first.push_back(first_branch);
-         first_branch = get_block( first_branch->header.previous );
-         EOS_ASSERT( first_branch, fork_db_block_not_found, "block ${id} does not exist", ("id", string(first_branch->header.previous)) );
-      }
+      auto first_head = get_block(first);
+      auto second_head = get_block(second);
+      EOS_ASSERT( first_head, fork_db_block_not_found, "block ${id} does not exist", ("id", string(first)) );
+      EOS_ASSERT( second_head, fork_db_block_not_found, "block ${id} does not exist", ("id", string(second)) );
+
+      // both branches end at the highest block number at which their blocks build on the same previous block,
+      // blocks below it build on the same previous blocks too so the number is found by bisection
+      auto same_previous = [&]( uint32_t num ) {
+         auto first_ancestor = my->ancestor( first_head, num );
+         auto second_ancestor = my->ancestor( second_head, num );
+         EOS_ASSERT( first_ancestor && second_ancestor, fork_db_block_not_found,
+                     "block ${num} of either branch ${fid} or ${sid} does not exist",
+                     ("num", num)("fid", string(first))("sid", string(second)) );
+         return first_ancestor->header.previous == second_ancestor->header.previous;
+      };
 
-      while( second_branch->block_num > first_branch->block_num )
-      {
-         result.second.push_back( second_branch );
-         second_branch = get_block( second_branch->header.previous );
-         EOS_ASSERT( second_branch, fork_db_block_not_found, "block ${id} does not exist", ("id", string(second_branch->header.previous)) );
+      uint32_t end_num = std::min( first_head->block_num, second_head->block_num );
+      if( !same_previous( end_num ) ) {
+         uint32_t lo = (*my->index.get<by_block_num>().begin())->block_num;
+         uint32_t hi = end_num;
+         EOS_ASSERT( lo < hi && same_previous( lo ), fork_database_exception,
+                     "blocks ${fid} and ${sid} have no common ancestor", ("fid", string(first))("sid", string(second)) );
+         while( hi - lo > 1 ) {
+            const uint32_t mid = lo + (hi - lo) / 2;
+            if( same_previous( mid ) )
+               lo = mid;
+            else
+               hi = mid;
+         }
+         end_num = lo;
       }
 
-      while( first_branch->header.previous != second_branch->header.previous )
-      {
-         result.first.push_back(first_branch);
-         result.second.push_back(second_branch);
-         first_branch = get_block( first_branch->header.previous );
-         second_branch = get_block( second_branch->header.previous );
-         EOS_ASSERT( first_branch && second_branch, fork_db_block_not_found,
-                     "either block ${fid} or ${sid} does not exist",
-                     ("fid", string(first_branch->header.previous))("sid", string(second_branch->header.previous)) );
-      }
+      auto collect = [&]( block_state_ptr s, branch_type& branch ) {
+         branch.reserve( s->block_num - end_num + 1 );
+         for( ;; ) {
+            branch.push_back( s );
+            if( s->block_num == end_num )
+               break;
+            auto prev = s->prev_block_state.lock();
+            EOS_ASSERT( prev, fork_db_block_not_found, "block ${id} does not exist", ("id", string(s->header.previous)) );
+            s = std::move( prev );
+         }
+      };
+      collect( first_head, result.first );
+      collect( second_head, result.second );
+      return result;
+   } /// fetch_branch_from
 
-      if( first_branch && second_branch )
-      {
-         result.first.push_back(first_branch);
-         result.second.push_back(second_branch);
+   branch_type fork_database::fetch_branch( const block_id_type& h, uint32_t trim_after_block_num )const {
+      branch_type result;
+      for( auto s = get_block( h ); s && s->block_num > trim_after_block_num; s = s->prev_block_state.lock() ) {
+         result.push_back( s );
       }
       return result;
-   } /// fetch_branch_from
+   }
 
    /// remove all of the invalid forks built of this id including this id
    void fork_database::remove( const block_id_type& id ) {
@@ -220,8 +491,10 @@ namespace eosio { namespace chain {
 
       for( uint32_t i = 0; i < remove_queue.size(); ++i ) {
          auto itr = my->index.find( remove_queue[i] );
-         if( itr != my->index.end() )
+         if( itr != my->index.end() ) {
             my->index.erase(itr);
+            my->write( journal_op::remove, remove_queue[i] );
+         }
 
          auto& previdx = my->index.get<by_prev>();
          auto  previtr = previdx.lower_bound(remove_queue[i]);
@@ -231,7 +504,7 @@ namespace eosio { namespace chain {
          }
       }
       //wdump((my->index.size()));
-      my->head = *my->index.get<by_lib_block_num>().begin();
+      my->set_head( *my->index.get<by_lib_block_num>().begin() );
    }
 
    void fork_database::set_validity( const block_state_ptr& h, bool valid ) {
@@ -240,6 +513,7 @@ namespace eosio { namespace chain {
       } else {
          /// remove older than irreversible and mark block as valid
          h->validated = true;
+         my->write_status( *h );
       }
    }
 
@@ -254,32 +528,38 @@ namespace eosio { namespace chain {
       by_id_idx.modify( itr, [&]( auto& bsp ) { // Need to modify this way rather than directly so that Boost MultiIndex can re-sort
          bsp->in_current_chain = in_current_chain;
       });
+      my->write_status( *h );
    }
 
    void fork_database::prune( const block_state_ptr& h ) {
       auto num = h->block_num;
 
-      auto& by_bn = my->index.get<by_block_num>();
-      auto bni = by_bn.begin();
-      while( bni != by_bn.end() && (*bni)->block_num < num ) {
-         prune( *bni );
-         bni = by_bn.begin();
+      // h and all of its ancestors still in the database become irreversible together
+      branch_type irreversible_blocks;
+      const auto& by_id_idx = my->index.get<by_block_id>();
+      for( auto itr = by_id_idx.find( h->id ); itr != by_id_idx.end(); itr = by_id_idx.find( (*itr)->header.previous ) ) {
+         irreversible_blocks.push_back( *itr );
       }
+      std::reverse( irreversible_blocks.begin(), irreversible_blocks.end() );
 
-      auto itr = my->index.find( h->id );
-      if( itr != my->index.end() ) {
-         irreversible(*itr);
-         my->index.erase(itr);
+      if( !irreversible_blocks.empty() )
+         irreversible( irreversible_blocks );
+
+      for( const auto& b : irreversible_blocks ) {
+         my->index.erase( b->id );
+         my->write( journal_op::remove, b->id );
       }
 
+      // anything left at or below num is on a fork that can no longer become irreversible
       auto& numidx = my->index.get<by_block_num>();
-      auto nitr = numidx.lower_bound( num );
-      while( nitr != numidx.end() && (*nitr)->block_num == num ) {
-         auto itr_to_remove = nitr;
-         ++nitr;
-         auto id = (*itr_to_remove)->id;
+      auto nitr = numidx.begin();
+      while( nitr != numidx.end() && (*nitr)->block_num <= num ) {
+         auto id = (*nitr)->id;
          remove( id );
+         nitr = numidx.begin();
       }
+
+      my->maybe_compact();
    }
 
    block_state_ptr   fork_database::get_block(const block_id_type& id)const {
@@ -306,6 +586,7 @@ namespace eosio { namespace chain {
       auto b = get_block( c.block_id );
       EOS_ASSERT( b, fork_db_block_not_found, "unable to find block id ${id}", ("id",c.block_id));
       b->add_confirmation( c );
+      my->write( journal_op::confirmation, c );
 
       if( b->bft_irreversible_blocknum < b->block_num &&
          b->confirmations.size() >= ((b->active_schedule.producers.size() * 2) / 3 + 1) ) {
@@ -343,6 +624,7 @@ namespace eosio { namespace chain {
       idx.modify( itr, [&]( auto& bsp ) {
            bsp->bft_irreversible_blocknum = bsp->block_num;
       });
+      my->write_status( **itr );
 
       /** to prevent stack-overflow, we perform a bredth-first traversal of the
        * fork database. At each stage we iterate over the leafs from the prior stage
@@ -358,12 +640,18 @@ namespace eosio { namespace chain {
             auto pitr  = pidx.lower_bound( i );
             auto epitr = pidx.upper_bound( i );
             while( pitr != epitr ) {
+               bool raised = false;
                pidx.modify( pitr, [&]( auto& bsp ) {
                  if( bsp->bft_irreversible_blocknum < block_num ) {
                     bsp->bft_irreversible_blocknum = block_num;
-                    updated.push_back( bsp->id );
+                    raised = true;
                  }
                });
+               // written once the index is consistent again, writing may compact the journal
+               if( raised ) {
+                  updated.push_back( (*pitr)->id );
+                  my->write_status( **pitr );
+               }
                ++pitr;
             }
          }
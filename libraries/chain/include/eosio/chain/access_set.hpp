@@ -0,0 +1,85 @@
+/**
+ *  @file
+ *  @copyright defined in eos/LICENSE
+ */
+#pragma once
+#include <eosio/chain/types.hpp>
+
+namespace eosio { namespace chain {
+
+   struct transaction;
+
+   /**
+    * A contract table, or a pseudo table of the system account standing for per-account state kept outside of
+    * contract tables (e.g. RAM and bandwidth usage).
+    */
+   struct state_key {
+      account_name code;
+      scope_name   scope;
+      table_name   table;
+
+      friend bool operator < ( const state_key& a, const state_key& b ) {
+         return std::tie( a.code, a.scope, a.table ) < std::tie( b.code, b.scope, b.table );
+      }
+      friend bool operator == ( const state_key& a, const state_key& b ) {
+         return std::tie( a.code, a.scope, a.table ) == std::tie( b.code, b.scope, b.table );
+      }
+   };
+
+   /**
+    * The state read and written by a transaction, tracked by apply_context when enabled in the transaction_context.
+    *
+    * Action receipt sequence numbers are not tracked, they are counters that can be assigned when transactions are
+    * committed in block order. State that is not tracked per table (accounts, permissions, code, deferred
+    * transactions, global properties, producer schedule and features) is only changed by native handlers, deferred
+    * transactions and privileged intrinsics, which mark the set as serial. Resource limits set by a privileged
+    * contract are recorded as writes of that account's ram and bandwidth, and read by get_resource_limits.
+    *
+    * Billing reads and writes the ram and bandwidth of the billed accounts. The weight totals and virtual limits it
+    * also reads only change between blocks. The block-wide cpu and net totals are treated like sequence numbers: the
+    * receipts of a block carry the cpu and net billed to each transaction, so the totals a transaction sees in block
+    * order are known before it executes.
+    */
+   struct access_set {
+      flat_set<state_key>  reads;
+      flat_set<state_key>  writes;
+      bool                 serial = false; ///< conflicts with every other transaction
+
+      void record_read( account_name code, scope_name scope, table_name table ) {
+         reads.insert( state_key{code, scope, table} );
+      }
+      void record_write( account_name code, scope_name scope, table_name table ) {
+         writes.insert( state_key{code, scope, table} );
+      }
+
+      bool conflicts_with( const access_set& other )const;
+   };
+
+   /**
+    * Assign each transaction, in block order, to the first wave after all earlier transactions it conflicts with.
+    * Transactions of the same wave touch no state written by another one of them, so they could execute concurrently
+    * and still produce the receipts of executing the block in order. This only measures the parallelism of a block,
+    * the controller executes its transactions sequentially.
+    *
+    * @return the wave of each transaction, starting at 0
+    */
+   vector<uint32_t> schedule_waves( const vector<access_set>& transactions );
+
+   /**
+    * The state a transaction can be expected to access before it is executed: any table of the contracts receiving
+    * its actions, and the bandwidth of the actors authorizing them. Inline actions and notified accounts are not
+    * known until the transaction executes.
+    */
+   access_set predict_access( const transaction& trx );
+
+   /**
+    * Order transactions for a block. Transactions conflicting directly or through other transactions form a group,
+    * groups are placed one after the other by descending priority, the highest priority of their transactions, and
+    * ties are broken by their first transaction. Each group keeps the order its transactions were given in.
+    *
+    * @param priorities of each transaction, same size as transactions
+    * @return the indices of transactions in block order
+    */
+   vector<size_t> plan_block( const vector<access_set>& transactions, const vector<uint64_t>& priorities );
+
+} } /// eosio::chain
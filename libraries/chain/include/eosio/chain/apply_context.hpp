@@ -6,6 +6,7 @@
 #include <eosio/chain/controller.hpp>
 #include <eosio/chain/transaction.hpp>
 #include <eosio/chain/contract_table_objects.hpp>
+#include <eosio/chain/open_address_map.hpp>
 #include <fc/utility.hpp>
 #include <sstream>
 #include <algorithm>
@@ -20,50 +21,72 @@ class transaction_context;
 
 class apply_context {
    private:
+      /**
+       * Maps the objects a contract accesses to the integer iterators handed to it. An apply_context is created
+       * for every action, the tables of its caches are taken from a per thread pool and returned cleared, so the
+       * actions executed by a thread keep reusing the same allocations.
+       */
       template<typename T>
       class iterator_cache {
          public:
-            iterator_cache(){
-               _end_iterator_to_table.reserve(8);
-               _iterator_to_object.reserve(32);
+            iterator_cache() {
+               auto& pool = storage_pool();
+               if( !pool.empty() ) {
+                  _storage = std::move( pool.back() );
+                  pool.pop_back();
+               } else {
+                  _storage.reset( new storage() );
+                  _storage->end_iterator_to_table.reserve(8);
+                  _storage->iterator_to_object.reserve(32);
+               }
+            }
+
+            ~iterator_cache() {
+               auto& pool = storage_pool();
+               // do not keep the memory of an unusually large action around
+               if( pool.size() < max_pooled && _storage->iterator_to_object.capacity() <= max_pooled_iterators ) {
+                  _storage->clear();
+                  pool.emplace_back( std::move( _storage ) );
+               }
             }
 
+            iterator_cache( const iterator_cache& ) = delete;
+            iterator_cache& operator=( const iterator_cache& ) = delete;
+
             /// Returns end iterator of the table.
             int cache_table( const table_id_object& tobj ) {
-               auto itr = _table_cache.find(tobj.id);
-               if( itr != _table_cache.end() )
-                  return itr->second.second;
+               auto ei = _storage->table_cache.find( tobj.id._id );
+               if( ei != open_address_map::npos )
+                  return ei;
 
-               auto ei = index_to_end_iterator(_end_iterator_to_table.size());
-               _end_iterator_to_table.push_back( &tobj );
-               _table_cache.emplace( tobj.id, make_pair(&tobj, ei) );
+               ei = index_to_end_iterator(_storage->end_iterator_to_table.size());
+               _storage->end_iterator_to_table.push_back( &tobj );
+               _storage->table_cache.insert( tobj.id._id, ei );
                return ei;
             }
 
             const table_id_object& get_table( table_id_object::id_type i )const {
-               auto itr = _table_cache.find(i);
-               EOS_ASSERT( itr != _table_cache.end(), table_not_in_cache, "an invariant was broken, table should be in cache" );
-               return *itr->second.first;
+               return *find_table_by_end_iterator( get_end_iterator_by_table_id( i ) );
             }
 
             int get_end_iterator_by_table_id( table_id_object::id_type i )const {
-               auto itr = _table_cache.find(i);
-               EOS_ASSERT( itr != _table_cache.end(), table_not_in_cache, "an invariant was broken, table should be in cache" );
-               return itr->second.second;
+               auto ei = _storage->table_cache.find( i._id );
+               EOS_ASSERT( ei != open_address_map::npos, table_not_in_cache, "an invariant was broken, table should be in cache" );
+               return ei;
             }
 
             const table_id_object* find_table_by_end_iterator( int ei )const {
                EOS_ASSERT( ei < -1, invalid_table_iterator, "not an end iterator" );
                auto indx = end_iterator_to_index(ei);
-               if( indx >= _end_iterator_to_table.size() ) return nullptr;
-               return _end_iterator_to_table[indx];
+               if( indx >= _storage->end_iterator_to_table.size() ) return nullptr;
+               return _storage->end_iterator_to_table[indx];
             }
 
             const T& get( int iterator ) {
                EOS_ASSERT( iterator != -1, invalid_table_iterator, "invalid iterator" );
                EOS_ASSERT( iterator >= 0, table_operation_not_permitted, "dereference of end iterator" );
-               EOS_ASSERT( (size_t)iterator < _iterator_to_object.size(), invalid_table_iterator, "iterator out of range" );
-               auto result = _iterator_to_object[iterator];
+               EOS_ASSERT( (size_t)iterator < _storage->iterator_to_object.size(), invalid_table_iterator, "iterator out of range" );
+               auto result = _storage->iterator_to_object[iterator];
                EOS_ASSERT( result, table_operation_not_permitted, "dereference of deleted object" );
                return *result;
             }
@@ -71,30 +94,50 @@ class apply_context {
             void remove( int iterator ) {
                EOS_ASSERT( iterator != -1, invalid_table_iterator, "invalid iterator" );
                EOS_ASSERT( iterator >= 0, table_operation_not_permitted, "cannot call remove on end iterators" );
-               EOS_ASSERT( (size_t)iterator < _iterator_to_object.size(), invalid_table_iterator, "iterator out of range" );
+               EOS_ASSERT( (size_t)iterator < _storage->iterator_to_object.size(), invalid_table_iterator, "iterator out of range" );
 
-               auto obj_ptr = _iterator_to_object[iterator];
+               auto obj_ptr = _storage->iterator_to_object[iterator];
                if( !obj_ptr ) return;
-               _iterator_to_object[iterator] = nullptr;
-               _object_to_iterator.erase( obj_ptr );
+               _storage->iterator_to_object[iterator] = nullptr;
+               _storage->object_to_iterator.erase( reinterpret_cast<uint64_t>( obj_ptr ) );
             }
 
             int add( const T& obj ) {
-               auto itr = _object_to_iterator.find( &obj );
-               if( itr != _object_to_iterator.end() )
-                    return itr->second;
+               const auto key = reinterpret_cast<uint64_t>( &obj );
+               auto itr = _storage->object_to_iterator.find( key );
+               if( itr != open_address_map::npos )
+                    return itr;
 
-               _iterator_to_object.push_back( &obj );
-               _object_to_iterator[&obj] = _iterator_to_object.size() - 1;
+               _storage->iterator_to_object.push_back( &obj );
+               _storage->object_to_iterator.insert( key, _storage->iterator_to_object.size() - 1 );
 
-               return _iterator_to_object.size() - 1;
+               return _storage->iterator_to_object.size() - 1;
             }
 
          private:
-            map<table_id_object::id_type, pair<const table_id_object*, int>> _table_cache;
-            vector<const table_id_object*>                  _end_iterator_to_table;
-            vector<const T*>                                _iterator_to_object;
-            map<const T*,int>                               _object_to_iterator;
+            static constexpr size_t max_pooled = 16;
+            static constexpr size_t max_pooled_iterators = 64 * 1024;
+
+            struct storage {
+               open_address_map                                table_cache; ///< table id to end iterator
+               vector<const table_id_object*>                  end_iterator_to_table;
+               vector<const T*>                                iterator_to_object;
+               open_address_map                                object_to_iterator;
+
+               void clear() {
+                  table_cache.clear();
+                  end_iterator_to_table.clear();
+                  iterator_to_object.clear();
+                  object_to_iterator.clear();
+               }
+            };
+
+            static vector<std::unique_ptr<storage>>& storage_pool() {
+               static thread_local vector<std::unique_ptr<storage>> pool;
+               return pool;
+            }
+
+            std::unique_ptr<storage> _storage;
 
             /// Precondition: std::numeric_limits<int>::min() < ei < -1
             /// Iterator of -1 is reserved for invalid iterators (i.e. when the appropriate table has not yet been created).
@@ -211,6 +254,7 @@ class apply_context {
                EOS_ASSERT( table_obj.code == context.receiver, table_access_violation, "db access violation" );
 
 //               context.require_write_lock( table_obj.scope );
+               context.record_table_write( table_obj );
 
                context.db.modify( table_obj, [&]( auto& t ) {
                   --t.count;
@@ -231,6 +275,7 @@ class apply_context {
                EOS_ASSERT( table_obj.code == context.receiver, table_access_violation, "db access violation" );
 
 //               context.require_write_lock( table_obj.scope );
+               context.record_table_write( table_obj );
 
                if( payer == account_name() ) payer = obj.payer;
 
@@ -546,6 +591,14 @@ class apply_context {
       void db_remove_i64( int iterator );
       int  db_get_i64( int iterator, char* buffer, size_t buffer_size );
       int  db_next_i64( int iterator, uint64_t& primary );
+      /**
+       * Copies the rows of the table starting at iterator into buffer, as many as fit, each as its
+       * primary key (8 bytes), the size of its value (4 bytes) and its value.
+       *
+       * @param rows - set to the number of rows copied, 0 if the first one does not fit or iterator is an end iterator
+       * @return iterator to the first row not copied, the end iterator of the table once all rows were copied
+       */
+      int  db_get_batch_i64( int iterator, char* buffer, size_t buffer_size, uint32_t& rows );
       int  db_previous_i64( int iterator, uint64_t& primary );
       int  db_find_i64( uint64_t code, uint64_t scope, uint64_t table, uint64_t id );
       int  db_lowerbound_i64( uint64_t code, uint64_t scope, uint64_t table, uint64_t id );
@@ -557,6 +610,7 @@ class apply_context {
       const table_id_object* find_table( name code, name scope, name table );
       const table_id_object& find_or_create_table( name code, name scope, name table, const account_name &payer );
       void                   remove_table( const table_id_object& tid );
+      void                   record_table_write( const table_id_object& tid );
 
       int  db_store_i64( uint64_t code, uint64_t scope, uint64_t table, const account_name& payer, uint64_t id, const char* buffer, size_t buffer_size );
 
@@ -589,6 +643,7 @@ class apply_context {
       bool                          privileged   = false;
       bool                          context_free = false;
       bool                          used_context_free_api = false;
+      bool                          defer_trace_act = false; ///< the caller moves act into the top-level trace once it is applied
 
       generic_index<index64_object>                                  idx64;
       generic_index<index128_object>                                 idx128;
@@ -144,6 +144,27 @@ namespace detail {
             return satisfied( authority, *cached_perms, 0 );
          }
 
+         /// like satisfied, and also sets used_keys to the provided keys, in order, that this permission used
+         bool satisfied_using_keys( const permission_level& permission,
+                                    fc::microseconds override_provided_delay,
+                                    vector<bool>& used_keys
+                                  )
+         {
+            auto previously_used_keys = _used_keys;
+            _used_keys.assign( _used_keys.size(), false );
+            bool result = satisfied( permission, override_provided_delay );
+            used_keys = _used_keys;
+            use_keys( previously_used_keys );
+            return result;
+         }
+
+         /// marks the keys a satisfied_using_keys call with the same provided keys reported as used
+         void use_keys( const vector<bool>& keys ) {
+            for( size_t i = 0; i < keys.size(); ++i )
+               if( keys[i] )
+                  _used_keys[i] = true;
+         }
+
          bool all_keys_used() const { return boost::algorithm::all_of_equal(_used_keys, true); }
 
          flat_set<public_key_type> used_keys() const {
@@ -10,6 +10,9 @@
 
 #include <utility>
 #include <functional>
+#include <map>
+#include <set>
+#include <tuple>
 
 namespace eosio { namespace chain {
 
@@ -49,6 +52,12 @@ namespace eosio { namespace chain {
 
          void remove_permission( const permission_object& permission );
 
+         /**
+          * Invalidates the cached authorization checks. Called on every change to a permission or a permission link,
+          * the change is versioned in the database so that undoing it makes the checks cached before it valid again.
+          */
+         void invalidate_authorization_cache();
+
          void update_permission_usage( const permission_object& permission );
 
          fc::time_point get_permission_last_used( const permission_object& permission )const;
@@ -122,6 +131,30 @@ namespace eosio { namespace chain {
          const controller&    _control;
          chainbase::database& _db;
 
+         /// a permission satisfied by provided keys and permissions, at an authorization version
+         struct satisfied_authorization_key {
+            uint64_t                      version;
+            permission_level              permission;
+            fc::microseconds              delay;
+            uint16_t                      depth_limit;
+            flat_set<public_key_type>     provided_keys;
+            flat_set<permission_level>    provided_permissions;
+
+            friend bool operator<( const satisfied_authorization_key& a, const satisfied_authorization_key& b ) {
+               return std::tie( a.version, a.permission, a.delay, a.depth_limit, a.provided_keys, a.provided_permissions )
+                    < std::tie( b.version, b.permission, b.delay, b.depth_limit, b.provided_keys, b.provided_permissions );
+            }
+         };
+
+         /// the keys, in provided order, each satisfied permission used
+         mutable std::map<satisfied_authorization_key, vector<bool>>                           _cached_satisfied_permissions;
+         /// declared authorizations that meet the minimum permission of an action, at an authorization version
+         mutable std::set<std::tuple<uint64_t, permission_level, account_name, action_name>>   _cached_relevant_authorizations;
+         /// the last version set, versions are never reused even when a change is undone
+         uint64_t                                                                              _last_authorization_version = 0;
+
+         uint64_t         authorization_version()const;
+
          void             check_updateauth_authorization( const updateauth& update, const vector<permission_level>& auths )const;
          void             check_deleteauth_authorization( const deleteauth& del, const vector<permission_level>& auths )const;
          void             check_linkauth_authorization( const linkauth& link, const vector<permission_level>& auths )const;
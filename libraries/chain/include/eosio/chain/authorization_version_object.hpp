@@ -0,0 +1,39 @@
+/**
+ *  @file
+ *  @copyright defined in eos/LICENSE
+ */
+#pragma once
+#include <eosio/chain/types.hpp>
+
+#include "multi_index_includes.hpp"
+
+namespace eosio { namespace chain {
+
+   /**
+    *  @brief versions the permissions and permission links, for the authorization checks cached by authorization_manager
+    *  @ingroup object
+    *
+    *  Every change to a permission or link sets a version that was never used before. Undoing the change also
+    *  restores the version, so a cached check is valid whenever the version it was made at is current. The object is
+    *  not part of snapshots; it does not exist until the first change.
+    */
+   class authorization_version_object : public chainbase::object<authorization_version_object_type, authorization_version_object>
+   {
+         OBJECT_CTOR(authorization_version_object)
+
+         id_type           id;
+         uint64_t          version = 0;
+   };
+
+   using authorization_version_multi_index = chainbase::shared_multi_index_container<
+      authorization_version_object,
+      indexed_by<
+         ordered_unique<tag<by_id>, BOOST_MULTI_INDEX_MEMBER(authorization_version_object, authorization_version_object::id_type, id)>
+      >
+   >;
+
+} }
+
+CHAINBASE_SET_INDEX_TYPE(eosio::chain::authorization_version_object, eosio::chain::authorization_version_multi_index)
+
+FC_REFLECT( eosio::chain::authorization_version_object, (version) )
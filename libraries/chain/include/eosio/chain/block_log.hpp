@@ -6,11 +6,19 @@
 #include <fc/filesystem.hpp>
 #include <eosio/chain/block.hpp>
 #include <eosio/chain/genesis_state.hpp>
+#include <functional>
 
 namespace eosio { namespace chain {
 
    namespace detail { class block_log_impl; }
 
+   struct block_log_config {
+      uint32_t  stride = 0;               ///< blocks per block log segment, 0 keeps a single blocks.log
+      uint32_t  max_retained_files = 10;  ///< completed segments kept in the blocks directory
+      fc::path  archive_dir;              ///< where segments beyond max_retained_files are moved, removed if empty
+      uint32_t  retain_blocks = 0;        ///< if not 0, segments with none of the last retain_blocks blocks are removed
+   };
+
    /* The block log is an external append only log of the blocks with a header. Blocks should only
     * be written to the log after they irreverisble as the log is append only. The log is a doubly
     * linked list of blocks. There is a secondary index file of only block positions that enables
@@ -34,15 +42,33 @@ namespace eosio { namespace chain {
     *
     * The main file is the only file that needs to persist. The index file can be reconstructed during a
     * linear scan of the main file.
+    *
+    * Both files are read through a memory mapping that is republished after every append. The read methods
+    * (read_block, read_block_by_num, read_block_by_id, get_block_pos and read_head) may be called from any
+    * thread concurrently with append; they see the log as of the last completed append. All other methods,
+    * including head(), must only be called from the thread that appends.
+    *
+    * With a stride configured, blocks.log only holds the blocks since the last multiple of the stride. Once
+    * the next block would start a new stride, blocks.log and blocks.index are renamed to the completed segment
+    * blocks-<first>-<last>.log and blocks-<first>-<last>.index, and a new blocks.log is started with the same
+    * genesis header. read_block_by_num also reads the retained segments; positions returned by append and
+    * get_block_pos and accepted by read_block are always within blocks.log. Segments beyond
+    * max_retained_files are moved to archive_dir or removed. In pruned mode (retain_blocks) segments are
+    * removed once all of their blocks are older than the last retain_blocks blocks.
     */
 
    class block_log {
       public:
-         block_log(const fc::path& data_dir);
+         block_log(const fc::path& data_dir, const block_log_config& config = block_log_config());
          block_log(block_log&& other);
          ~block_log();
 
          uint64_t append(const signed_block_ptr& b);
+         /**
+          * Append consecutive blocks with a single flush, readers see them once all are written.
+          * @return position of the last block, npos if blocks is empty
+          */
+         uint64_t append(const vector<signed_block_ptr>& blocks);
          void flush();
          void reset( const genesis_state& gs, const signed_block_ptr& genesis_block, uint32_t first_block_num = 1 );
 
@@ -69,6 +95,16 @@ namespace eosio { namespace chain {
 
          static genesis_state extract_genesis_state( const fc::path& data_dir );
 
+         /**
+          * Write the index of block_file to index_file. Instead of deserializing every block, the position trailers
+          * are followed back from the end of the file. The file is split at block boundaries into up to threads
+          * chunks that are walked in parallel.
+          * @param progress called periodically from the calling thread with the bytes indexed and the total bytes
+          * @return number of blocks in the index
+          */
+         static uint64_t build_index( const fc::path& block_file, const fc::path& index_file, uint32_t threads = 1,
+                                      const std::function<void(uint64_t, uint64_t)>& progress = {} );
+
       private:
          void open(const fc::path& data_dir);
          void construct_index();
@@ -0,0 +1,122 @@
+/**
+ *  @file
+ *  @copyright defined in eos/LICENSE
+ */
+#pragma once
+#include <eosio/chain/types.hpp>
+
+#include <limits>
+
+namespace eosio { namespace chain {
+
+   /// phases the time of a block is broken down into, each instant is charged to the innermost phase in progress
+   enum class profile_phase : uint8_t {
+      deserialization,    ///< unpacking the transactions of an applied block
+      signature_recovery, ///< recovering keys, or waiting for keys being recovered on the thread pool
+      authorization,      ///< checking the authorizations of transactions
+      wasm_instantiation, ///< instantiating contracts or fetching them from the instantiation cache
+      execution,          ///< running transactions and actions, the time of each action is also attributed to it
+      database,           ///< squashing, undoing and committing undo sessions
+      signals,            ///< signal handlers
+      other               ///< any other time between the start and the end of the block
+   };
+   constexpr size_t profile_phase_count = static_cast<size_t>( profile_phase::other ) + 1;
+
+   struct action_profile {
+      account_name   receiver;
+      action_name    action;
+      uint32_t       count = 0;
+      int64_t        time_us = 0; ///< excluding wasm instantiation and nested phases
+   };
+
+   struct block_profile {
+      block_id_type  id;
+      uint32_t       block_num = 0;
+      bool           produced = false;
+      uint32_t       transactions = 0;
+      int64_t        total_us = 0; ///< from the start of the block to its commit
+
+      int64_t        deserialization_us = 0;
+      int64_t        signature_recovery_us = 0;
+      int64_t        authorization_us = 0;
+      int64_t        wasm_instantiation_us = 0;
+      int64_t        execution_us = 0;
+      int64_t        database_us = 0;
+      int64_t        signals_us = 0;
+      int64_t        other_us = 0;
+
+      vector<action_profile> actions; ///< most time first
+
+      int64_t& phase_us( profile_phase phase );
+      int64_t  phase_us( profile_phase phase )const { return const_cast<block_profile&>( *this ).phase_us( phase ); }
+   };
+
+   using block_profile_ptr = std::shared_ptr<block_profile>;
+
+   /**
+    * Breaks the wall time of the pending block down into phases and actions.
+    *
+    * Phases are entered and left through block_profiler::scope, which does nothing unless a block is being profiled.
+    * Only the thread applying the block may use it.
+    */
+   class block_profiler {
+      public:
+         class scope {
+            public:
+               scope( block_profiler& profiler, profile_phase phase )
+               :_profiler( profiler.active() ? &profiler : nullptr ) {
+                  if( _profiler ) _profiler->push( phase, npos );
+               }
+               /// execution of an action
+               scope( block_profiler& profiler, account_name receiver, action_name action )
+               :_profiler( profiler.active() ? &profiler : nullptr ) {
+                  if( _profiler ) _profiler->push( profile_phase::execution, _profiler->action_index( receiver, action ) );
+               }
+               ~scope() {
+                  if( _profiler ) _profiler->pop();
+               }
+
+               scope( const scope& ) = delete;
+               scope& operator=( const scope& ) = delete;
+
+            private:
+               block_profiler* _profiler;
+         };
+
+         bool active()const { return _current != nullptr; }
+
+         /// starts profiling a block, discarding the block being profiled if any
+         void start_block( uint32_t block_num, bool produced );
+         /// @return the profile of the block, none is active afterwards
+         block_profile_ptr finish_block( const block_id_type& id, uint32_t transactions );
+         void abort_block();
+
+      private:
+         static constexpr size_t npos = std::numeric_limits<size_t>::max();
+
+         struct frame {
+            profile_phase  phase;
+            size_t         action; ///< index in _current->actions or npos
+         };
+
+         size_t action_index( account_name receiver, action_name action );
+         void push( profile_phase phase, size_t action );
+         void pop();
+         /// charges the time since the last charge to the innermost frame
+         void charge();
+
+         block_profile_ptr                                       _current;
+         fc::time_point                                          _start;
+         fc::time_point                                          _last;
+         vector<frame>                                           _stack;
+         flat_map<std::pair<account_name, action_name>, size_t>  _action_indices;
+   };
+
+} } /// eosio::chain
+
+FC_REFLECT_ENUM( eosio::chain::profile_phase,
+                 (deserialization)(signature_recovery)(authorization)(wasm_instantiation)(execution)(database)(signals)(other) )
+FC_REFLECT( eosio::chain::action_profile, (receiver)(action)(count)(time_us) )
+FC_REFLECT( eosio::chain::block_profile, (id)(block_num)(produced)(transactions)(total_us)
+            (deserialization_us)(signature_recovery_us)(authorization_us)(wasm_instantiation_us)(execution_us)(database_us)(signals_us)(other_us)
+            (actions) )
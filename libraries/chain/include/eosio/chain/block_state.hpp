@@ -17,7 +17,6 @@ namespace eosio { namespace chain {
       block_state( const block_header_state& prev, block_timestamp_type when );
       block_state() = default;
 
-      /// weak_ptr prev_block_state....
       signed_block_ptr                                    block;
       bool                                                validated = false;
       bool                                                in_current_chain = false;
@@ -25,6 +24,10 @@ namespace eosio { namespace chain {
       /// this data is redundant with the data stored in block, but facilitates
       /// recapturing transactions when we pop a block
       vector<transaction_metadata_ptr>                    trxs;
+
+      /// links maintained by the fork database, they expire once the linked blocks are pruned
+      std::weak_ptr<block_state>                          prev_block_state;
+      std::weak_ptr<block_state>                          skip_block_state; ///< an older ancestor, see fork_database
    };
 
    using block_state_ptr = std::shared_ptr<block_state>;
@@ -12,10 +12,12 @@ struct chain_snapshot_header {
    /**
     * Version history
     *   1: initial version
+    *   2: added feature_activation_object
+    *   3: added usage_sequence to resource_limits_state_object
     */
 
    static constexpr uint32_t minimum_compatible_version = 1;
-   static constexpr uint32_t current_version = 1;
+   static constexpr uint32_t current_version = 3;
 
    uint32_t version = current_version;
 
@@ -19,6 +19,7 @@ const static auto default_reversible_guard_size = 2*1024*1024ll;/// 1MB * 340 bl
 
 const static auto default_state_dir_name     = "state";
 const static auto forkdb_filename            = "forkdb.dat";
+const static auto forkdb_journal_filename    = "forkdb.log";
 const static auto default_state_size            = 1*1024*1024*1024ll;
 const static auto default_state_guard_size      =    128*1024*1024ll;
 
@@ -39,6 +40,9 @@ const static uint64_t owner_name  = N(owner);
 const static uint64_t eosio_any_name = N(eosio.any);
 const static uint64_t eosio_code_name = N(eosio.code);
 
+/// features activated through the privileged activate_feature intrinsic, used once the activation is irreversible
+const static uint64_t batch_db_iteration_feature = N(batchdbiter);
+
 const static int      block_interval_ms = 500;
 const static int      block_interval_us = block_interval_ms*1000;
 const static uint64_t block_timestamp_epoch = 946684800000ll; // epoch is year 2000.
@@ -96,7 +100,12 @@ const static uint32_t   setcode_ram_bytes_multiplier       = 10;     ///< multip
 const static uint32_t   hashing_checktime_block_size       = 10*1024;  /// call checktime from hashing intrinsic once per this number of bytes
 
 const static eosio::chain::wasm_interface::vm_type default_wasm_runtime = eosio::chain::wasm_interface::vm_type::wabt;
+const static uint64_t   default_wasm_cache_size            = 1024*1024*1024ll; ///< estimated bytes of instantiated contracts kept
+const static uint64_t   default_wasm_code_cache_size       = 1024*1024*1024ll; ///< bytes of prepared contract code kept on disk
+const static uint32_t   default_wasm_precompile_contracts  = 32; ///< most used contracts of the recent blocks compiled at startup
+const static uint32_t   wasm_precompile_lookback_blocks    = 2*60*10; ///< recent blocks counted to find the most used contracts
 const static uint32_t   default_abi_serializer_max_time_ms = 15*1000; ///< default deadline for abi serialization methods
+const static uint32_t   authorization_cache_size           = 64*1024; ///< cached authorization checks kept before the cache is cleared
 
 /**
  *  The number of sequential blocks produced by a single producer
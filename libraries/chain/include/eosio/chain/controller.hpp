@@ -1,8 +1,10 @@
 #pragma once
 #include <eosio/chain/block_state.hpp>
+#include <eosio/chain/block_profiler.hpp>
 #include <eosio/chain/trace.hpp>
 #include <eosio/chain/genesis_state.hpp>
 #include <boost/signals2/signal.hpp>
+#include <limits>
 
 #include <eosio/chain/abi_serializer.hpp>
 #include <eosio/chain/account_object.hpp>
@@ -62,6 +64,10 @@ namespace eosio { namespace chain {
             flat_set<public_key_type> key_blacklist;
             path                     blocks_dir             =  chain::config::default_blocks_dir_name;
             path                     state_dir              =  chain::config::default_state_dir_name;
+            uint32_t                 blocks_log_stride      =  0;
+            uint32_t                 max_retained_block_files = 10;
+            path                     blocks_archive_dir;
+            uint32_t                 block_log_retain_blocks = 0;
             uint64_t                 state_size             =  chain::config::default_state_size;
             uint64_t                 state_guard_size       =  chain::config::default_state_guard_size;
             uint64_t                 reversible_cache_size  =  chain::config::default_reversible_cache_size;
@@ -73,9 +79,17 @@ namespace eosio { namespace chain {
             bool                     disable_replay_opts    =  false;
             bool                     contracts_console      =  false;
             bool                     allow_ram_billing_in_notify = false;
+            bool                     track_state_access     =  false; ///< record the tables each transaction touches and report block parallelism
+            bool                     profile_blocks         =  false; ///< break the time of each block down, see block_profiled
+            /// hard fork from which activate_feature and is_feature_active take effect, all nodes of a chain must agree on it
+            uint32_t                 feature_activation_block_num = std::numeric_limits<uint32_t>::max();
 
             genesis_state            genesis;
             wasm_interface::vm_type  wasm_runtime = chain::config::default_wasm_runtime;
+            uint64_t                 wasm_cache_size        =  chain::config::default_wasm_cache_size;
+            uint32_t                 wasm_precompile_contracts = chain::config::default_wasm_precompile_contracts;
+            path                     wasm_code_cache_dir; ///< prepared contract code persisted across restarts, disabled if empty
+            uint64_t                 wasm_code_cache_size   =  chain::config::default_wasm_code_cache_size;
 
             db_read_mode             read_mode              = db_read_mode::SPECULATIVE;
             validation_mode          block_validation_mode  = validation_mode::FULL;
@@ -186,6 +200,14 @@ namespace eosio { namespace chain {
          uint32_t last_irreversible_block_num() const;
          block_id_type last_irreversible_block_id() const;
 
+         /**
+          * schedules the feature to take effect once the pending block is irreversible. Before the
+          * feature_activation_block_num hard fork, it fails with unsupported_feature as in earlier releases.
+          */
+         void activate_feature( name feature );
+         /// @return whether the feature was activated in a block irreversible by block headers, always false before the hard fork
+         bool is_feature_active( name feature )const;
+
          signed_block_ptr fetch_block_by_number( uint32_t block_num )const;
          signed_block_ptr fetch_block_by_id( block_id_type id )const;
 
@@ -242,6 +264,7 @@ namespace eosio { namespace chain {
          signal<void(const transaction_metadata_ptr&)> accepted_transaction;
          signal<void(const transaction_trace_ptr&)>    applied_transaction;
          signal<void(const int&)>                      bad_alloc;
+         signal<void(const block_profile_ptr&)>        block_profiled; ///< after each committed block if profile_blocks is set
 
          /*
          signal<void()>                                  pre_apply_block;
@@ -255,6 +278,7 @@ namespace eosio { namespace chain {
 
          const apply_handler* find_apply_handler( account_name contract, scope_name scope, action_name act )const;
          wasm_interface& get_wasm_interface();
+         block_profiler& get_block_profiler();
 
 
          optional<abi_serializer> get_abi_serializer( account_name n, const fc::microseconds& max_serialization_time )const {
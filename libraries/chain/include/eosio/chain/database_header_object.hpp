@@ -0,0 +1,45 @@
+/**
+ *  @file
+ *  @copyright defined in eos/LICENSE
+ */
+#pragma once
+#include <eosio/chain/types.hpp>
+
+#include "multi_index_includes.hpp"
+
+namespace eosio { namespace chain {
+
+   /**
+    *  @brief records the layout version of the objects in the state database
+    *  @ingroup object
+    *
+    *  The state database is mapped as is, so a state file written by a release with a different layout can not be
+    *  read. Such a state is refused at startup; the node has to replay the blockchain or start from a snapshot. The
+    *  object is not part of snapshots.
+    */
+   class database_header_object : public chainbase::object<database_header_object_type, database_header_object>
+   {
+         OBJECT_CTOR(database_header_object)
+
+         /**
+          * Version history
+          *   1: resource_limits_state_object gained usage_sequence, earlier state files have no header
+          */
+         static constexpr uint32_t current_version = 1;
+
+         id_type           id;
+         uint32_t          version = current_version;
+   };
+
+   using database_header_multi_index = chainbase::shared_multi_index_container<
+      database_header_object,
+      indexed_by<
+         ordered_unique<tag<by_id>, BOOST_MULTI_INDEX_MEMBER(database_header_object, database_header_object::id_type, id)>
+      >
+   >;
+
+} }
+
+CHAINBASE_SET_INDEX_TYPE(eosio::chain::database_header_object, eosio::chain::database_header_multi_index)
+
+FC_REFLECT( eosio::chain::database_header_object, (version) )
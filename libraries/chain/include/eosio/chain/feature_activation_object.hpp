@@ -0,0 +1,41 @@
+/**
+ *  @file
+ *  @copyright defined in eos/LICENSE
+ */
+#pragma once
+#include <eosio/chain/types.hpp>
+
+#include "multi_index_includes.hpp"
+
+namespace eosio { namespace chain {
+
+   /**
+    *  @brief records a feature activated through the privileged activate_feature intrinsic
+    *  @ingroup object
+    *
+    *  The feature takes effect once the block that activated it is irreversible by block headers,
+    *  so that every node switches to it at the same block regardless of BFT finality.
+    */
+   class feature_activation_object : public chainbase::object<feature_activation_object_type, feature_activation_object>
+   {
+         OBJECT_CTOR(feature_activation_object)
+
+         id_type           id;
+         name              feature;
+         block_num_type    activation_block_num = 0;
+   };
+
+   struct by_feature;
+   using feature_activation_multi_index = chainbase::shared_multi_index_container<
+      feature_activation_object,
+      indexed_by<
+         ordered_unique<tag<by_id>, BOOST_MULTI_INDEX_MEMBER(feature_activation_object, feature_activation_object::id_type, id)>,
+         ordered_unique<tag<by_feature>, BOOST_MULTI_INDEX_MEMBER(feature_activation_object, name, feature)>
+      >
+   >;
+
+} }
+
+CHAINBASE_SET_INDEX_TYPE(eosio::chain::feature_activation_object, eosio::chain::feature_activation_multi_index)
+
+FC_REFLECT( eosio::chain::feature_activation_object, (feature)(activation_block_num) )
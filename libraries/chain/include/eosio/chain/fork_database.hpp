@@ -18,6 +18,9 @@ namespace eosio { namespace chain {
     * database tracks the longest chain and the last irreversible block number. All
     * blocks older than the last irreversible block are freed after emitting the
     * irreversible signal.
+    *
+    * Changes are journaled to the data directory as they are made, so the database
+    * is recovered after a crash and not only after close().
     */
    class fork_database {
       public:
@@ -27,6 +30,13 @@ namespace eosio { namespace chain {
 
          void close();
 
+         /**
+          * Stop journaling changes, e.g. while replaying blocks that are already in the block log. The journal is
+          * rewritten with the states of the database when it is resumed.
+          */
+         void suspend_journal();
+         void resume_journal();
+
          block_state_ptr  get_block(const block_id_type& id)const;
          block_state_ptr  get_block_in_current_chain_by_num( uint32_t n )const;
 //         vector<block_state_ptr>    get_blocks_by_number(uint32_t n)const;
@@ -55,6 +65,12 @@ namespace eosio { namespace chain {
          pair< branch_type, branch_type >  fetch_branch_from( const block_id_type& first,
                                                               const block_id_type& second )const;
 
+         /**
+          *  Returns the blocks from h back to the block following trim_after_block_num, newest first,
+          *  ending early at the oldest ancestor still in the database.
+          */
+         branch_type  fetch_branch( const block_id_type& h, uint32_t trim_after_block_num )const;
+
 
          /**
           * If the block is invalid, it will be removed. If it is valid, then blocks older
@@ -67,10 +83,11 @@ namespace eosio { namespace chain {
          void bft_finalize( const block_id_type& id );
 
          /**
-          * This signal is emited when a block state becomes irreversible, once irreversible
-          * it is removed unless it is the head block.
+          * This signal is emited when block states become irreversible, once irreversible
+          * they are removed unless one is the head block. All blocks that become irreversible
+          * together are passed in one call, oldest first.
           */
-         signal<void(block_state_ptr)> irreversible;
+         signal<void(const branch_type&)> irreversible;
 
       private:
          void set_bft_irreversible( block_id_type id );
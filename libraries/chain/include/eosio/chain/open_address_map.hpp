@@ -0,0 +1,117 @@
+/**
+ *  @file
+ *  @copyright defined in eos/LICENSE
+ */
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+namespace eosio { namespace chain {
+
+   /**
+    * Map from 64 bit keys to int values, with open addressing and linear probing.
+    *
+    * Made for the lookup tables of apply_context's iterator caches: small, short lived, looked up on every
+    * database intrinsic and cleared rather than freed so that their slots can be reused by the next action.
+    * Erased keys leave tombstones until the table is rehashed.
+    */
+   class open_address_map {
+      public:
+         static constexpr int npos = -1; ///< returned by find for a missing key, cannot be stored
+
+         /// @return the value of key or npos
+         int find( uint64_t key )const {
+            if( _slots.empty() )
+               return npos;
+            for( size_t i = bucket( key ); ; i = (i + 1) & mask() ) {
+               const auto& s = _slots[i];
+               if( s.state == slot_state::empty )
+                  return npos;
+               if( s.state == slot_state::used && s.key == key )
+                  return s.value;
+            }
+         }
+
+         /// @pre key is not in the map and value != npos
+         void insert( uint64_t key, int value ) {
+            if( (_used + _erased + 1) * 4 > _slots.size() * 3 )
+               rehash();
+            size_t i = bucket( key );
+            while( _slots[i].state == slot_state::used )
+               i = (i + 1) & mask();
+            if( _slots[i].state == slot_state::erased )
+               --_erased;
+            _slots[i] = slot{ key, value, slot_state::used };
+            ++_used;
+         }
+
+         void erase( uint64_t key ) {
+            if( _slots.empty() )
+               return;
+            for( size_t i = bucket( key ); ; i = (i + 1) & mask() ) {
+               auto& s = _slots[i];
+               if( s.state == slot_state::empty )
+                  return;
+               if( s.state == slot_state::used && s.key == key ) {
+                  s.state = slot_state::erased;
+                  --_used;
+                  ++_erased;
+                  return;
+               }
+            }
+         }
+
+         /// removes all keys, keeping the slots allocated
+         void clear() {
+            if( _used + _erased == 0 )
+               return;
+            for( auto& s : _slots )
+               s.state = slot_state::empty;
+            _used = _erased = 0;
+         }
+
+         size_t size()const { return _used; }
+         size_t capacity()const { return _slots.size(); }
+
+      private:
+         enum class slot_state : uint8_t { empty, used, erased };
+
+         struct slot {
+            uint64_t    key;
+            int         value;
+            slot_state  state;
+         };
+
+         size_t mask()const { return _slots.size() - 1; }
+
+         /// fibonacci hashing, pointers and sequential ids both spread over the high bits
+         size_t bucket( uint64_t key )const {
+            return (key * 0x9E3779B97F4A7C15ull) >> _shift;
+         }
+
+         void rehash() {
+            size_t capacity = 16;
+            while( capacity * 3 < (_used + 1) * 8 ) // at most 3/8 full after rehashing
+               capacity *= 2;
+            capacity = std::max( capacity, _slots.size() );
+
+            std::vector<slot> old( capacity, slot{ 0, npos, slot_state::empty } );
+            old.swap( _slots );
+            _shift = 64;
+            for( size_t c = capacity; c > 1; c >>= 1 )
+               --_shift;
+            _used = _erased = 0;
+            for( const auto& s : old ) {
+               if( s.state == slot_state::used )
+                  insert( s.key, s.value );
+            }
+         }
+
+         std::vector<slot>  _slots;
+         uint32_t           _shift = 64;
+         size_t             _used = 0;
+         size_t             _erased = 0;
+   };
+
+} } /// eosio::chain
@@ -3,6 +3,7 @@
 #include <eosio/chain/types.hpp>
 #include <eosio/chain/snapshot.hpp>
 #include <chainbase/chainbase.hpp>
+#include <memory>
 #include <set>
 
 namespace eosio { namespace chain { namespace resource_limits {
@@ -37,15 +38,13 @@ namespace eosio { namespace chain { namespace resource_limits {
 
    class resource_limits_manager {
       public:
-         explicit resource_limits_manager(chainbase::database& db)
-         :_db(db)
-         {
-         }
+         explicit resource_limits_manager(chainbase::database& db);
+         ~resource_limits_manager();
 
          void add_indices();
          void initialize_database();
          void add_to_snapshot( const snapshot_writer_ptr& snapshot ) const;
-         void read_from_snapshot( const snapshot_reader_ptr& snapshot );
+         void read_from_snapshot( const snapshot_reader_ptr& snapshot, uint32_t version );
 
          void initialize_account( const account_name& account );
          void set_block_parameters( const elastic_limit_parameters& cpu_limit_parameters, const elastic_limit_parameters& net_limit_parameters );
@@ -61,6 +60,7 @@ namespace eosio { namespace chain { namespace resource_limits {
          void get_account_limits( const account_name& account, int64_t& ram_bytes, int64_t& net_weight, int64_t& cpu_weight) const;
 
          void process_account_limit_updates();
+         /// writes the account usage accumulated during the block to the database and updates the block averages
          void process_block_usage( uint32_t block_num );
 
          // accessors
@@ -79,7 +79,21 @@ namespace eosio { namespace chain { namespace resource_limits {
          int64_t get_account_ram_usage( const account_name& name ) const;
 
       private:
+         struct pending_account_usage;
+         struct pending_usage_accumulator;
+
+         void                   rewind_pending_usage()const;
+         uint64_t               next_usage_sequence();
+         pending_account_usage& modify_pending_usage( const account_name& account, uint64_t sequence );
+         void                   get_account_usage( const account_name& account, uint64_t& net_usage_ex, uint64_t& cpu_usage_ex )const;
+
          chainbase::database& _db;
+
+         /**
+          * The net and cpu usage of the accounts billed in the pending block. The resource_usage_objects are modified
+          * once per block in process_block_usage rather than once per transaction.
+          */
+         std::unique_ptr<pending_usage_accumulator> _pending_usage;
    };
 } } } /// eosio::chain
 
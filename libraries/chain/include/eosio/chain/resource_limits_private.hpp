@@ -249,8 +249,30 @@ namespace eosio { namespace chain { namespace resource_limits {
        */
       uint64_t virtual_cpu_limit = 0ULL;
 
+      /**
+       * Incremented by every change to the account usage accumulated in resource_limits_manager, so that undoing
+       * this object also tells the manager which of its changes were undone. Reset at the end of each block, so it
+       * is always 0 in snapshots.
+       */
+      uint64_t usage_sequence = 0ULL;
+
    };
 
+   namespace legacy {
+      /// resource_limits_state_object as written to snapshots before version 3, which added usage_sequence
+      struct snapshot_resource_limits_state_object_v2 {
+         usage_accumulator average_block_net_usage;
+         usage_accumulator average_block_cpu_usage;
+         uint64_t pending_net_usage = 0ULL;
+         uint64_t pending_cpu_usage = 0ULL;
+         uint64_t total_net_weight = 0ULL;
+         uint64_t total_cpu_weight = 0ULL;
+         uint64_t total_ram_bytes = 0ULL;
+         uint64_t virtual_net_limit = 0ULL;
+         uint64_t virtual_cpu_limit = 0ULL;
+      };
+   }
+
    using resource_limits_state_index = chainbase::shared_multi_index_container<
       resource_limits_state_object,
       indexed_by<
@@ -271,4 +293,5 @@ FC_REFLECT(eosio::chain::resource_limits::usage_accumulator, (last_ordinal)(valu
 FC_REFLECT(eosio::chain::resource_limits::resource_limits_object, (owner)(net_weight)(cpu_weight)(ram_bytes))
 FC_REFLECT(eosio::chain::resource_limits::resource_usage_object,  (owner)(net_usage)(cpu_usage)(ram_usage))
 FC_REFLECT(eosio::chain::resource_limits::resource_limits_config_object, (cpu_limit_parameters)(net_limit_parameters)(account_cpu_usage_average_window)(account_net_usage_average_window))
-FC_REFLECT(eosio::chain::resource_limits::resource_limits_state_object, (average_block_net_usage)(average_block_cpu_usage)(pending_net_usage)(pending_cpu_usage)(total_net_weight)(total_cpu_weight)(total_ram_bytes)(virtual_net_limit)(virtual_cpu_limit))
+FC_REFLECT(eosio::chain::resource_limits::resource_limits_state_object, (average_block_net_usage)(average_block_cpu_usage)(pending_net_usage)(pending_cpu_usage)(total_net_weight)(total_cpu_weight)(total_ram_bytes)(virtual_net_limit)(virtual_cpu_limit)(usage_sequence))
+FC_REFLECT(eosio::chain::resource_limits::legacy::snapshot_resource_limits_state_object_v2, (average_block_net_usage)(average_block_cpu_usage)(pending_net_usage)(pending_cpu_usage)(total_net_weight)(total_cpu_weight)(total_ram_bytes)(virtual_net_limit)(virtual_cpu_limit))
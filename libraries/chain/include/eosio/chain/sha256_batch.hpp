@@ -0,0 +1,29 @@
+/**
+ *  @file
+ *  @copyright defined in eos/LICENSE
+ */
+#pragma once
+#include <eosio/chain/types.hpp>
+
+namespace eosio { namespace chain {
+
+   /// implementations of sha256_pairs, the best one supported by the cpu is selected at startup
+   enum class sha256_backend : uint8_t {
+      generic, ///< fc::sha256, one pair at a time
+      avx2,    ///< eight pairs at a time, one per 32 bit lane
+      sha_ni   ///< SHA extensions, one pair at a time
+   };
+
+   bool           sha256_backend_supported( sha256_backend backend );
+   sha256_backend get_sha256_backend();
+   /// selects the backend used from now on, for tests and benchmarks
+   void           set_sha256_backend( sha256_backend backend );
+
+   /**
+    * Hashes count pairs of digests, out[i] = digest_type::hash( std::make_pair( in[2*i], in[2*i+1] ) ).
+    *
+    * out may be in, as when a merkle tree is reduced in place.
+    */
+   void sha256_pairs( const digest_type* in, size_t count, digest_type* out );
+
+} } /// eosio::chain
@@ -1,6 +1,7 @@
 #pragma once
 #include <eosio/chain/controller.hpp>
 #include <eosio/chain/trace.hpp>
+#include <eosio/chain/access_set.hpp>
 #include <signal.h>
 
 namespace eosio { namespace chain {
@@ -20,6 +21,12 @@ namespace eosio { namespace chain {
 
    class transaction_context {
       private:
+         transaction_context( controller& c,
+                              optional<signed_transaction>&& owned,
+                              const signed_transaction& t,
+                              const transaction_id_type& trx_id,
+                              fc::time_point start );
+
          void init( uint64_t initial_net_usage);
 
       public:
@@ -29,6 +36,12 @@ namespace eosio { namespace chain {
                               const transaction_id_type& trx_id,
                               fc::time_point start = fc::time_point::now() );
 
+         /// takes ownership of a transaction that is not needed after it is executed, so exec moves its actions into their traces
+         transaction_context( controller& c,
+                              signed_transaction&& t,
+                              const transaction_id_type& trx_id,
+                              fc::time_point start = fc::time_point::now() );
+
          void init_for_implicit_trx( uint64_t initial_net_usage = 0 );
 
          void init_for_input_trx( uint64_t packed_trx_unprunable_size,
@@ -68,12 +81,19 @@ namespace eosio { namespace chain {
          inline void dispatch_action( action_trace& trace, const action& a, bool context_free = false ) {
             dispatch_action(trace, a, a.account, context_free);
          };
+         /// moves the action into the trace, which the action is then applied from, instead of copying it
+         void dispatch_action( action_trace& trace, action&& a, account_name receiver, bool context_free = false, uint32_t recurse_depth = 0 );
+         /// applies the action without copying it into the trace, the caller moves it there once the transaction is done with it
+         void dispatch_owned_action( action_trace& trace, const action& a, account_name receiver );
          void schedule_transaction();
          void record_transaction( const transaction_id_type& id, fc::time_point_sec expire );
 
          void validate_cpu_usage_to_bill( int64_t u, bool check_minimum = true )const;
 
       /// Fields:
+      private:
+         optional<signed_transaction>  owned_trx; ///< must precede trx, which refers to it when set
+
       public:
 
          controller&                   control;
@@ -103,6 +123,9 @@ namespace eosio { namespace chain {
          int64_t                       billed_cpu_time_us = 0;
          bool                          explicit_billed_cpu_time = false;
 
+         bool                          track_state_access = false;
+         access_set                    state_access; ///< only recorded if track_state_access
+
       private:
          bool                          is_initialized = false;
 
@@ -187,6 +187,9 @@ namespace eosio { namespace chain {
       account_history_object_type,              ///< Defined by history_plugin
       action_history_object_type,               ///< Defined by history_plugin
       reversible_block_object_type,
+      feature_activation_object_type,
+      authorization_version_object_type,
+      database_header_object_type,
       OBJECT_TYPE_COUNT ///< Sentry value which contains the number of different object types
    };
 
@@ -0,0 +1,73 @@
+/**
+ *  @file
+ *  @copyright defined in eos/LICENSE
+ */
+#pragma once
+#include <eosio/chain/types.hpp>
+#include <eosio/chain/wasm_interface.hpp>
+
+#include <boost/interprocess/mapped_region.hpp>
+
+#include <list>
+#include <map>
+
+namespace eosio { namespace chain {
+
+   /**
+    * Persistent cache of contracts prepared for instantiation: the code after the eosio injections and the initial
+    * memory image of its data segments, so that a restart does not have to parse, inject and serialize them again.
+    *
+    * Each entry is a file named after the code hash. Its header records the runtime and the injection version it was
+    * prepared with and a hash of its contents, entries that do not match are removed when loaded. Loaded entries are
+    * read through a memory mapping. Beyond max_size bytes of entries, the least recently stored or loaded entries are
+    * removed, the order is kept across restarts through the modification time of the files.
+    *
+    * The machine code generated by WAVM is not cached, it embeds the addresses of the intrinsics and of the memory,
+    * table and globals of the instance, which differ from one process to the next. Neither are wabt's parsed modules,
+    * which cannot be serialized. Entries record how long preparing them took, so that the time a restart saves by
+    * loading them can be measured against the time spent reading them.
+    */
+   class wasm_code_cache {
+      public:
+         struct entry {
+            std::shared_ptr<boost::interprocess::mapped_region> region;
+            const char*                                          code = nullptr;
+            size_t                                               code_size = 0;
+            std::vector<uint8_t>                                 initial_memory;
+            fc::microseconds                                     prepare_time; ///< taken when the entry was stored
+         };
+
+         /// @param max_size bytes of entries kept, 0 for no limit
+         wasm_code_cache( const fc::path& dir, wasm_interface::vm_type vm, uint64_t max_size = 0 );
+
+         optional<entry> load( const digest_type& code_id );
+         void store( const digest_type& code_id, const std::vector<uint8_t>& code, const std::vector<uint8_t>& initial_memory,
+                     fc::microseconds prepare_time = fc::microseconds() );
+
+         /// @return the code of the contracts that were cached in memory at the last shutdown, most recently used first
+         vector<digest_type> read_hot_list()const;
+         /// failures are logged, the list only saves work on the next start
+         void write_hot_list( const vector<digest_type>& code_ids );
+
+         uint64_t size()const { return total_size; }
+
+      private:
+         struct file_info {
+            uint64_t                          size = 0;
+            std::list<digest_type>::iterator  lru_position;
+         };
+
+         fc::path entry_file( const digest_type& code_id )const;
+         void     used( const digest_type& code_id, uint64_t size );
+         void     remove( const digest_type& code_id );
+         void     evict( const digest_type& keep );
+
+         fc::path                          dir;
+         wasm_interface::vm_type           vm;
+         uint64_t                          max_size = 0;
+         uint64_t                          total_size = 0;
+         std::map<digest_type, file_info>  files;
+         std::list<digest_type>            lru; ///< most recently used first
+   };
+
+} } /// eosio::chain
@@ -19,6 +19,10 @@
 
 namespace eosio { namespace chain { namespace wasm_injections {
    using namespace IR;
+
+   // must be incremented whenever the injected code changes, it invalidates the code prepared by earlier versions
+   constexpr uint32_t injection_version = 1;
+
    // helper functions for injection
 
    struct injector_utils {
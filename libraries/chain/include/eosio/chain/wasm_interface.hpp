@@ -17,12 +17,17 @@ namespace eosio { namespace chain {
    namespace webassembly { namespace common {
       class intrinsics_accessor;
 
+      //false for intrinsics whose feature is not active yet, contracts importing them can not be set before it is
+      bool is_intrinsic_activated(const controller& control, const string& export_name);
+
       struct root_resolver : Runtime::Resolver {
          //when validating is true; only allow "env" imports. Otherwise allow any imports. This resolver is used
          //in two cases: once by the generic validating code where we only want "env" to pass; and then second in the
          //wavm runtime where we need to allow linkage to injected functions
-         root_resolver(bool validating = false) : validating(validating) {}
+         //when control is set, intrinsics that are not activated can not be imported either
+         root_resolver(bool validating = false, const controller* control = nullptr) : validating(validating), control(control) {}
          bool validating;
+         const controller* control;
 
          bool resolve(const string& mod_name,
                       const string& export_name,
@@ -33,6 +38,9 @@ namespace eosio { namespace chain {
          //  are in a different module
          if(validating && mod_name != "env")
             EOS_ASSERT( false, wasm_exception, "importing from module that is not 'env': ${module}.${export}", ("module",mod_name)("export",export_name) );
+         if(control)
+            EOS_ASSERT( is_intrinsic_activated(*control, export_name), unsupported_feature,
+                        "importing ${module}.${export} before its feature is activated", ("module",mod_name)("export",export_name) );
 
          // Try to resolve an intrinsic first.
          if(Runtime::IntrinsicResolver::singleton.resolve(mod_name,export_name,type, out)) {
@@ -56,7 +64,10 @@ namespace eosio { namespace chain {
             wabt
          };
 
-         wasm_interface(vm_type vm);
+         /// @param max_cache_size estimated bytes of instantiated modules kept, least recently used are evicted beyond it
+         /// @param code_cache_dir where prepared code is persisted across restarts, empty to disable
+         /// @param max_code_cache_size bytes of prepared code kept in code_cache_dir, 0 for no limit
+         wasm_interface(vm_type vm, uint64_t max_cache_size, const fc::path& code_cache_dir = fc::path(), uint64_t max_code_cache_size = 0);
          ~wasm_interface();
 
          //validates code -- does a WASM validation pass and checks the wasm against EOSIO specific constraints
@@ -65,6 +76,13 @@ namespace eosio { namespace chain {
          //Calls apply or error on a given code
          void apply(const digest_type& code_id, const shared_string& code, apply_context& context);
 
+         //Instantiates code on a background thread so that the first apply of it does not have to. WAVM cannot
+         //compile while contracts run, so it only instantiates code ahead at startup, before returning
+         void precompile(const digest_type& code_id, bytes code, bool startup = false);
+
+         //Instantiates ahead the contracts that were in use at the last shutdown, from the code cache
+         void precompile_hot_list();
+
          //Immediately exits currently running wasm. UB is called when no wasm running
          void exit();
 
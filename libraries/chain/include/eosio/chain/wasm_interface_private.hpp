@@ -5,10 +5,18 @@
 #include <eosio/chain/webassembly/wabt.hpp>
 #include <eosio/chain/webassembly/runtime_interface.hpp>
 #include <eosio/chain/wasm_eosio_injection.hpp>
+#include <eosio/chain/wasm_code_cache.hpp>
 #include <eosio/chain/transaction_context.hpp>
 #include <eosio/chain/exceptions.hpp>
+#include <eosio/chain/config.hpp>
 #include <fc/scoped_exit.hpp>
 
+#include <boost/asio/thread_pool.hpp>
+#include <boost/asio/post.hpp>
+
+#include <list>
+#include <mutex>
+
 #include "IR/Module.h"
 #include "Runtime/Intrinsics.h"
 #include "Platform/Platform.h"
@@ -23,13 +31,47 @@ using namespace Runtime;
 namespace eosio { namespace chain {
 
    struct wasm_interface_impl {
-      wasm_interface_impl(wasm_interface::vm_type vm) {
+      using module_ptr = std::shared_ptr<wasm_instantiated_module_interface>;
+
+      /// the time the code cache saves, measured while instantiating and logged at shutdown
+      struct code_cache_stats {
+         uint32_t          loaded = 0;
+         fc::microseconds  load_time;
+         fc::microseconds  saved_prepare_time; ///< recorded in the loaded entries
+         uint32_t          prepared = 0;
+         fc::microseconds  prepare_time;
+         fc::microseconds  instantiate_time; ///< by the runtime, of loaded and prepared code
+      };
+
+      struct cached_module {
+         module_ptr                          module;
+         uint64_t                            size = 0; ///< estimated memory used by the instantiated module
+         std::list<digest_type>::iterator    lru_position;
+      };
+
+      wasm_interface_impl(wasm_interface::vm_type vm, uint64_t max_cache_size, const fc::path& code_cache_dir, uint64_t max_code_cache_size)
+      : compile_in_background(vm != wasm_interface::vm_type::wavm)
+      , max_cache_size(max_cache_size) {
          if(vm == wasm_interface::vm_type::wavm)
             runtime_interface = std::make_unique<webassembly::wavm::wavm_runtime>();
          else if(vm == wasm_interface::vm_type::wabt)
             runtime_interface = std::make_unique<webassembly::wabt_runtime::wabt_runtime>();
          else
             EOS_THROW(wasm_exception, "wasm_interface_impl fall through");
+         if(!code_cache_dir.empty())
+            code_cache = std::make_unique<wasm_code_cache>(code_cache_dir, vm, max_code_cache_size);
+      }
+
+      ~wasm_interface_impl() {
+         compile_pool.stop();
+         compile_pool.join();
+         if( code_cache ) {
+            code_cache->write_hot_list( vector<digest_type>( lru.begin(), lru.end() ) );
+            ilog( "code cache: ${l} contracts loaded in ${lt} ms instead of ${st} ms preparing them, "
+                  "${p} prepared in ${pt} ms, ${it} ms instantiating them in the runtime",
+                  ("l", stats.loaded)("lt", stats.load_time.count() / 1000)("st", stats.saved_prepare_time.count() / 1000)
+                  ("p", stats.prepared)("pt", stats.prepare_time.count() / 1000)("it", stats.instantiate_time.count() / 1000) );
+         }
       }
 
       std::vector<uint8_t> parse_initial_memory(const Module& module) {
@@ -50,47 +92,181 @@ namespace eosio { namespace chain {
          return mem_image;
       }
 
-      std::unique_ptr<wasm_instantiated_module_interface>& get_instantiated_module( const digest_type& code_id,
-                                                                                    const shared_string& code,
-                                                                                    transaction_context& trx_context )
+      module_ptr get_instantiated_module( const digest_type& code_id,
+                                          const shared_string& code,
+                                          transaction_context& trx_context )
       {
-         auto it = instantiation_cache.find(code_id);
-         if(it == instantiation_cache.end()) {
-            auto timer_pause = fc::make_scoped_exit([&](){
-               trx_context.resume_billing_timer();
-            });
-            trx_context.pause_billing_timer();
-            IR::Module module;
-            try {
-               Serialization::MemoryInputStream stream((const U8*)code.data(), code.size());
-               WASM::serialize(stream, module);
-               module.userSections.clear();
-            } catch(const Serialization::FatalSerializationException& e) {
-               EOS_ASSERT(false, wasm_serialization_error, e.message.c_str());
-            } catch(const IR::ValidationException& e) {
-               EOS_ASSERT(false, wasm_serialization_error, e.message.c_str());
-            }
+         if( auto cached = find_cached( code_id ) )
+            return cached;
+
+         auto timer_pause = fc::make_scoped_exit([&](){
+            trx_context.resume_billing_timer();
+         });
+         trx_context.pause_billing_timer();
+
+         std::lock_guard<std::mutex> compile_lock( wasm_runtime_mutex() );
+         // it may have been compiled in the background while waiting for the lock
+         if( auto cached = find_cached( code_id ) )
+            return cached;
+         uint64_t size = 0;
+         auto module = instantiate( code_id, code.data(), code.size(), size );
+         return cache( code_id, std::move( module ), size );
+      }
+
+      /**
+       * instantiate code on the compile thread unless it is cached or already queued. WAVM compiles with global state
+       * that its calls use too, so its code is only instantiated ahead at startup, right away, as nothing runs yet.
+       */
+      void precompile( const digest_type& code_id, bytes code, bool startup ) {
+         if( !compile_in_background ) {
+            if( startup )
+               compile( code_id, code );
+            return;
+         }
+         {
+            std::lock_guard<std::mutex> cache_lock( cache_mutex );
+            if( instantiation_cache.count( code_id ) || !queued.insert( code_id ).second )
+               return;
+         }
+         boost::asio::post( compile_pool, [this, code_id, code{std::move( code )}]() {
+            auto dequeue = fc::make_scoped_exit( [&]() {
+               std::lock_guard<std::mutex> cache_lock( cache_mutex );
+               queued.erase( code_id );
+            } );
+            compile( code_id, code );
+         } );
+      }
+
+      /// instantiate the contracts of the last shutdown's hot list that are in the code cache, most recently used first
+      void precompile_hot_list() {
+         if( !code_cache )
+            return;
+         auto code_ids = code_cache->read_hot_list();
+         ilog( "precompiling ${n} contracts cached at the last shutdown", ("n", code_ids.size()) );
+         for( const auto& code_id : code_ids )
+            precompile( code_id, bytes(), true );
+      }
 
-            wasm_injections::wasm_binary_injection injector(module);
-            injector.inject();
-
-            std::vector<U8> bytes;
-            try {
-               Serialization::ArrayOutputStream outstream;
-               WASM::serialize(outstream, module);
-               bytes = outstream.getBytes();
-            } catch(const Serialization::FatalSerializationException& e) {
-               EOS_ASSERT(false, wasm_serialization_error, e.message.c_str());
-            } catch(const IR::ValidationException& e) {
-               EOS_ASSERT(false, wasm_serialization_error, e.message.c_str());
+   private:
+      void compile( const digest_type& code_id, const bytes& code ) {
+         std::lock_guard<std::mutex> compile_lock( wasm_runtime_mutex() );
+         if( find_cached( code_id ) )
+            return;
+         try {
+            uint64_t size = 0;
+            auto module = instantiate( code_id, code.empty() ? nullptr : code.data(), code.size(), size );
+            if( module )
+               cache( code_id, std::move( module ), size );
+         } catch( const fc::exception& e ) {
+            // invalid code fails again when applied, where the error is reported to the transaction
+            wlog( "unable to precompile wasm ${id}: ${e}", ("id", code_id)("e", e.to_string()) );
+         }
+      }
+
+      module_ptr find_cached( const digest_type& code_id ) {
+         std::lock_guard<std::mutex> cache_lock( cache_mutex );
+         auto it = instantiation_cache.find( code_id );
+         if( it == instantiation_cache.end() )
+            return module_ptr();
+         lru.splice( lru.begin(), lru, it->second.lru_position );
+         return it->second.module;
+      }
+
+      /// add module to the cache and evict the least recently used modules over max_cache_size, other than module
+      module_ptr cache( const digest_type& code_id, module_ptr module, uint64_t size ) {
+         std::lock_guard<std::mutex> cache_lock( cache_mutex );
+         auto inserted = instantiation_cache.emplace( code_id, cached_module{module, size} );
+         if( !inserted.second )
+            return inserted.first->second.module;
+         lru.push_front( code_id );
+         inserted.first->second.lru_position = lru.begin();
+         cache_size += size;
+
+         while( cache_size > max_cache_size && lru.size() > 1 ) {
+            auto evicted = instantiation_cache.find( lru.back() );
+            cache_size -= evicted->second.size;
+            instantiation_cache.erase( evicted );
+            lru.pop_back();
+         }
+         return module;
+      }
+
+      /**
+       * Must be called with wasm_runtime_mutex() held, injection and the runtimes keep global state while instantiating.
+       * @param code may be null to only instantiate code found in the code cache
+       * @return null if code is null and code_id is not in the code cache
+       */
+      module_ptr instantiate( const digest_type& code_id, const char* code, size_t code_size, uint64_t& estimated_size ) {
+         if( code_cache ) {
+            const auto start = fc::time_point::now();
+            if( auto prepared = code_cache->load( code_id ) ) {
+               const auto loaded = fc::time_point::now();
+               estimated_size = prepared->code_size * config::setcode_ram_bytes_multiplier + prepared->initial_memory.size();
+               auto module = runtime_interface->instantiate_module( prepared->code, prepared->code_size, std::move( prepared->initial_memory ) );
+               ++stats.loaded;
+               stats.load_time += loaded - start;
+               stats.saved_prepare_time += prepared->prepare_time;
+               stats.instantiate_time += fc::time_point::now() - loaded;
+               return module;
             }
-            it = instantiation_cache.emplace(code_id, runtime_interface->instantiate_module((const char*)bytes.data(), bytes.size(), parse_initial_memory(module))).first;
          }
-         return it->second;
+         if( !code )
+            return module_ptr();
+
+         const auto start = fc::time_point::now();
+
+         IR::Module module;
+         try {
+            Serialization::MemoryInputStream stream((const U8*)code, code_size);
+            WASM::serialize(stream, module);
+            module.userSections.clear();
+         } catch(const Serialization::FatalSerializationException& e) {
+            EOS_ASSERT(false, wasm_serialization_error, e.message.c_str());
+         } catch(const IR::ValidationException& e) {
+            EOS_ASSERT(false, wasm_serialization_error, e.message.c_str());
+         }
+
+         wasm_injections::wasm_binary_injection injector(module);
+         injector.inject();
+
+         std::vector<U8> bytes;
+         try {
+            Serialization::ArrayOutputStream outstream;
+            WASM::serialize(outstream, module);
+            bytes = outstream.getBytes();
+         } catch(const Serialization::FatalSerializationException& e) {
+            EOS_ASSERT(false, wasm_serialization_error, e.message.c_str());
+         } catch(const IR::ValidationException& e) {
+            EOS_ASSERT(false, wasm_serialization_error, e.message.c_str());
+         }
+         auto initial_memory = parse_initial_memory(module);
+         const auto prepare_time = fc::time_point::now() - start;
+         if( code_cache )
+            code_cache->store( code_id, bytes, initial_memory, prepare_time );
+         // compiled code is not measurable through the runtime interface, estimate it like setcode RAM billing does
+         estimated_size = bytes.size() * config::setcode_ram_bytes_multiplier + initial_memory.size();
+         const auto stored = fc::time_point::now();
+         auto instantiated = runtime_interface->instantiate_module((const char*)bytes.data(), bytes.size(), std::move(initial_memory));
+         ++stats.prepared;
+         stats.prepare_time += prepare_time;
+         stats.instantiate_time += fc::time_point::now() - stored;
+         return instantiated;
       }
 
+   public:
       std::unique_ptr<wasm_runtime_interface> runtime_interface;
-      map<digest_type, std::unique_ptr<wasm_instantiated_module_interface>> instantiation_cache;
+
+   private:
+      const bool                              compile_in_background; ///< false for WAVM
+      std::unique_ptr<wasm_code_cache>        code_cache;
+      code_cache_stats                        stats; ///< guarded by wasm_runtime_mutex()
+      const uint64_t                          max_cache_size;
+      uint64_t                                cache_size = 0;
+      map<digest_type, cached_module>         instantiation_cache;
+      std::list<digest_type>                  lru; ///< most recently used first
+      set<digest_type>                        queued; ///< waiting for compile_pool
+      std::mutex                              cache_mutex; ///< guards the above
+      boost::asio::thread_pool                compile_pool{1}; ///< one thread, instantiation is serialized by wasm_runtime_mutex() anyway
    };
 
 #define _REGISTER_INTRINSIC_EXPLICIT(CLS, MOD, METHOD, WASM_SIG, NAME, SIG)\
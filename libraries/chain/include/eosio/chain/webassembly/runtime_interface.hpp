@@ -1,6 +1,7 @@
 #pragma once
 #include <vector>
 #include <memory>
+#include <mutex>
 
 namespace eosio { namespace chain {
 
@@ -23,4 +24,11 @@ class wasm_runtime_interface {
       virtual ~wasm_runtime_interface();
 };
 
+/**
+ * WASM deserialization, injection and IR function types are process wide state that is not thread safe. Validation
+ * and instantiation hold this mutex, so they are serialized with the background compilation of contracts. WAVM does
+ * not compile in the background, as its JIT state is also used by every call.
+ */
+std::mutex& wasm_runtime_mutex();
+
 }}
\ No newline at end of file
@@ -1,4 +1,5 @@
 #include <eosio/chain/merkle.hpp>
+#include <eosio/chain/sha256_batch.hpp>
 #include <fc/io/raw.hpp>
 
 namespace eosio { namespace chain {
@@ -32,6 +33,12 @@ bool is_canonical_right(const digest_type& val) {
 }
 
 
+digest_type hash_canonical_pair(const digest_type& l, const digest_type& r) {
+   digest_type pair[2] = { make_canonical_left(l), make_canonical_right(r) };
+   sha256_pairs(pair, 1, pair);
+   return pair[0];
+}
+
 digest_type merkle(vector<digest_type> ids) {
    if( 0 == ids.size() ) { return digest_type(); }
 
@@ -39,9 +46,12 @@ digest_type merkle(vector<digest_type> ids) {
       if( ids.size() % 2 )
          ids.push_back(ids.back());
 
-      for (size_t i = 0; i < ids.size() / 2; i++) {
-         ids[i] = digest_type::hash(make_canonical_pair(ids[2 * i], ids[(2 * i) + 1]));
+      for (size_t i = 0; i < ids.size(); i += 2) {
+         ids[i] = make_canonical_left(ids[i]);
+         ids[i + 1] = make_canonical_right(ids[i + 1]);
       }
+      // the whole level is hashed in one batch, several pairs at a time when the cpu allows it
+      sha256_pairs(ids.data(), ids.size() / 2, ids.data());
 
       ids.resize(ids.size() / 2);
    }
@@ -6,6 +6,7 @@
 #include <boost/tuple/tuple_io.hpp>
 #include <eosio/chain/database_utils.hpp>
 #include <algorithm>
+#include <unordered_map>
 
 namespace eosio { namespace chain { namespace resource_limits {
 
@@ -47,6 +48,84 @@ void resource_limits_state_object::update_virtual_net_limit( const resource_limi
    virtual_net_limit = update_elastic_limit(virtual_net_limit, average_block_net_usage.average(), cfg.net_limit_parameters);
 }
 
+struct resource_limits_manager::pending_account_usage {
+   usage_accumulator net_usage;
+   usage_accumulator cpu_usage;
+};
+
+/**
+ * Every change is journaled with the usage_sequence of the resource_limits_state_object it was made at. Undoing a
+ * transaction or block undoes the sequence along with the rest of the database, and the changes made after the
+ * restored sequence are rewound before the accumulator is next used.
+ */
+struct resource_limits_manager::pending_usage_accumulator {
+   struct journal_entry {
+      uint64_t                          sequence;
+      account_name                      account;
+      optional<pending_account_usage>   previous; ///< empty when the account had no pending usage
+   };
+
+   std::unordered_map<account_name, pending_account_usage>  accounts;
+   vector<journal_entry>                                    journal;
+};
+
+resource_limits_manager::resource_limits_manager(chainbase::database& db)
+:_db(db)
+,_pending_usage(std::make_unique<pending_usage_accumulator>())
+{
+}
+
+resource_limits_manager::~resource_limits_manager() = default;
+
+void resource_limits_manager::rewind_pending_usage()const {
+   const auto& state = _db.get<resource_limits_state_object>();
+   auto& journal = _pending_usage->journal;
+   while( !journal.empty() && journal.back().sequence > state.usage_sequence ) {
+      const auto& entry = journal.back();
+      if( entry.previous ) {
+         _pending_usage->accounts[entry.account] = *entry.previous;
+      } else {
+         _pending_usage->accounts.erase( entry.account );
+      }
+      journal.pop_back();
+   }
+}
+
+uint64_t resource_limits_manager::next_usage_sequence() {
+   rewind_pending_usage();
+   const auto& state = _db.get<resource_limits_state_object>();
+   _db.modify(state, [](resource_limits_state_object& rls){
+      ++rls.usage_sequence;
+   });
+   return state.usage_sequence;
+}
+
+resource_limits_manager::pending_account_usage& resource_limits_manager::modify_pending_usage( const account_name& account, uint64_t sequence ) {
+   auto& accounts = _pending_usage->accounts;
+   auto itr = accounts.find( account );
+   if( itr != accounts.end() ) {
+      _pending_usage->journal.push_back( {sequence, account, itr->second} );
+      return itr->second;
+   }
+
+   const auto& usage = _db.get<resource_usage_object,by_owner>( account );
+   _pending_usage->journal.push_back( {sequence, account, optional<pending_account_usage>()} );
+   return accounts.emplace( account, pending_account_usage{usage.net_usage, usage.cpu_usage} ).first->second;
+}
+
+void resource_limits_manager::get_account_usage( const account_name& account, uint64_t& net_usage_ex, uint64_t& cpu_usage_ex )const {
+   rewind_pending_usage();
+   auto itr = _pending_usage->accounts.find( account );
+   if( itr != _pending_usage->accounts.end() ) {
+      net_usage_ex = itr->second.net_usage.value_ex;
+      cpu_usage_ex = itr->second.cpu_usage.value_ex;
+   } else {
+      const auto& usage = _db.get<resource_usage_object,by_owner>( account );
+      net_usage_ex = usage.net_usage.value_ex;
+      cpu_usage_ex = usage.cpu_usage.value_ex;
+   }
+}
+
 void resource_limits_manager::add_indices() {
    resource_index_set::add_indices(_db);
 }
@@ -75,9 +154,34 @@ void resource_limits_manager::add_to_snapshot( const snapshot_writer_ptr& snapsh
    });
 }
 
-void resource_limits_manager::read_from_snapshot( const snapshot_reader_ptr& snapshot ) {
-   resource_index_set::walk_indices([this, &snapshot]( auto utils ){
-      snapshot->read_section<typename decltype(utils)::index_t::value_type>([this]( auto& section ) {
+void resource_limits_manager::read_from_snapshot( const snapshot_reader_ptr& snapshot, uint32_t version ) {
+   _pending_usage->accounts.clear();
+   _pending_usage->journal.clear();
+
+   resource_index_set::walk_indices([this, &snapshot, version]( auto utils ){
+      using value_t = typename decltype(utils)::index_t::value_type;
+
+      // usage_sequence is 0 between blocks, so it is left at its default for snapshots that do not have it
+      if( std::is_same<value_t, resource_limits_state_object>::value && version < 3 ) {
+         snapshot->read_section<value_t>([this]( auto& section ) {
+            legacy::snapshot_resource_limits_state_object_v2 legacy_state;
+            section.read_row(legacy_state, _db);
+            _db.create<resource_limits_state_object>([&]( auto& state ) {
+               state.average_block_net_usage = legacy_state.average_block_net_usage;
+               state.average_block_cpu_usage = legacy_state.average_block_cpu_usage;
+               state.pending_net_usage       = legacy_state.pending_net_usage;
+               state.pending_cpu_usage       = legacy_state.pending_cpu_usage;
+               state.total_net_weight        = legacy_state.total_net_weight;
+               state.total_cpu_weight        = legacy_state.total_cpu_weight;
+               state.total_ram_bytes         = legacy_state.total_ram_bytes;
+               state.virtual_net_limit       = legacy_state.virtual_net_limit;
+               state.virtual_cpu_limit       = legacy_state.virtual_cpu_limit;
+            });
+         });
+         return;
+      }
+
+      snapshot->read_section<value_t>([this]( auto& section ) {
          bool more = !section.empty();
          while(more) {
             decltype(utils)::create(_db, [this, &section, &more]( auto &row ) {
@@ -110,31 +214,29 @@ void resource_limits_manager::set_block_parameters(const elastic_limit_parameter
 
 void resource_limits_manager::update_account_usage(const flat_set<account_name>& accounts, uint32_t time_slot ) {
    const auto& config = _db.get<resource_limits_config_object>();
+   const auto sequence = next_usage_sequence();
    for( const auto& a : accounts ) {
-      const auto& usage = _db.get<resource_usage_object,by_owner>( a );
-      _db.modify( usage, [&]( auto& bu ){
-          bu.net_usage.add( 0, time_slot, config.account_net_usage_average_window );
-          bu.cpu_usage.add( 0, time_slot, config.account_cpu_usage_average_window );
-      });
+      auto& usage = modify_pending_usage( a, sequence );
+      usage.net_usage.add( 0, time_slot, config.account_net_usage_average_window );
+      usage.cpu_usage.add( 0, time_slot, config.account_cpu_usage_average_window );
    }
 }
 
 void resource_limits_manager::add_transaction_usage(const flat_set<account_name>& accounts, uint64_t cpu_usage, uint64_t net_usage, uint32_t time_slot ) {
    const auto& state = _db.get<resource_limits_state_object>();
    const auto& config = _db.get<resource_limits_config_object>();
+   const auto sequence = next_usage_sequence();
 
    for( const auto& a : accounts ) {
 
-      const auto& usage = _db.get<resource_usage_object,by_owner>( a );
+      auto& usage = modify_pending_usage( a, sequence );
       int64_t unused;
       int64_t net_weight;
       int64_t cpu_weight;
       get_account_limits( a, unused, net_weight, cpu_weight );
 
-      _db.modify( usage, [&]( auto& bu ){
-          bu.net_usage.add( net_usage, time_slot, config.account_net_usage_average_window );
-          bu.cpu_usage.add( cpu_usage, time_slot, config.account_cpu_usage_average_window );
-      });
+      usage.net_usage.add( net_usage, time_slot, config.account_net_usage_average_window );
+      usage.cpu_usage.add( cpu_usage, time_slot, config.account_cpu_usage_average_window );
 
       if( cpu_weight >= 0 && state.total_cpu_weight > 0 ) {
          uint128_t window_size = config.account_cpu_usage_average_window;
@@ -324,6 +426,17 @@ void resource_limits_manager::process_account_limit_updates() {
 }
 
 void resource_limits_manager::process_block_usage(uint32_t block_num) {
+   rewind_pending_usage();
+   for( const auto& p : _pending_usage->accounts ) {
+      const auto& usage = _db.get<resource_usage_object,by_owner>( p.first );
+      _db.modify( usage, [&]( auto& bu ){
+         bu.net_usage = p.second.net_usage;
+         bu.cpu_usage = p.second.cpu_usage;
+      });
+   }
+   _pending_usage->accounts.clear();
+   _pending_usage->journal.clear();
+
    const auto& s = _db.get<resource_limits_state_object>();
    const auto& config = _db.get<resource_limits_config_object>();
    _db.modify(s, [&](resource_limits_state_object& state){
@@ -337,6 +450,8 @@ void resource_limits_manager::process_block_usage(uint32_t block_num) {
       state.update_virtual_net_limit(config);
       state.pending_net_usage = 0;
 
+      state.usage_sequence = 0; // the journal is empty again
+
    });
 
 }
@@ -371,7 +486,6 @@ int64_t resource_limits_manager::get_account_cpu_limit( const account_name& name
 account_resource_limit resource_limits_manager::get_account_cpu_limit_ex( const account_name& name, bool elastic) const {
 
    const auto& state = _db.get<resource_limits_state_object>();
-   const auto& usage = _db.get<resource_usage_object, by_owner>(name);
    const auto& config = _db.get<resource_limits_config_object>();
 
    int64_t cpu_weight, x, y;
@@ -390,7 +504,9 @@ account_resource_limit resource_limits_manager::get_account_cpu_limit_ex( const
    uint128_t all_user_weight = (uint128_t)state.total_cpu_weight;
 
    auto max_user_use_in_window = (virtual_cpu_capacity_in_window * user_weight) / all_user_weight;
-   auto cpu_used_in_window  = impl::integer_divide_ceil((uint128_t)usage.cpu_usage.value_ex * window_size, (uint128_t)config::rate_limiting_precision);
+   uint64_t net_usage_ex, cpu_usage_ex;
+   get_account_usage( name, net_usage_ex, cpu_usage_ex );
+   auto cpu_used_in_window  = impl::integer_divide_ceil((uint128_t)cpu_usage_ex * window_size, (uint128_t)config::rate_limiting_precision);
 
    if( max_user_use_in_window <= cpu_used_in_window )
       arl.available = 0;
@@ -410,7 +526,6 @@ int64_t resource_limits_manager::get_account_net_limit( const account_name& name
 account_resource_limit resource_limits_manager::get_account_net_limit_ex( const account_name& name, bool elastic) const {
    const auto& config = _db.get<resource_limits_config_object>();
    const auto& state  = _db.get<resource_limits_state_object>();
-   const auto& usage  = _db.get<resource_usage_object, by_owner>(name);
 
    int64_t net_weight, x, y;
    get_account_limits( name, x, net_weight, y );
@@ -429,7 +544,9 @@ account_resource_limit resource_limits_manager::get_account_net_limit_ex( const
 
 
    auto max_user_use_in_window = (virtual_network_capacity_in_window * user_weight) / all_user_weight;
-   auto net_used_in_window  = impl::integer_divide_ceil((uint128_t)usage.net_usage.value_ex * window_size, (uint128_t)config::rate_limiting_precision);
+   uint64_t net_usage_ex, cpu_usage_ex;
+   get_account_usage( name, net_usage_ex, cpu_usage_ex );
+   auto net_used_in_window  = impl::integer_divide_ceil((uint128_t)net_usage_ex * window_size, (uint128_t)config::rate_limiting_precision);
 
    if( max_user_use_in_window <= net_used_in_window )
       arl.available = 0;
@@ -0,0 +1,287 @@
+/**
+ *  @file
+ *  @copyright defined in eos/LICENSE
+ */
+#include <eosio/chain/sha256_batch.hpp>
+#include <eosio/chain/exceptions.hpp>
+
+#include <algorithm>
+#include <atomic>
+
+#if defined(__x86_64__)
+#include <cpuid.h>
+#include <immintrin.h>
+#define EOSIO_SHA256_X86
+#define EOSIO_TARGET_SHA_NI __attribute__((target("sha,sse4.1")))
+#define EOSIO_TARGET_AVX2   __attribute__((target("avx2")))
+#endif
+
+namespace eosio { namespace chain {
+
+static_assert( sizeof(digest_type) == 32, "pairs of digests are hashed straight from memory" );
+
+namespace {
+
+const uint32_t round_constants[64] = {
+   0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+   0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+   0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+   0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+   0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+   0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+   0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+   0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+const uint32_t initial_state[8] = {
+   0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+};
+
+void generic_pairs( const digest_type* in, size_t count, digest_type* out ) {
+   for( size_t i = 0; i < count; ++i ) {
+      const auto pair = std::make_pair( in[2*i], in[2*i+1] );
+      out[i] = digest_type::hash( pair );
+   }
+}
+
+#ifdef EOSIO_SHA256_X86
+
+/// second block of a 64 byte message: the end marker and the length in bits
+alignas(16) const uint8_t padding_block[64] = {
+   0x80, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+   0,    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+   0,    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+   0,    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0x02, 0x00
+};
+
+uint32_t load_be32( const uint8_t* p ) {
+   return (uint32_t(p[0]) << 24) | (uint32_t(p[1]) << 16) | (uint32_t(p[2]) << 8) | uint32_t(p[3]);
+}
+
+void store_digest( const uint32_t state[8], digest_type& out ) {
+   auto* bytes = reinterpret_cast<uint8_t*>( out.data() );
+   for( int i = 0; i < 8; ++i ) {
+      bytes[4*i]   = uint8_t( state[i] >> 24 );
+      bytes[4*i+1] = uint8_t( state[i] >> 16 );
+      bytes[4*i+2] = uint8_t( state[i] >> 8 );
+      bytes[4*i+3] = uint8_t( state[i] );
+   }
+}
+
+struct cpu_features {
+   bool sha_ni = false;
+   bool avx2 = false;
+};
+
+cpu_features detect_cpu_features() {
+   cpu_features features;
+   unsigned eax = 0, ebx = 0, ecx = 0, edx = 0;
+   if( __get_cpuid_max( 0, nullptr ) < 7 || !__get_cpuid( 1, &eax, &ebx, &ecx, &edx ) )
+      return features;
+
+   const bool sse41 = (ecx & bit_SSSE3) && (ecx & bit_SSE4_1);
+   bool os_saves_ymm = false;
+   if( (ecx & bit_OSXSAVE) && (ecx & bit_AVX) ) {
+      uint32_t xcr0_lo, xcr0_hi;
+      __asm__ volatile( "xgetbv" : "=a"(xcr0_lo), "=d"(xcr0_hi) : "c"(0) );
+      os_saves_ymm = (xcr0_lo & 0x6) == 0x6;
+   }
+
+   __cpuid_count( 7, 0, eax, ebx, ecx, edx );
+   features.sha_ni = sse41 && (ebx & bit_SHA);
+   features.avx2 = os_saves_ymm && (ebx & bit_AVX2);
+   return features;
+}
+
+const cpu_features& cpu() {
+   static const cpu_features features = detect_cpu_features();
+   return features;
+}
+
+/// compresses blocks of 64 bytes into state with the SHA extensions
+EOSIO_TARGET_SHA_NI void compress_sha_ni( uint32_t state[8], const uint8_t* data, size_t blocks ) {
+   const __m128i byte_swap = _mm_set_epi64x( 0x0c0d0e0f08090a0bull, 0x0405060700010203ull );
+
+   // the rounds instructions take the state as ABEF and CDGH
+   __m128i tmp = _mm_shuffle_epi32( _mm_loadu_si128( reinterpret_cast<const __m128i*>( state ) ), 0xB1 );
+   __m128i cdgh = _mm_shuffle_epi32( _mm_loadu_si128( reinterpret_cast<const __m128i*>( state + 4 ) ), 0x1B );
+   __m128i abef = _mm_alignr_epi8( tmp, cdgh, 8 );
+   cdgh = _mm_blend_epi16( cdgh, tmp, 0xF0 );
+
+   for( ; blocks > 0; --blocks, data += 64 ) {
+      const __m128i abef_save = abef;
+      const __m128i cdgh_save = cdgh;
+
+      // w[i & 3] holds the message words of rounds 4*i to 4*i+3 until replaced by those of 4*i+16
+      __m128i w[4];
+      for( int i = 0; i < 16; ++i ) {
+         if( i < 4 ) {
+            w[i] = _mm_shuffle_epi8( _mm_loadu_si128( reinterpret_cast<const __m128i*>( data + 16 * i ) ), byte_swap );
+         } else {
+            const __m128i sum = _mm_add_epi32( _mm_sha256msg1_epu32( w[i & 3], w[(i + 1) & 3] ),
+                                               _mm_alignr_epi8( w[(i + 3) & 3], w[(i + 2) & 3], 4 ) );
+            w[i & 3] = _mm_sha256msg2_epu32( sum, w[(i + 3) & 3] );
+         }
+         __m128i wk = _mm_add_epi32( w[i & 3], _mm_loadu_si128( reinterpret_cast<const __m128i*>( round_constants + 4 * i ) ) );
+         cdgh = _mm_sha256rnds2_epu32( cdgh, abef, wk );
+         wk = _mm_shuffle_epi32( wk, 0x0E );
+         abef = _mm_sha256rnds2_epu32( abef, cdgh, wk );
+      }
+
+      abef = _mm_add_epi32( abef, abef_save );
+      cdgh = _mm_add_epi32( cdgh, cdgh_save );
+   }
+
+   tmp = _mm_shuffle_epi32( abef, 0x1B );
+   cdgh = _mm_shuffle_epi32( cdgh, 0xB1 );
+   _mm_storeu_si128( reinterpret_cast<__m128i*>( state ), _mm_blend_epi16( tmp, cdgh, 0xF0 ) );
+   _mm_storeu_si128( reinterpret_cast<__m128i*>( state + 4 ), _mm_alignr_epi8( cdgh, tmp, 8 ) );
+}
+
+void sha_ni_pairs( const digest_type* in, size_t count, digest_type* out ) {
+   for( size_t i = 0; i < count; ++i ) {
+      uint32_t state[8];
+      std::copy( initial_state, initial_state + 8, state );
+      compress_sha_ni( state, reinterpret_cast<const uint8_t*>( in + 2*i ), 1 );
+      compress_sha_ni( state, padding_block, 1 );
+      store_digest( state, out[i] );
+   }
+}
+
+EOSIO_TARGET_AVX2 inline __m256i rotr( __m256i x, int n ) {
+   return _mm256_or_si256( _mm256_srli_epi32( x, n ), _mm256_slli_epi32( x, 32 - n ) );
+}
+
+EOSIO_TARGET_AVX2 inline __m256i add( __m256i a, __m256i b ) {
+   return _mm256_add_epi32( a, b );
+}
+
+EOSIO_TARGET_AVX2 inline __m256i xor3( __m256i a, __m256i b, __m256i c ) {
+   return _mm256_xor_si256( _mm256_xor_si256( a, b ), c );
+}
+
+/// compresses one block of each of eight messages, message j in lane j
+EOSIO_TARGET_AVX2 void compress_x8( __m256i state[8], __m256i w[16] ) {
+   __m256i a = state[0], b = state[1], c = state[2], d = state[3];
+   __m256i e = state[4], f = state[5], g = state[6], h = state[7];
+
+   for( int t = 0; t < 64; ++t ) {
+      if( t >= 16 ) {
+         const __m256i w15 = w[(t - 15) & 15];
+         const __m256i w2 = w[(t - 2) & 15];
+         const __m256i s0 = xor3( rotr( w15, 7 ), rotr( w15, 18 ), _mm256_srli_epi32( w15, 3 ) );
+         const __m256i s1 = xor3( rotr( w2, 17 ), rotr( w2, 19 ), _mm256_srli_epi32( w2, 10 ) );
+         w[t & 15] = add( add( w[t & 15], s0 ), add( w[(t - 7) & 15], s1 ) );
+      }
+
+      const __m256i s1 = xor3( rotr( e, 6 ), rotr( e, 11 ), rotr( e, 25 ) );
+      const __m256i ch = _mm256_xor_si256( _mm256_and_si256( e, f ), _mm256_andnot_si256( e, g ) );
+      const __m256i t1 = add( add( add( h, s1 ), add( ch, w[t & 15] ) ), _mm256_set1_epi32( round_constants[t] ) );
+      const __m256i s0 = xor3( rotr( a, 2 ), rotr( a, 13 ), rotr( a, 22 ) );
+      const __m256i maj = xor3( _mm256_and_si256( a, b ), _mm256_and_si256( a, c ), _mm256_and_si256( b, c ) );
+      const __m256i t2 = add( s0, maj );
+
+      h = g; g = f; f = e; e = add( d, t1 );
+      d = c; c = b; b = a; a = add( t1, t2 );
+   }
+
+   state[0] = add( state[0], a ); state[1] = add( state[1], b );
+   state[2] = add( state[2], c ); state[3] = add( state[3], d );
+   state[4] = add( state[4], e ); state[5] = add( state[5], f );
+   state[6] = add( state[6], g ); state[7] = add( state[7], h );
+}
+
+/// hashes the eight pairs starting at in, reading all of them before writing out
+EOSIO_TARGET_AVX2 void avx2_pairs_x8( const digest_type* in, digest_type* out ) {
+   alignas(32) uint32_t lanes[8];
+   __m256i w[16];
+   for( int t = 0; t < 16; ++t ) {
+      for( int j = 0; j < 8; ++j )
+         lanes[j] = load_be32( reinterpret_cast<const uint8_t*>( in + 2*j ) + 4*t );
+      w[t] = _mm256_load_si256( reinterpret_cast<const __m256i*>( lanes ) );
+   }
+
+   __m256i state[8];
+   for( int i = 0; i < 8; ++i )
+      state[i] = _mm256_set1_epi32( initial_state[i] );
+   compress_x8( state, w );
+
+   for( int t = 0; t < 16; ++t )
+      w[t] = _mm256_set1_epi32( load_be32( padding_block + 4*t ) );
+   compress_x8( state, w );
+
+   uint32_t digests[8][8];
+   for( int i = 0; i < 8; ++i ) {
+      _mm256_store_si256( reinterpret_cast<__m256i*>( lanes ), state[i] );
+      for( int j = 0; j < 8; ++j )
+         digests[j][i] = lanes[j];
+   }
+   for( int j = 0; j < 8; ++j )
+      store_digest( digests[j], out[j] );
+}
+
+void avx2_pairs( const digest_type* in, size_t count, digest_type* out ) {
+   size_t i = 0;
+   for( ; i + 8 <= count; i += 8 )
+      avx2_pairs_x8( in + 2*i, out + i );
+   generic_pairs( in + 2*i, count - i, out + i );
+}
+
+#endif
+
+sha256_backend best_backend() {
+#ifdef EOSIO_SHA256_X86
+   if( cpu().sha_ni ) return sha256_backend::sha_ni;
+   if( cpu().avx2 ) return sha256_backend::avx2;
+#endif
+   return sha256_backend::generic;
+}
+
+std::atomic<sha256_backend>& selected_backend() {
+   static std::atomic<sha256_backend> backend( best_backend() );
+   return backend;
+}
+
+} /// anonymous namespace
+
+bool sha256_backend_supported( sha256_backend backend ) {
+   switch( backend ) {
+      case sha256_backend::generic: return true;
+#ifdef EOSIO_SHA256_X86
+      case sha256_backend::avx2:    return cpu().avx2;
+      case sha256_backend::sha_ni:  return cpu().sha_ni;
+#else
+      case sha256_backend::avx2:
+      case sha256_backend::sha_ni:  return false;
+#endif
+   }
+   return false;
+}
+
+sha256_backend get_sha256_backend() {
+   return selected_backend().load( std::memory_order_relaxed );
+}
+
+void set_sha256_backend( sha256_backend backend ) {
+   EOS_ASSERT( sha256_backend_supported( backend ), unsupported_feature,
+               "sha256 backend ${b} is not supported by this cpu", ("b", static_cast<uint32_t>( backend )) );
+   selected_backend().store( backend, std::memory_order_relaxed );
+}
+
+void sha256_pairs( const digest_type* in, size_t count, digest_type* out ) {
+   switch( get_sha256_backend() ) {
+#ifdef EOSIO_SHA256_X86
+      case sha256_backend::sha_ni:
+         sha_ni_pairs( in, count, out );
+         return;
+      case sha256_backend::avx2:
+         avx2_pairs( in, count, out );
+         return;
+#endif
+      default:
+         generic_pairs( in, count, out );
+         return;
+   }
+}
+
+} } /// eosio::chain
@@ -7,6 +7,8 @@
 #include <eosio/chain/transaction_object.hpp>
 #include <eosio/chain/global_property_object.hpp>
 
+#include <fc/scoped_exit.hpp>
+
 #pragma push_macro("N")
 #undef N
 #include <boost/accumulators/accumulators.hpp>
@@ -149,8 +151,26 @@ namespace bacc = boost::accumulators;
                                              const signed_transaction& t,
                                              const transaction_id_type& trx_id,
                                              fc::time_point s )
-   :control(c)
-   ,trx(t)
+   :transaction_context( c, optional<signed_transaction>(), t, trx_id, s )
+   {
+   }
+
+   transaction_context::transaction_context( controller& c,
+                                             signed_transaction&& t,
+                                             const transaction_id_type& trx_id,
+                                             fc::time_point s )
+   :transaction_context( c, optional<signed_transaction>( std::move(t) ), t, trx_id, s )
+   {
+   }
+
+   transaction_context::transaction_context( controller& c,
+                                             optional<signed_transaction>&& owned,
+                                             const signed_transaction& t,
+                                             const transaction_id_type& trx_id,
+                                             fc::time_point s )
+   :owned_trx(std::move(owned))
+   ,control(c)
+   ,trx(owned_trx.valid() ? *owned_trx : t)
    ,id(trx_id)
    ,undo_session()
    ,trace(std::make_shared<transaction_trace>())
@@ -225,6 +245,14 @@ namespace bacc = boost::accumulators;
       }
       validate_ram_usage.reserve( bill_to_accounts.size() );
 
+      if( track_state_access ) {
+         // the usage and limits of the billed accounts are read to bound the transaction and updated when it is billed
+         for( const auto& a : bill_to_accounts ) {
+            state_access.record_read( config::system_account_name, a, N(bandwidth) );
+            state_access.record_write( config::system_account_name, a, N(bandwidth) );
+         }
+      }
+
       // Update usage values of accounts to reflect new time
       rl.update_account_usage( bill_to_accounts, block_timestamp_type(control.pending_block_time()).slot );
 
@@ -338,7 +366,19 @@ namespace bacc = boost::accumulators;
          }
       }
 
-      if( delay == fc::microseconds() ) {
+      if( delay == fc::microseconds() && owned_trx.valid() ) {
+         // actions may read the whole transaction while they run, so they are only moved into their traces at the end
+         const auto first = trace->action_traces.size();
+         auto move_actions = fc::make_scoped_exit([this, first](){
+            for( auto i = first; i < trace->action_traces.size(); ++i ) {
+               trace->action_traces[i].act = std::move( owned_trx->actions[i - first] );
+            }
+         });
+         for( const auto& act : trx.actions ) {
+            trace->action_traces.emplace_back();
+            dispatch_owned_action( trace->action_traces.back(), act, act.account );
+         }
+      } else if( delay == fc::microseconds() ) {
          for( const auto& act : trx.actions ) {
             trace->action_traces.emplace_back();
             dispatch_action( trace->action_traces.back(), act );
@@ -404,10 +444,12 @@ namespace bacc = boost::accumulators;
    }
 
    void transaction_context::squash() {
+      block_profiler::scope database( control.get_block_profiler(), profile_phase::database );
       if (undo_session) undo_session->squash();
    }
 
    void transaction_context::undo() {
+      block_profiler::scope database( control.get_block_profiler(), profile_phase::database );
       if (undo_session) undo_session->undo();
    }
 
@@ -525,6 +567,11 @@ namespace bacc = boost::accumulators;
    void transaction_context::add_ram_usage( account_name account, int64_t ram_delta ) {
       auto& rl = control.get_mutable_resource_limits_manager();
       rl.add_pending_ram_usage( account, ram_delta );
+      if( track_state_access ) {
+         // verify_account_ram_usage reads the usage back against the limit when the transaction is finalized
+         state_access.record_read( config::system_account_name, account, N(ram) );
+         state_access.record_write( config::system_account_name, account, N(ram) );
+      }
       if( ram_delta > 0 ) {
          validate_ram_usage.insert( account );
       }
@@ -574,7 +621,22 @@ namespace bacc = boost::accumulators;
       acontext.exec( trace );
    }
 
+   void transaction_context::dispatch_action( action_trace& trace, action&& a, account_name receiver, bool context_free, uint32_t recurse_depth ) {
+      trace.act = std::move(a);
+      dispatch_action( trace, trace.act, receiver, context_free, recurse_depth );
+   }
+
+   void transaction_context::dispatch_owned_action( action_trace& trace, const action& a, account_name receiver ) {
+      apply_context  acontext( control, *this, a );
+      acontext.receiver        = receiver;
+      acontext.defer_trace_act = true;
+
+      acontext.exec( trace );
+   }
+
    void transaction_context::schedule_transaction() {
+      state_access.serial = true;
+
       // Charge ahead of time for the additional net usage needed to retire the delayed transaction
       // whether that be by successfully executing, soft failure, hard failure, or expiration.
       if( trx.delay_sec.value == 0 ) { // Do not double bill. Only charge if we have not already charged for the delay.
@@ -0,0 +1,232 @@
+/**
+ *  @file
+ *  @copyright defined in eos/LICENSE
+ */
+#include <eosio/chain/wasm_code_cache.hpp>
+#include <eosio/chain/wasm_eosio_injection.hpp>
+#include <eosio/chain/exceptions.hpp>
+#include <fc/io/raw.hpp>
+
+#include <boost/filesystem.hpp>
+#include <boost/interprocess/file_mapping.hpp>
+
+#include <algorithm>
+#include <ctime>
+#include <fstream>
+#include <regex>
+
+namespace eosio { namespace chain {
+
+namespace detail {
+
+   struct wasm_code_cache_header {
+      static constexpr uint32_t expected_magic = 0x43534145; ///< "EASC"
+      static constexpr uint32_t current_format = 2;
+
+      uint32_t     magic = expected_magic;
+      uint32_t     format = current_format;
+      uint32_t     injection_version = wasm_injections::injection_version;
+      uint32_t     vm = 0;
+      digest_type  code_id;
+      uint64_t     code_size = 0;
+      uint64_t     initial_memory_size = 0;
+      int64_t      prepare_time_us = 0; ///< parsing, injecting and serializing the code it replaces
+      digest_type  checksum; ///< of the code followed by the initial memory
+   };
+
+   digest_type payload_checksum( const char* code, size_t code_size, const char* initial_memory, size_t initial_memory_size ) {
+      digest_type::encoder enc;
+      enc.write( code, code_size );
+      enc.write( initial_memory, initial_memory_size );
+      return enc.result();
+   }
+
+}
+
+} } /// eosio::chain
+
+FC_REFLECT( eosio::chain::detail::wasm_code_cache_header,
+            (magic)(format)(injection_version)(vm)(code_id)(code_size)(initial_memory_size)(prepare_time_us)(checksum) )
+
+namespace eosio { namespace chain {
+
+namespace bip = boost::interprocess;
+using detail::wasm_code_cache_header;
+using detail::payload_checksum;
+
+wasm_code_cache::wasm_code_cache( const fc::path& dir, wasm_interface::vm_type vm, uint64_t max_size )
+:dir( dir ), vm( vm ), max_size( max_size )
+{
+   if( !fc::is_directory( dir ) )
+      fc::create_directories( dir );
+
+   // entries of the earlier runs by their last use, unfinished writes are removed
+   static const std::regex entry_regex( "([0-9a-f]{64})\\.wasm" );
+   vector<pair<std::time_t, digest_type>> found;
+   for( fc::directory_iterator itr( dir ), end; itr != end; ++itr ) {
+      std::smatch match;
+      const fc::path file = *itr;
+      const std::string name = file.filename().generic_string();
+      if( name.size() > 4 && name.compare( name.size() - 4, 4, ".tmp" ) == 0 ) {
+         fc::remove_all( file );
+      } else if( std::regex_match( name, match, entry_regex ) ) {
+         boost::system::error_code ec;
+         const auto last_used = boost::filesystem::last_write_time( file.generic_string(), ec );
+         found.emplace_back( ec ? std::time_t(0) : last_used, digest_type( match[1].str() ) );
+      }
+   }
+   std::sort( found.begin(), found.end() );
+   for( const auto& f : found )
+      used( f.second, fc::file_size( entry_file( f.second ) ) );
+   evict( digest_type() );
+}
+
+fc::path wasm_code_cache::entry_file( const digest_type& code_id )const {
+   return dir / (code_id.str() + ".wasm");
+}
+
+/// make code_id the most recently used entry
+void wasm_code_cache::used( const digest_type& code_id, uint64_t size ) {
+   auto itr = files.find( code_id );
+   if( itr == files.end() ) {
+      lru.push_front( code_id );
+      itr = files.emplace( code_id, file_info{0, lru.begin()} ).first;
+   } else {
+      lru.splice( lru.begin(), lru, itr->second.lru_position );
+   }
+   total_size = total_size - itr->second.size + size;
+   itr->second.size = size;
+}
+
+void wasm_code_cache::remove( const digest_type& code_id ) {
+   auto itr = files.find( code_id );
+   if( itr != files.end() ) {
+      total_size -= itr->second.size;
+      lru.erase( itr->second.lru_position );
+      files.erase( itr );
+   }
+   fc::remove_all( entry_file( code_id ) );
+}
+
+/// remove the least recently used entries beyond max_size, other than keep
+void wasm_code_cache::evict( const digest_type& keep ) {
+   while( max_size && total_size > max_size && !lru.empty() && lru.back() != keep ) {
+      dlog( "removing cached contract ${id} beyond the code cache size", ("id", lru.back()) );
+      remove( lru.back() );
+   }
+}
+
+optional<wasm_code_cache::entry> wasm_code_cache::load( const digest_type& code_id ) {
+   const auto file = entry_file( code_id );
+   if( !fc::exists( file ) ) {
+      remove( code_id );
+      return optional<entry>();
+   }
+
+   try {
+      bip::file_mapping mapping( file.generic_string().c_str(), bip::read_only );
+      auto region = std::make_shared<bip::mapped_region>( mapping, bip::read_only );
+      const char* data = static_cast<const char*>( region->get_address() );
+
+      fc::datastream<const char*> ds( data, region->get_size() );
+      wasm_code_cache_header header;
+      fc::raw::unpack( ds, header );
+      const uint64_t payload_size = region->get_size() - ds.tellp();
+      if( header.magic == wasm_code_cache_header::expected_magic && header.format == wasm_code_cache_header::current_format
+          && header.injection_version == wasm_injections::injection_version && header.vm == uint32_t(vm)
+          && header.code_id == code_id && header.code_size + header.initial_memory_size == payload_size ) {
+         entry e;
+         e.code = data + ds.tellp();
+         e.code_size = header.code_size;
+         const char* initial_memory = e.code + e.code_size;
+         if( payload_checksum( e.code, e.code_size, initial_memory, header.initial_memory_size ) == header.checksum ) {
+            e.initial_memory.assign( initial_memory, initial_memory + header.initial_memory_size );
+            e.prepare_time = fc::microseconds( header.prepare_time_us );
+            used( code_id, region->get_size() );
+            // the modification time orders the entries when the cache is opened again
+            boost::system::error_code ec;
+            boost::filesystem::last_write_time( file.generic_string(), std::time( nullptr ), ec );
+            e.region = std::move( region );
+            return e;
+         }
+      }
+   } catch( const fc::exception& e ) {
+      wlog( "unable to read ${f}: ${e}", ("f", file.generic_string())("e", e.to_string()) );
+   } catch( const std::exception& e ) {
+      wlog( "unable to read ${f}: ${e}", ("f", file.generic_string())("e", e.what()) );
+   }
+
+   wlog( "removing invalid or outdated cached contract ${f}", ("f", file.generic_string()) );
+   remove( code_id );
+   return optional<entry>();
+}
+
+void wasm_code_cache::store( const digest_type& code_id, const std::vector<uint8_t>& code, const std::vector<uint8_t>& initial_memory,
+                             fc::microseconds prepare_time ) {
+   wasm_code_cache_header header;
+   header.vm = uint32_t(vm);
+   header.code_id = code_id;
+   header.code_size = code.size();
+   header.initial_memory_size = initial_memory.size();
+   header.prepare_time_us = prepare_time.count();
+   header.checksum = payload_checksum( (const char*)code.data(), code.size(), (const char*)initial_memory.data(), initial_memory.size() );
+
+   const auto file = entry_file( code_id );
+   const auto temp_file = fc::path( file.generic_string() + ".tmp" );
+   try {
+      std::ofstream out;
+      out.exceptions( std::ofstream::failbit | std::ofstream::badbit );
+      out.open( temp_file.generic_string().c_str(), std::ios::out | std::ios::binary | std::ios::trunc );
+      auto packed_header = fc::raw::pack( header );
+      out.write( packed_header.data(), packed_header.size() );
+      out.write( (const char*)code.data(), code.size() );
+      out.write( (const char*)initial_memory.data(), initial_memory.size() );
+      out.close();
+      fc::rename( temp_file, file );
+      used( code_id, packed_header.size() + code.size() + initial_memory.size() );
+      evict( code_id );
+   } catch( const fc::exception& e ) {
+      // the cache only saves work on the next start, failing to write it is not an error
+      wlog( "unable to write ${f}: ${e}", ("f", file.generic_string())("e", e.to_string()) );
+      fc::remove_all( temp_file );
+   } catch( const std::exception& e ) {
+      wlog( "unable to write ${f}: ${e}", ("f", file.generic_string())("e", e.what()) );
+      fc::remove_all( temp_file );
+   }
+}
+
+vector<digest_type> wasm_code_cache::read_hot_list()const {
+   vector<digest_type> code_ids;
+   const auto file = dir / "hot.list";
+   if( fc::exists( file ) ) {
+      try {
+         std::ifstream in( file.generic_string().c_str(), std::ios::in | std::ios::binary );
+         fc::raw::unpack( in, code_ids );
+      } catch( const fc::exception& e ) {
+         wlog( "unable to read ${f}: ${e}", ("f", file.generic_string())("e", e.to_string()) );
+         code_ids.clear();
+      }
+   }
+   return code_ids;
+}
+
+void wasm_code_cache::write_hot_list( const vector<digest_type>& code_ids ) {
+   const auto file = dir / "hot.list";
+   const auto temp_file = dir / "hot.list.tmp";
+   try {
+      std::ofstream out;
+      out.exceptions( std::ofstream::failbit | std::ofstream::badbit );
+      out.open( temp_file.generic_string().c_str(), std::ios::out | std::ios::binary | std::ios::trunc );
+      fc::raw::pack( out, code_ids );
+      out.close();
+      fc::rename( temp_file, file );
+   } catch( const fc::exception& e ) {
+      wlog( "unable to write ${f}: ${e}", ("f", file.generic_string())("e", e.to_string()) );
+      fc::remove_all( temp_file );
+   } catch( const std::exception& e ) {
+      wlog( "unable to write ${f}: ${e}", ("f", file.generic_string())("e", e.what()) );
+      fc::remove_all( temp_file );
+   }
+}
+
+} } /// eosio::chain
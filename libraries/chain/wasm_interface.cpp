@@ -28,11 +28,13 @@ namespace eosio { namespace chain {
    using namespace webassembly;
    using namespace webassembly::common;
 
-   wasm_interface::wasm_interface(vm_type vm) : my( new wasm_interface_impl(vm) ) {}
+   wasm_interface::wasm_interface(vm_type vm, uint64_t max_cache_size, const fc::path& code_cache_dir, uint64_t max_code_cache_size)
+   : my( new wasm_interface_impl(vm, max_cache_size, code_cache_dir, max_code_cache_size) ) {}
 
    wasm_interface::~wasm_interface() {}
 
    void wasm_interface::validate(const controller& control, const bytes& code) {
+      std::lock_guard<std::mutex> runtime_lock( wasm_runtime_mutex() );
       Module module;
       try {
          Serialization::MemoryInputStream stream((U8*)code.data(), code.size());
@@ -46,7 +48,7 @@ namespace eosio { namespace chain {
       wasm_validations::wasm_binary_validation validator(control, module);
       validator.validate();
 
-      root_resolver resolver(true);
+      root_resolver resolver(true, &control);
       LinkResult link_result = linkModule(module, resolver);
 
       //there are a couple opportunties for improvement here--
@@ -55,7 +57,20 @@ namespace eosio { namespace chain {
 	 }
 
    void wasm_interface::apply( const digest_type& code_id, const shared_string& code, apply_context& context ) {
-      my->get_instantiated_module(code_id, code, context.trx_context)->apply(context);
+      wasm_interface_impl::module_ptr module;
+      {
+         block_profiler::scope instantiation( context.control.get_block_profiler(), profile_phase::wasm_instantiation );
+         module = my->get_instantiated_module(code_id, code, context.trx_context);
+      }
+      module->apply(context);
+   }
+
+   void wasm_interface::precompile( const digest_type& code_id, bytes code, bool startup ) {
+      my->precompile(code_id, std::move(code), startup);
+   }
+
+   void wasm_interface::precompile_hot_list() {
+      my->precompile_hot_list();
    }
 
    void wasm_interface::exit() {
@@ -65,6 +80,19 @@ namespace eosio { namespace chain {
    wasm_instantiated_module_interface::~wasm_instantiated_module_interface() {}
    wasm_runtime_interface::~wasm_runtime_interface() {}
 
+   namespace webassembly { namespace common {
+      bool is_intrinsic_activated(const controller& control, const string& export_name) {
+         if( export_name == "db_get_batch_i64" )
+            return control.is_feature_active( config::batch_db_iteration_feature );
+         return true;
+      }
+   } }
+
+   std::mutex& wasm_runtime_mutex() {
+      static std::mutex m;
+      return m;
+   }
+
 #if defined(assert)
    #undef assert
 #endif
@@ -114,9 +142,11 @@ class privileged_api : public context_aware_api {
        *
        * Irreversiblity by fork-database is not consensus safe, therefore, this defines
        * irreversiblity only by block headers not by BFT short-cut.
+       *
+       * Always false before the feature activation hard fork, see controller::config::feature_activation_block_num.
        */
       int is_feature_active( int64_t feature_name ) {
-         return false;
+         return context.control.is_feature_active( feature_name );
       }
 
       /**
@@ -125,9 +155,12 @@ class privileged_api : public context_aware_api {
        *  fail if the feature is already pending.
        *
        *  Feature name should be base32 encoded name.
+       *
+       *  Fails with unsupported_feature before the feature activation hard fork.
        */
       void activate_feature( int64_t feature_name ) {
-         EOS_ASSERT( false, unsupported_feature, "Unsupported Hardfork Detected" );
+         mark_serial();
+         context.control.activate_feature( feature_name );
       }
 
       /**
@@ -143,16 +176,25 @@ class privileged_api : public context_aware_api {
          EOS_ASSERT(ram_bytes >= -1, wasm_execution_error, "invalid value for ram resource limit expected [-1,INT64_MAX]");
          EOS_ASSERT(net_weight >= -1, wasm_execution_error, "invalid value for net resource weight expected [-1,INT64_MAX]");
          EOS_ASSERT(cpu_weight >= -1, wasm_execution_error, "invalid value for cpu resource weight expected [-1,INT64_MAX]");
+         if( context.trx_context.track_state_access ) {
+            context.trx_context.state_access.record_write( config::system_account_name, account, N(ram) );
+            context.trx_context.state_access.record_write( config::system_account_name, account, N(bandwidth) );
+         }
          if( context.control.get_mutable_resource_limits_manager().set_account_limits(account, ram_bytes, net_weight, cpu_weight) ) {
             context.trx_context.validate_ram_usage.insert( account );
          }
       }
 
       void get_resource_limits( account_name account, int64_t& ram_bytes, int64_t& net_weight, int64_t& cpu_weight ) {
+         if( context.trx_context.track_state_access ) {
+            context.trx_context.state_access.record_read( config::system_account_name, account, N(ram) );
+            context.trx_context.state_access.record_read( config::system_account_name, account, N(bandwidth) );
+         }
          context.control.get_resource_limits_manager().get_account_limits( account, ram_bytes, net_weight, cpu_weight);
       }
 
       int64_t set_proposed_producers( array_ptr<char> packed_producer_schedule, size_t datalen) {
+         mark_serial();
          datastream<const char*> ds( packed_producer_schedule, datalen );
          vector<producer_key> producers;
          fc::raw::unpack(ds, producers);
@@ -183,6 +225,7 @@ class privileged_api : public context_aware_api {
       }
 
       void set_blockchain_parameters_packed( array_ptr<char> packed_blockchain_parameters, size_t datalen) {
+         mark_serial();
          datastream<const char*> ds( packed_blockchain_parameters, datalen );
          chain::chain_config cfg;
          fc::raw::unpack(ds, cfg);
@@ -198,12 +241,19 @@ class privileged_api : public context_aware_api {
       }
 
       void set_privileged( account_name n, bool is_priv ) {
+         mark_serial();
          const auto& a = context.db.get<account_object, by_name>( n );
          context.db.modify( a, [&]( auto& ma ){
             ma.privileged = is_priv;
          });
       }
 
+   private:
+      /// global and account state changed here is not tracked per table
+      void mark_serial() {
+         context.trx_context.state_access.serial = true;
+      }
+
 };
 
 class softfloat_api : public context_aware_api {
@@ -1248,6 +1298,11 @@ class database_api : public context_aware_api {
       int db_next_i64( int itr, uint64_t& primary ) {
          return context.db_next_i64(itr, primary);
       }
+      int db_get_batch_i64( int itr, array_ptr<char> buffer, size_t buffer_size, uint32_t& rows ) {
+         EOS_ASSERT( context.control.is_feature_active( config::batch_db_iteration_feature ), unsupported_feature,
+                     "db_get_batch_i64 is not activated" );
+         return context.db_get_batch_i64( itr, buffer, buffer_size, rows );
+      }
       int db_previous_i64( int itr, uint64_t& primary ) {
          return context.db_previous_i64(itr, primary);
       }
@@ -1740,6 +1795,7 @@ REGISTER_INTRINSICS( database_api,
    (db_remove_i64,       void(int))
    (db_get_i64,          int(int, int, int))
    (db_next_i64,         int(int, int))
+   (db_get_batch_i64,    int(int, int, int, int))
    (db_previous_i64,     int(int, int))
    (db_find_i64,         int(int64_t,int64_t,int64_t,int64_t))
    (db_lowerbound_i64,   int(int64_t,int64_t,int64_t,int64_t))
@@ -45,9 +45,12 @@ class wabt_instantiated_module : public wasm_instantiated_module_interface {
          if(_env->GetMemoryCount()) {
             Memory* memory = this_run_vars.memory = _env->GetMemory(0);
             memory->page_limits = _initial_memory_configuration;
+            //resizing zeroes any pages added back, only the pages kept past the initial data need clearing
+            const size_t kept_size = std::min(memory->data.size(), size_t(_initial_memory_configuration.initial * WABT_PAGE_SIZE));
             memory->data.resize(_initial_memory_configuration.initial * WABT_PAGE_SIZE);
-            memset(memory->data.data(), 0, memory->data.size());
             memcpy(memory->data.data(), _initial_memory.data(), _initial_memory.size());
+            if(kept_size > _initial_memory.size())
+               memset(memory->data.data() + _initial_memory.size(), 0, kept_size - _initial_memory.size());
          }
 
          _params[0].set_i64(uint64_t(context.receiver));
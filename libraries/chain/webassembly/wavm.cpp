@@ -2,6 +2,7 @@
 #include <eosio/chain/wasm_eosio_constraints.hpp>
 #include <eosio/chain/wasm_eosio_injection.hpp>
 #include <eosio/chain/apply_context.hpp>
+#include <eosio/chain/transaction_context.hpp>
 #include <eosio/chain/exceptions.hpp>
 
 #include "IR/Module.h"
@@ -12,7 +13,9 @@
 #include "Runtime/Linker.h"
 #include "Runtime/Intrinsics.h"
 
+#include <list>
 #include <mutex>
+#include <set>
 
 using namespace IR;
 using namespace Runtime;
@@ -21,6 +24,26 @@ namespace eosio { namespace chain { namespace webassembly { namespace wavm {
 
 running_instance_context the_running_instance_context;
 
+/**
+ * WAVM objects are only freed by its garbage collection over a global list of objects, which is not thread safe.
+ * Instantiation and collection are serialized here, and the instances of the modules that are still alive are the
+ * roots of the collection.
+ */
+static std::mutex                 __instances_lock;
+static std::set<ModuleInstance*>  __live_instances;
+static bool                       __instances_freed = false;
+
+class wavm_instantiated_module;
+
+/**
+ * Each memory image keeps a file descriptor open for as long as it lives, and every cached module could have one.
+ * Images are created when a module is called and only the most recently called modules keep theirs, the memory of
+ * the others is reset by copying their initial memory.
+ */
+static constexpr size_t                       __max_memory_images = 256;
+static std::mutex                             __images_lock;
+static std::list<wavm_instantiated_module*>   __images_lru; ///< modules holding an image, most recently called first
+
 class wavm_instantiated_module : public wasm_instantiated_module_interface {
    public:
       wavm_instantiated_module(ModuleInstance* instance, std::unique_ptr<Module> module, std::vector<uint8_t> initial_mem) :
@@ -29,6 +52,18 @@ class wavm_instantiated_module : public wasm_instantiated_module_interface {
          _module(std::move(module))
       {}
 
+      ~wavm_instantiated_module() {
+         {
+            std::lock_guard<std::mutex> l(__images_lock);
+            if(_memory_image)
+               release_memory_image();
+         }
+         // collected on the next instantiation rather than on every release
+         std::lock_guard<std::mutex> l(__instances_lock);
+         __live_instances.erase(_instance);
+         __instances_freed = true;
+      }
+
       void apply(apply_context& context) override {
          vector<Value> args = {Value(uint64_t(context.receiver)),
 	                       Value(uint64_t(context.act.account)),
@@ -38,6 +73,32 @@ class wavm_instantiated_module : public wasm_instantiated_module_interface {
       }
 
    private:
+      /// @return the image of the initial memory, null if the memory has to be reset by copying
+      const MemoryImage* memory_image() {
+         std::lock_guard<std::mutex> l(__images_lock);
+         if(_memory_image) {
+            __images_lru.splice(__images_lru.begin(), __images_lru, _image_position);
+            return _memory_image;
+         }
+         if(!_module->memories.defs.size())
+            return nullptr;
+         if(__images_lru.size() >= __max_memory_images)
+            __images_lru.back()->release_memory_image();
+         _memory_image = createMemoryImage(_module->memories.defs[0].type, _initial_memory);
+         if(_memory_image) {
+            __images_lru.push_front(this);
+            _image_position = __images_lru.begin();
+         }
+         return _memory_image;
+      }
+
+      /// must be called with __images_lock held, the pages the image is mapped over keep their contents
+      void release_memory_image() {
+         freeMemoryImage(_memory_image);
+         _memory_image = nullptr;
+         __images_lru.erase(_image_position);
+      }
+
       void call(const string &entry_point, const vector <Value> &args, apply_context &context) {
          try {
             FunctionInstance* call = asFunctionNullable(getInstanceExport(_instance,entry_point));
@@ -49,7 +110,11 @@ class wavm_instantiated_module : public wasm_instantiated_module_interface {
             //The memory instance is reused across all wavm_instantiated_modules, but for wasm instances
             // that didn't declare "memory", getDefaultMemory() won't see it
             MemoryInstance* default_mem = getDefaultMemory(_instance);
-            if(default_mem) {
+            const MemoryImage* image = default_mem ? memory_image() : nullptr;
+            if(image) {
+               //maps the initial memory copy-on-write, only the pages dirtied by the last call are released
+               resetMemory(default_mem, _module->memories.defs[0].type, image);
+            } else if(default_mem) {
                //reset memory resizes the sandbox'ed memory to the module's init memory size and then
                // (effectively) memzeros it all
                resetMemory(default_mem, _module->memories.defs[0].type);
@@ -79,6 +144,9 @@ class wavm_instantiated_module : public wasm_instantiated_module_interface {
       //_instance is deleted via WAVM's object garbage collection when wavm_rutime is deleted
       ModuleInstance*          _instance;
       std::unique_ptr<Module>  _module;
+      //null when the platform can't map memory images, or the module was not called recently
+      MemoryImage*             _memory_image = nullptr;
+      std::list<wavm_instantiated_module*>::iterator _image_position; ///< in __images_lru if _memory_image is set
 };
 
 
@@ -86,6 +154,13 @@ wavm_runtime::runtime_guard::runtime_guard() {
    // TODO clean this up
    //check_wasm_opcode_dispositions();
    Runtime::init();
+
+   // the injected checktime has nothing to do until the deadline timer expires, so the compiled loops and functions
+   // read the flag set by the timer's signal handler and only call into the host once it is set
+   static_assert(sizeof(deadline_timer::expired) == sizeof(I32), "deadline timer flag must be an i32");
+   FunctionInstance* checktime = asFunctionNullable(Intrinsics::find(EOSIO_INJECTED_MODULE_NAME ".checktime", FunctionType::get()));
+   if(checktime)
+      setFunctionCallFlag(checktime, (const volatile I32*)&deadline_timer::expired);
 }
 
 wavm_runtime::runtime_guard::~runtime_guard() {
@@ -119,10 +194,20 @@ std::unique_ptr<wasm_instantiated_module_interface> wavm_runtime::instantiate_mo
       EOS_ASSERT(false, wasm_serialization_error, e.message.c_str());
    }
 
+   std::lock_guard<std::mutex> l(__instances_lock);
+   if(__instances_freed) {
+      std::vector<ObjectInstance*> roots;
+      for(auto live : __live_instances)
+         roots.push_back(asObject(live));
+      Runtime::freeUnreferencedObjects(std::move(roots));
+      __instances_freed = false;
+   }
+
    eosio::chain::webassembly::common::root_resolver resolver;
    LinkResult link_result = linkModule(*module, resolver);
    ModuleInstance *instance = instantiateModule(*module, std::move(link_result.resolvedImports));
    EOS_ASSERT(instance != nullptr, wasm_exception, "Fail to Instantiate WAVM Module");
+   __live_instances.insert(instance);
 
    return std::make_unique<wavm_instantiated_module>(instance, std::move(module), initial_memory);
 }
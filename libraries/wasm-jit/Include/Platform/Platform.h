@@ -94,6 +94,18 @@ namespace Platform
 	// baseVirtualAddress must be a multiple of the preferred page size.
 	PLATFORM_API void freeVirtualPages(U8* baseVirtualAddress,Uptr numPages);
 
+	// Creates an image of numPages virtual pages holding numBytes of data followed by zeros, to be mapped by mapPageImage.
+	// Returns -1 if the platform doesn't support page images or the image couldn't be created.
+	PLATFORM_API Iptr createPageImage(const U8* data,Uptr numBytes,Uptr numPages);
+
+	// Maps the first numPages of an image copy-on-write over the specified virtual pages, replacing their contents and
+	// committing them read-write. The pages share the image's physical memory until they are written.
+	// baseVirtualAddress must be a multiple of the preferred page size.
+	PLATFORM_API void mapPageImage(U8* baseVirtualAddress,Uptr numPages,Iptr image);
+
+	// Frees an image. Pages it is mapped over keep their contents.
+	PLATFORM_API void freePageImage(Iptr image);
+
 	//
 	// Call stack and exceptions
 	//
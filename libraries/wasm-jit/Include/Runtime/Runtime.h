@@ -127,6 +127,11 @@ namespace Runtime
 	// Returns the type of a FunctionInstance.
 	RUNTIME_API const IR::FunctionType* getFunctionType(FunctionInstance* function);
 
+	// Makes the calls that WebAssembly code compiled from now on makes to a host function conditional on a host flag:
+	// the function is only called while *flag is non-zero. The flag is read on each call, so it may be set
+	// asynchronously, e.g. by a signal handler. The function must not return a value.
+	RUNTIME_API void setFunctionCallFlag(FunctionInstance* function,const volatile I32* flag);
+
 	//
 	// Tables
 	//
@@ -214,6 +219,18 @@ namespace Runtime
 	RUNTIME_API void resetGlobalInstances(ModuleInstance* moduleInstance);
 	RUNTIME_API void resetMemory(MemoryInstance* memory, IR::MemoryType& newMemoryType);
 
+	// A copy-on-write image of a module's initial memory, built from its data segments.
+	struct MemoryImage;
+
+	// Creates an image of the type's minimum pages holding initialData followed by zeros.
+	// Returns null if the platform doesn't support images, in which case memories are reset by resetMemory and a copy.
+	RUNTIME_API MemoryImage* createMemoryImage(const IR::MemoryType& type,const std::vector<U8>& initialData);
+	RUNTIME_API void freeMemoryImage(MemoryImage* image);
+
+	// Resets the memory to the type and contents of an image. The image is mapped over the memory, so this only costs
+	// the pages written since the last reset and the pages the next call writes are copied from the image on demand.
+	RUNTIME_API void resetMemory(MemoryInstance* memory, IR::MemoryType& newMemoryType, const MemoryImage* image);
+
 	// Gets an object exported by a ModuleInstance by name.
 	RUNTIME_API ObjectInstance* getInstanceExport(ModuleInstance* moduleInstance,const std::string& name);
 }
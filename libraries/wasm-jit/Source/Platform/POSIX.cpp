@@ -7,6 +7,7 @@
 #include <pthread.h>
 #include <unistd.h>
 #include <sys/mman.h>
+#include <sys/syscall.h>
 
 #include <errno.h>
 #include <signal.h>
@@ -25,6 +26,10 @@
     #define MAP_ANONYMOUS MAP_ANON
 #endif
 
+#if defined(__linux__) && !defined(MFD_CLOEXEC)
+	#define MFD_CLOEXEC 0x0001U
+#endif
+
 #ifdef __linux__
 	#include <execinfo.h>
 	#include <dlfcn.h>
@@ -107,6 +112,43 @@ namespace Platform
 		if(munmap(baseVirtualAddress,numPages << getPageSizeLog2())) { Errors::fatal("munmap failed"); }
 	}
 
+	Iptr createPageImage(const U8* data,Uptr numBytes,Uptr numPages)
+	{
+		#if defined(__linux__) && defined(SYS_memfd_create)
+			const Uptr numImageBytes = numPages << getPageSizeLog2();
+			if(numBytes > numImageBytes) { return -1; }
+			const int fd = syscall(SYS_memfd_create,"wasm-memory-image",MFD_CLOEXEC);
+			if(fd < 0) { return -1; }
+
+			// The zeros past the data stay a hole in the file, so they don't take memory until a page is read.
+			if(ftruncate(fd,numImageBytes)) { close(fd); return -1; }
+			Uptr numWrittenBytes = 0;
+			while(numWrittenBytes < numBytes)
+			{
+				const ssize_t result = pwrite(fd,data + numWrittenBytes,numBytes - numWrittenBytes,numWrittenBytes);
+				if(result < 0 && errno == EINTR) { continue; }
+				if(result <= 0) { close(fd); return -1; }
+				numWrittenBytes += result;
+			}
+			return fd;
+		#else
+			return -1;
+		#endif
+	}
+
+	void mapPageImage(U8* baseVirtualAddress,Uptr numPages,Iptr image)
+	{
+		errorUnless(isPageAligned(baseVirtualAddress));
+		// A failed MAP_FIXED mapping may have unmapped the pages already, leaving a hole in the reserved addresses.
+		if(mmap(baseVirtualAddress,numPages << getPageSizeLog2(),PROT_READ | PROT_WRITE,MAP_PRIVATE | MAP_FIXED,int(image),0) == MAP_FAILED)
+		{ Errors::fatal("mmap failed"); }
+	}
+
+	void freePageImage(Iptr image)
+	{
+		close(int(image));
+	}
+
 	bool describeInstructionPointer(Uptr ip,std::string& outDescription)
 	{
 		#if defined __linux__ || defined __FreeBSD__
@@ -85,6 +85,21 @@ namespace Platform
 		if(baseVirtualAddress && !result) { Errors::fatal("VirtualFree(MEM_RELEASE) failed"); }
 	}
 
+	Iptr createPageImage(const U8* data,Uptr numBytes,Uptr numPages)
+	{
+		return -1;
+	}
+
+	void mapPageImage(U8* baseVirtualAddress,Uptr numPages,Iptr image)
+	{
+		Errors::unreachable();
+	}
+
+	void freePageImage(Iptr image)
+	{
+		Errors::unreachable();
+	}
+
 	// The interface to the DbgHelp DLL
 	struct DbgHelp
 	{
@@ -638,11 +638,13 @@ namespace LLVMJIT
 			// Map the callee function index to either an imported function pointer or a function in this module.
 			llvm::Value* callee;
 			const FunctionType* calleeType;
+			const volatile I32* calleeCallFlag = nullptr;
 			if(imm.functionIndex < moduleContext.importedFunctionPointers.size())
 			{
 				WAVM_ASSERT_THROW(imm.functionIndex < moduleContext.moduleInstance->functions.size());
 				callee = moduleContext.importedFunctionPointers[imm.functionIndex];
 				calleeType = moduleContext.moduleInstance->functions[imm.functionIndex]->type;
+				calleeCallFlag = moduleContext.moduleInstance->functions[imm.functionIndex]->callFlag;
 			}
 			else
 			{
@@ -656,6 +658,23 @@ namespace LLVMJIT
 			auto llvmArgs = (llvm::Value**)alloca(sizeof(llvm::Value*) * calleeType->parameters.size());
 			popMultiple(llvmArgs,calleeType->parameters.size());
 
+			// If the host function has a call flag, only call it while the flag is set. The load is volatile so it is
+			// repeated on every call, even in a loop that doesn't otherwise touch memory.
+			if(calleeCallFlag)
+			{
+				auto flag = irBuilder.CreateLoad(emitLiteralPointer((const void*)calleeCallFlag,llvmI32Type->getPointerTo()),true);
+				auto callBlock = llvm::BasicBlock::Create(context,"flaggedCall",llvmFunction);
+				auto endBlock = llvm::BasicBlock::Create(context,"flaggedCallSkip",llvmFunction);
+				irBuilder.CreateCondBr(irBuilder.CreateICmpNE(flag,emitLiteral(I32(0))),callBlock,endBlock,moduleContext.likelyFalseBranchWeights);
+
+				irBuilder.SetInsertPoint(callBlock);
+				irBuilder.CreateCall(callee,llvm::ArrayRef<llvm::Value*>(llvmArgs,calleeType->parameters.size()));
+				irBuilder.CreateBr(endBlock);
+
+				irBuilder.SetInsertPoint(endBlock);
+				return;
+			}
+
 			// Call the function.
 			auto result = irBuilder.CreateCall(callee,llvm::ArrayRef<llvm::Value*>(llvmArgs,calleeType->parameters.size()));
 
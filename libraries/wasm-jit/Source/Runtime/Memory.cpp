@@ -98,6 +98,42 @@ namespace Runtime
 			causeException(Exception::Cause::outOfMemory);
    }
 
+	struct MemoryImage
+	{
+		Iptr platformImage;
+		Uptr numPages;
+	};
+
+	MemoryImage* createMemoryImage(const MemoryType& type,const std::vector<U8>& initialData)
+	{
+		WAVM_ASSERT_THROW(type.size.min <= UINTPTR_MAX);
+		const Uptr numPages = Uptr(type.size.min);
+		if(numPages == 0 || initialData.size() > (numPages << IR::numBytesPerPageLog2)) { return nullptr; }
+
+		const Iptr platformImage = Platform::createPageImage(initialData.data(),initialData.size(),numPages << getPlatformPagesPerWebAssemblyPageLog2());
+		if(platformImage == -1) { return nullptr; }
+		return new MemoryImage {platformImage,numPages};
+	}
+
+	void freeMemoryImage(MemoryImage* image)
+	{
+		if(!image) { return; }
+		Platform::freePageImage(image->platformImage);
+		delete image;
+	}
+
+	void resetMemory(MemoryInstance* memory, MemoryType& newMemoryType, const MemoryImage* image) {
+		WAVM_ASSERT_THROW(newMemoryType.size.min == image->numPages);
+		// The memory is shared by all modules: decommit whatever the last one grew past this image, and map the image
+		// over the rest.
+		memory->type.size.min = 0;
+		if(memory->numPages > image->numPages && shrinkMemory(memory, memory->numPages - image->numPages) == -1)
+			causeException(Exception::Cause::outOfMemory);
+		Platform::mapPageImage(memory->baseAddress, image->numPages << getPlatformPagesPerWebAssemblyPageLog2(), image->platformImage);
+		memory->numPages = image->numPages;
+		memory->type = newMemoryType;
+	}
+
 	Iptr growMemory(MemoryInstance* memory,Uptr numNewPages)
 	{
 		const Uptr previousNumPages = memory->numPages;
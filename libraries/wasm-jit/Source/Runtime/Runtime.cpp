@@ -136,6 +136,12 @@ namespace Runtime
 		return function->type;
 	}
 
+	void setFunctionCallFlag(FunctionInstance* function,const volatile I32* flag)
+	{
+		WAVM_ASSERT_THROW(function->type->ret == ResultType::none);
+		function->callFlag = flag;
+	}
+
 	GlobalInstance* createGlobal(GlobalType type,Value initialValue)
 	{
 		return new GlobalInstance(type,initialValue);
@@ -47,9 +47,11 @@ namespace Runtime
 		const FunctionType* type;
 		void* nativeFunction;
 		std::string debugName;
+		// If non-null, calls from WebAssembly code are skipped while the flag is zero.
+		const volatile I32* callFlag;
 
 		FunctionInstance(ModuleInstance* inModuleInstance,const FunctionType* inType,void* inNativeFunction = nullptr,const char* inDebugName = "<unidentified FunctionInstance>")
-		: GCObject(ObjectKind::function), moduleInstance(inModuleInstance), type(inType), nativeFunction(inNativeFunction), debugName(inDebugName) {}
+		: GCObject(ObjectKind::function), moduleInstance(inModuleInstance), type(inType), nativeFunction(inNativeFunction), debugName(inDebugName), callFlag(nullptr) {}
 	};
 
 	// An instance of a WebAssembly Table.
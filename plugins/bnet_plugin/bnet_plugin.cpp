@@ -335,6 +335,7 @@ namespace eosio {
         {
             _session_num = next_session_id();
             set_socket_options();
+            set_compression_options();
             _ws->binary(true);
             wlog( "open session ${n}",("n",_session_num) );
         }
@@ -352,6 +353,7 @@ namespace eosio {
          _get_block_by_number( app().get_method<methods::get_block_by_number>() )
         {
            _session_num = next_session_id();
+           set_compression_options();
            _ws->binary(true);
            wlog( "open session ${n}",("n",_session_num) );
         }
@@ -375,6 +377,12 @@ namespace eosio {
            }
         }
 
+        /**
+         * Offers permessage-deflate in the websocket handshake; frames are only
+         * compressed if both ends enable bnet-compression.
+         */
+        void set_compression_options();
+
         void run() {
            _ws->async_accept( boost::asio::bind_executor(
                              _strand,
@@ -1167,6 +1175,7 @@ namespace eosio {
          uint16_t                                               _bnet_endpoint_port = 4321;
          bool                                                   _request_trx = true;
          bool                                                   _follow_irreversible = false;
+         bool                                                   _compression = false;
 
          std::vector<std::string>                               _connect_to_peers; /// list of peers to connect to
          std::map<std::string, public_key_type>                 _peer_to_peer_id;
@@ -1383,6 +1392,7 @@ namespace eosio {
          ("bnet-threads", bpo::value<uint32_t>(), "the number of threads to use to process network messages" )
          ("bnet-connect", bpo::value<vector<string>>()->composing(), "remote endpoint of other node to connect to; Use multiple bnet-connect options as needed to compose a network" )
          ("bnet-no-trx", bpo::bool_switch()->default_value(false), "this peer will request no pending transactions from other nodes" )
+         ("bnet-compression", bpo::value<bool>()->default_value(false), "negotiate websocket permessage-deflate compression with peers" )
          ("bnet-peer-log-format", bpo::value<string>()->default_value( "[\"${_name}\" ${_ip}:${_port}]" ),
            "The string used to format peers when logging messages about them.  Variables are escaped with ${<variable name>}.\n"
            "Available Variables:\n"
@@ -1425,6 +1435,7 @@ namespace eosio {
                my->_num_threads = 8;
          }
          my->_request_trx = !options.at( "bnet-no-trx" ).as<bool>();
+         my->_compression = options.at( "bnet-compression" ).as<bool>();
 
       } FC_LOG_AND_RETHROW()
    }
@@ -1556,6 +1567,16 @@ namespace eosio {
    }
 
 
+   void session::set_compression_options() {
+      if( !_net_plugin->_compression )
+         return;
+      ws::permessage_deflate pmd;
+      pmd.client_enable = true;
+      pmd.server_enable = true;
+      pmd.compLevel = 1; // blocks are relayed on the critical path, favor speed over ratio
+      _ws->set_option( pmd );
+   }
+
    void session::on( const custom_message& msg ) {
       peer_ilog(this, "received custom message with type ${type}", ("type", msg.type));
       auto handler_itr = _net_plugin->_custom_handlers.find(msg.type);
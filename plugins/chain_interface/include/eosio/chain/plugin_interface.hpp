@@ -9,6 +9,7 @@
 
 #include <eosio/chain/block.hpp>
 #include <eosio/chain/block_state.hpp>
+#include <eosio/chain/block_profiler.hpp>
 #include <eosio/chain/transaction_metadata.hpp>
 #include <eosio/chain/trace.hpp>
 
@@ -29,6 +30,7 @@ namespace eosio { namespace chain { namespace plugin_interface {
       using irreversible_block     = channel_decl<struct irreversible_block_tag,    block_state_ptr>;
       using accepted_transaction   = channel_decl<struct accepted_transaction_tag,  transaction_metadata_ptr>;
       using applied_transaction    = channel_decl<struct applied_transaction_tag,   transaction_trace_ptr>;
+      using block_profiled         = channel_decl<struct block_profiled_tag,        block_profile_ptr>;
    }
 
    namespace methods {
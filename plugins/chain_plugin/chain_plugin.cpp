@@ -27,6 +27,15 @@
 #include <signal.h>
 #include <cstdlib>
 
+// HACK TO EXPOSE LOGGER MAP
+
+namespace fc {
+   extern std::unordered_map<std::string,logger>& get_logger_map();
+}
+
+const fc::string profile_logger_name("block_profiler");
+fc::logger _profile_log;
+
 namespace eosio {
 
 //declare operator<< and validate funciton for read_mode in the same namespace as read_mode itself
@@ -146,6 +155,7 @@ public:
    ,irreversible_block_channel(app().get_channel<channels::irreversible_block>())
    ,accepted_transaction_channel(app().get_channel<channels::accepted_transaction>())
    ,applied_transaction_channel(app().get_channel<channels::applied_transaction>())
+   ,block_profiled_channel(app().get_channel<channels::block_profiled>())
    ,incoming_block_channel(app().get_channel<incoming::channels::block>())
    ,incoming_block_sync_method(app().get_method<incoming::methods::block_sync>())
    ,incoming_transaction_async_method(app().get_method<incoming::methods::transaction_async>())
@@ -173,6 +183,7 @@ public:
    channels::irreversible_block::channel_type&     irreversible_block_channel;
    channels::accepted_transaction::channel_type&   accepted_transaction_channel;
    channels::applied_transaction::channel_type&    applied_transaction_channel;
+   channels::block_profiled::channel_type&         block_profiled_channel;
    incoming::channels::block::channel_type&         incoming_block_channel;
 
    // retained references to methods for easy calling
@@ -192,6 +203,7 @@ public:
    fc::optional<scoped_connection>                                   irreversible_block_connection;
    fc::optional<scoped_connection>                                   accepted_transaction_connection;
    fc::optional<scoped_connection>                                   applied_transaction_connection;
+   fc::optional<scoped_connection>                                   block_profiled_connection;
 
 };
 
@@ -208,8 +220,29 @@ void chain_plugin::set_program_options(options_description& cli, options_descrip
    cfg.add_options()
          ("blocks-dir", bpo::value<bfs::path>()->default_value("blocks"),
           "the location of the blocks directory (absolute path or relative to application data dir)")
+         ("blocks-log-stride", bpo::value<uint32_t>()->default_value(0),
+          "split the block log into segments of this many blocks, 0 keeps a single blocks.log")
+         ("max-retained-block-files", bpo::value<uint32_t>()->default_value(10),
+          "the number of completed block log segments kept in the blocks directory")
+         ("blocks-archive-dir", bpo::value<bfs::path>()->default_value("archive"),
+          "the location of the directory older block log segments are moved to (absolute path or relative to blocks dir), "
+          "if set to an empty value they are removed instead")
+         ("block-log-retain-blocks", bpo::value<uint32_t>()->default_value(0),
+          "if not 0, only keep the block log segments holding the last this many blocks; sets blocks-log-stride to the same value if it is not set")
          ("checkpoint", bpo::value<vector<string>>()->composing(), "Pairs of [BLOCK_NUM,BLOCK_ID] that should be enforced as checkpoints.")
+         ("feature-activation-block-num", bpo::value<uint32_t>()->default_value(std::numeric_limits<uint32_t>::max()),
+          "Hard fork block from which the privileged activate_feature and is_feature_active intrinsics take effect. Before it they "
+          "fail and return false as in earlier releases. Every node of a chain must be configured with the same block")
          ("wasm-runtime", bpo::value<eosio::chain::wasm_interface::vm_type>()->value_name("wavm/wabt"), "Override default WASM runtime")
+         ("wasm-cache-size-mb", bpo::value<uint64_t>()->default_value(config::default_wasm_cache_size / (1024  * 1024)),
+          "Maximum estimated size (in MiB) of instantiated contracts kept in memory, least recently used contracts are evicted beyond it")
+         ("wasm-precompile-contracts", bpo::value<uint32_t>()->default_value(config::default_wasm_precompile_contracts),
+          "Number of contracts most used in the recent blocks to compile at startup, in the background except with wavm")
+         ("wasm-code-cache-dir", bpo::value<bfs::path>()->default_value("code_cache"),
+          "the location of the prepared contract code kept across restarts (absolute path or relative to application data dir), "
+          "an empty value disables it")
+         ("wasm-code-cache-size-mb", bpo::value<uint64_t>()->default_value(config::default_wasm_code_cache_size / (1024  * 1024)),
+          "Maximum size (in MiB) of the prepared contract code kept in wasm-code-cache-dir, least recently used contracts are removed beyond it")
          ("abi-serializer-max-time-ms", bpo::value<uint32_t>()->default_value(config::default_abi_serializer_max_time_ms),
           "Override default maximum ABI serialization time allowed in ms")
          ("chain-state-db-size-mb", bpo::value<uint64_t>()->default_value(config::default_state_size / (1024  * 1024)), "Maximum size (in MiB) of the chain state database")
@@ -222,6 +255,11 @@ void chain_plugin::set_program_options(options_description& cli, options_descrip
           "Number of worker threads in controller thread pool")
          ("contracts-console", bpo::bool_switch()->default_value(false),
           "print contract's output to console")
+         ("track-state-access", bpo::bool_switch()->default_value(false),
+          "Record the contract tables each transaction reads and writes, and log how many conflict-free waves the transactions of each block could execute in")
+         ("profile-blocks", bpo::bool_switch()->default_value(false),
+          "Break the time of each applied or produced block down into phases and actions; "
+          "each profile is logged as json to the block_profiler logger and exported by telemetry_plugin")
          ("actor-whitelist", boost::program_options::value<vector<string>>()->composing()->multitoken(),
           "Account added to actor whitelist (may specify multiple times)")
          ("actor-blacklist", boost::program_options::value<vector<string>>()->composing()->multitoken(),
@@ -404,6 +442,18 @@ void chain_plugin::plugin_initialize(const variables_map& options) {
          my->abi_serializer_max_time_ms = fc::microseconds(options.at("abi-serializer-max-time-ms").as<uint32_t>() * 1000);
 
       my->chain_config->blocks_dir = my->blocks_dir;
+      my->chain_config->blocks_log_stride = options.at( "blocks-log-stride" ).as<uint32_t>();
+      my->chain_config->max_retained_block_files = options.at( "max-retained-block-files" ).as<uint32_t>();
+      my->chain_config->block_log_retain_blocks = options.at( "block-log-retain-blocks" ).as<uint32_t>();
+      {
+         auto archive_dir = options.at( "blocks-archive-dir" ).as<bfs::path>();
+         if( archive_dir.empty())
+            my->chain_config->blocks_archive_dir = bfs::path();
+         else if( archive_dir.is_relative())
+            my->chain_config->blocks_archive_dir = my->blocks_dir / archive_dir;
+         else
+            my->chain_config->blocks_archive_dir = archive_dir;
+      }
       my->chain_config->state_dir = app().data_dir() / config::default_state_dir_name;
       my->chain_config->read_only = my->readonly;
 
@@ -433,10 +483,22 @@ void chain_plugin::plugin_initialize(const variables_map& options) {
 
       if( my->wasm_runtime )
          my->chain_config->wasm_runtime = *my->wasm_runtime;
+      my->chain_config->wasm_cache_size = options.at( "wasm-cache-size-mb" ).as<uint64_t>() * 1024 * 1024;
+      my->chain_config->wasm_precompile_contracts = options.at( "wasm-precompile-contracts" ).as<uint32_t>();
+      {
+         auto code_cache_dir = options.at( "wasm-code-cache-dir" ).as<bfs::path>();
+         if( !code_cache_dir.empty() && code_cache_dir.is_relative() )
+            code_cache_dir = app().data_dir() / code_cache_dir;
+         my->chain_config->wasm_code_cache_dir = code_cache_dir;
+      }
+      my->chain_config->wasm_code_cache_size = options.at( "wasm-code-cache-size-mb" ).as<uint64_t>() * 1024 * 1024;
+      my->chain_config->feature_activation_block_num = options.at( "feature-activation-block-num" ).as<uint32_t>();
 
       my->chain_config->force_all_checks = options.at( "force-all-checks" ).as<bool>();
       my->chain_config->disable_replay_opts = options.at( "disable-replay-opts" ).as<bool>();
       my->chain_config->contracts_console = options.at( "contracts-console" ).as<bool>();
+      my->chain_config->track_state_access = options.at( "track-state-access" ).as<bool>();
+      my->chain_config->profile_blocks = options.at( "profile-blocks" ).as<bool>();
       my->chain_config->allow_ram_billing_in_notify = options.at( "disable-ram-billing-notify-checks" ).as<bool>();
 
       if( options.count( "extract-genesis-json" ) || options.at( "print-genesis-json" ).as<bool>()) {
@@ -696,6 +758,13 @@ void chain_plugin::plugin_initialize(const variables_map& options) {
                my->applied_transaction_channel.publish( priority::low, trace );
             } );
 
+      my->block_profiled_connection = my->chain->block_profiled.connect( [this]( const block_profile_ptr& profile ) {
+         fc_ilog( _profile_log, "${p}", ("p", fc::json::to_string( *profile )) );
+         my->block_profiled_channel.publish( priority::low, profile );
+      } );
+
+      handle_sighup();
+
       my->chain->add_indices();
    } FC_LOG_AND_RETHROW()
 
@@ -730,6 +799,13 @@ void chain_plugin::plugin_startup()
    my->chain_config.reset();
 } FC_CAPTURE_AND_RETHROW() }
 
+void chain_plugin::handle_sighup() {
+   auto& logger_map = fc::get_logger_map();
+   if( logger_map.find( profile_logger_name ) != logger_map.end() ) {
+      _profile_log = logger_map[profile_logger_name];
+   }
+}
+
 void chain_plugin::plugin_shutdown() {
    my->pre_accepted_block_connection.reset();
    my->accepted_block_header_connection.reset();
@@ -737,6 +813,7 @@ void chain_plugin::plugin_shutdown() {
    my->irreversible_block_connection.reset();
    my->accepted_transaction_connection.reset();
    my->applied_transaction_connection.reset();
+   my->block_profiled_connection.reset();
    my->chain->get_thread_pool().stop();
    my->chain->get_thread_pool().join();
    my->chain.reset();
@@ -15,6 +15,18 @@ namespace eosio {
       bool              connecting = false;
       bool              syncing    = false;
       handshake_message last_handshake;
+      uint64_t          block_bytes_sent = 0;          ///< size of blocks sent before compression
+      uint64_t          block_wire_bytes_sent = 0;     ///< size of blocks sent as written to the socket
+      uint64_t          block_bytes_received = 0;      ///< size of blocks received after decompression
+      uint64_t          block_wire_bytes_received = 0; ///< size of blocks received as read from the socket
+      map<string,uint64_t> bytes_sent_by_type;         ///< bytes written to the socket per message type
+      map<string,uint64_t> bytes_received_by_type;     ///< bytes read from the socket per message type
+      uint32_t          write_queue_size = 0;          ///< bytes waiting in the write queue
+      uint32_t          write_queue_messages = 0;      ///< messages waiting in the write queue
+      uint64_t          write_time_us = 0;             ///< time spent waiting on socket writes to complete
+      uint64_t          sync_blocks_sent = 0;
+      uint64_t          sync_blocks_received = 0;
+      int64_t           round_trip_us = 0;             ///< round trip delay of the last time_message exchange
    };
 
    class net_plugin : public appbase::plugin<net_plugin>
@@ -45,4 +57,7 @@ namespace eosio {
 
 }
 
-FC_REFLECT( eosio::connection_status, (peer)(connecting)(syncing)(last_handshake) )
+FC_REFLECT( eosio::connection_status, (peer)(connecting)(syncing)(last_handshake)
+            (block_bytes_sent)(block_wire_bytes_sent)(block_bytes_received)(block_wire_bytes_received)
+            (bytes_sent_by_type)(bytes_received_by_type)(write_queue_size)(write_queue_messages)(write_time_us)
+            (sync_blocks_sent)(sync_blocks_received)(round_trip_us) )
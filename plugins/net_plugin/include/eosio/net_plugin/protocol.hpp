@@ -132,6 +132,65 @@ namespace eosio {
       uint32_t end_block;
    };
 
+  enum message_compression : uint8_t {
+    compression_none = 0,
+    compression_zlib = 1
+  };
+
+  constexpr auto compression_str( message_compression c ) {
+    switch( c ) {
+    case compression_none : return "none";
+    case compression_zlib : return "zlib";
+    default: return "unknown compression";
+    }
+  }
+
+  /**
+   * Wraps another packed net_message (which + payload). Only sent to peers
+   * whose protocol version announced in the handshake supports it.
+   */
+  struct compressed_message {
+    uint8_t    compression = compression_none; ///< a message_compression value
+    uint32_t   uncompressed_size = 0; ///< size of the packed inner net_message
+    bytes      data;
+  };
+
+  /**
+   * Receipt of a compact block. Packed transactions are only referenced by id,
+   * the receiver looks them up among the transactions it has already seen.
+   */
+  struct compact_transaction_receipt : public transaction_receipt_header {
+    transaction_id_type  id;
+    bool                 packed = false; ///< true if the full block carries the packed_transaction
+  };
+
+  /**
+   * Header and transaction references of a block, sent in place of the full
+   * block to peers whose protocol version supports it.
+   */
+  struct compact_block_message {
+    signed_block_header                  header;
+    vector<compact_transaction_receipt>  transactions;
+    extensions_type                      block_extensions;
+  };
+
+  /**
+   * Asks the sender of a compact block for the transactions the receiver could not find locally.
+   */
+  struct get_block_transactions_message {
+    block_id_type     block_id;
+    vector<uint32_t>  indexes; ///< positions in the block's transactions
+  };
+
+  /**
+   * Reply to get_block_transactions_message, in the order of the requested indexes.
+   * Empty if the block is unknown to the sender.
+   */
+  struct block_transactions_message {
+    block_id_type               block_id;
+    vector<packed_transaction>  transactions;
+  };
+
    using net_message = static_variant<handshake_message,
                                       chain_size_message,
                                       go_away_message,
@@ -140,7 +199,11 @@ namespace eosio {
                                       request_message,
                                       sync_request_message,
                                       signed_block,         // which = 7
-                                      packed_transaction>;  // which = 8
+                                      packed_transaction,   // which = 8
+                                      compressed_message,   // which = 9
+                                      compact_block_message,
+                                      get_block_transactions_message,
+                                      block_transactions_message>;
 
 } // namespace eosio
 
@@ -159,6 +222,11 @@ FC_REFLECT( eosio::time_message, (org)(rec)(xmt)(dst) )
 FC_REFLECT( eosio::notice_message, (known_trx)(known_blocks) )
 FC_REFLECT( eosio::request_message, (req_trx)(req_blocks) )
 FC_REFLECT( eosio::sync_request_message, (start_block)(end_block) )
+FC_REFLECT( eosio::compressed_message, (compression)(uncompressed_size)(data) )
+FC_REFLECT_DERIVED( eosio::compact_transaction_receipt, (eosio::chain::transaction_receipt_header), (id)(packed) )
+FC_REFLECT( eosio::compact_block_message, (header)(transactions)(block_extensions) )
+FC_REFLECT( eosio::get_block_transactions_message, (block_id)(indexes) )
+FC_REFLECT( eosio::block_transactions_message, (block_id)(transactions) )
 
 /**
  *
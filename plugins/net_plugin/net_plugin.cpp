@@ -9,6 +9,7 @@
 #include <eosio/chain/controller.hpp>
 #include <eosio/chain/exceptions.hpp>
 #include <eosio/chain/block.hpp>
+#include <eosio/chain/merkle.hpp>
 #include <eosio/chain/plugin_interface.hpp>
 #include <eosio/producer_plugin/producer_plugin.hpp>
 #include <eosio/chain/contract_types.hpp>
@@ -25,6 +26,11 @@
 #include <boost/asio/ip/tcp.hpp>
 #include <boost/asio/ip/host_name.hpp>
 #include <boost/asio/steady_timer.hpp>
+#include <boost/iostreams/filtering_stream.hpp>
+#include <boost/iostreams/device/back_inserter.hpp>
+#include <boost/iostreams/filter/zlib.hpp>
+
+#include <mutex>
 
 using namespace eosio::chain::plugin_interface::compat;
 
@@ -62,6 +68,7 @@ namespace eosio {
       time_point_sec  expires;  /// time after which this may be purged.
       uint32_t        block_num = 0; /// block transaction was included in
       std::shared_ptr<vector<char>>   serialized_txn; /// the received raw bundle
+      packed_transaction_ptr          packed_trx; /// used to rebuild compact blocks
    };
 
    struct by_expiry;
@@ -99,6 +106,32 @@ namespace eosio {
       >
    node_transaction_index;
 
+   /**
+    * Original bytes of a received block or transaction, kept so that relaying
+    * it does not need to pack it again.
+    */
+   struct wire_buffers {
+      std::shared_ptr<std::vector<char>>  plain;      ///< header + uncompressed packed net_message
+      std::shared_ptr<std::vector<char>>  compressed; ///< the compressed_message as received, if any
+   };
+
+   /**
+    * A net_message unpacked on a net-threads thread. Blocks and transactions are
+    * pulled out of the variant so that their ids are computed before reaching
+    * the main thread.
+    */
+   struct unpacked_message {
+      optional<net_message>      msg;
+      signed_block_ptr           block;
+      block_id_type              block_id;
+      transaction_metadata_ptr   trx;
+      wire_buffers               raw;           ///< set for blocks and transactions
+      uint32_t                   size = 0;      ///< size of the message including header, after decompression
+      uint32_t                   wire_size = 0; ///< size of the message including header, as read from the socket
+      uint32_t                   which = 0;     ///< net_message type as read from the socket
+      bool                       known_block = false; ///< a block this node already has, left packed, only block_id is set
+   };
+
    class net_plugin_impl {
    public:
       unique_ptr<tcp::acceptor>        acceptor;
@@ -151,10 +184,19 @@ namespace eosio {
 
       node_transaction_index        local_txns;
 
+      /// checked on net-threads so that blocks this node already has are not unpacked again
+      std::mutex                    known_blocks_mtx;
+      known_block_index             known_blocks; ///< guarded by known_blocks_mtx
+      bool is_known_block( const block_id_type& id );
+
       shared_ptr<tcp::resolver>     resolver;
 
       bool                          use_socket_read_watermark = false;
 
+      bool                          compact_blocks = false; ///< relay compact blocks to peers that support them
+      message_compression           block_compression = compression_none;
+      uint32_t                      block_compression_threshold = 0; ///< blocks smaller than this are sent uncompressed
+
       channels::transaction_ack::channel_type::handle  incoming_transaction_ack_subscription;
 
       uint16_t                                  thread_pool_size = 1; // currently used by server_ioc
@@ -169,15 +211,33 @@ namespace eosio {
       void start_listen_loop();
       void start_read_message(const connection_ptr& c);
 
-      /** \brief Process the next message from the pending message buffer
+      /** \brief Unpack all complete messages from the pending message buffer
+       *
+       * Called on a net-threads thread from the read completion handler.
+       * bytes_transferred is the number of bytes just read into the
+       * pending_message_buffer. Unpacked messages are appended to msgs.
+       * Returns false and sets error if the connection should be closed.
+       */
+      bool read_messages(const connection_ptr& conn, std::size_t bytes_transferred,
+                         vector<unpacked_message>& msgs, string& error);
+
+      /** \brief Unpack the next message from the pending message buffer
        *
-       * Process the next message from the pending_message_buffer.
+       * Unpack the next message from the pending_message_buffer.
        * message_length is the already determined length of the data
-       * part of the message that will handle the message.
+       * part of the message. Runs on a net-threads thread, so besides
+       * unpacking it only precomputes what does not need chain state:
+       * block ids and transaction ids.
        * Returns true is successful. Returns false if an error was
-       * encountered unpacking or processing the message.
+       * encountered unpacking the message.
+       */
+      bool process_next_message(const connection_ptr& conn, uint32_t message_length, vector<unpacked_message>& msgs);
+
+      /** \brief Dispatch a message unpacked by process_next_message
+       *
+       * Called on the main application thread.
        */
-      bool process_next_message(const connection_ptr& conn, uint32_t message_length);
+      void handle_unpacked_message(const connection_ptr& conn, unpacked_message& msg);
 
       void close(const connection_ptr& c);
       size_t count_open_sockets() const;
@@ -211,10 +271,26 @@ namespace eosio {
       void handle_message(const connection_ptr& c, const notice_message& msg);
       void handle_message(const connection_ptr& c, const request_message& msg);
       void handle_message(const connection_ptr& c, const sync_request_message& msg);
+      void handle_message(const connection_ptr& c, const compact_block_message& msg);
+      void handle_message(const connection_ptr& c, const get_block_transactions_message& msg);
+      void handle_message(const connection_ptr& c, const block_transactions_message& msg);
       void handle_message(const connection_ptr& c, const signed_block& msg) = delete; // signed_block_ptr overload used instead
-      void handle_message(const connection_ptr& c, const signed_block_ptr& msg);
-      void handle_message(const connection_ptr& c, const packed_transaction& msg) = delete; // packed_transaction_ptr overload used instead
-      void handle_message(const connection_ptr& c, const packed_transaction_ptr& msg);
+      void handle_message(const connection_ptr& c, const signed_block_ptr& msg, const block_id_type& blk_id,
+                          const wire_buffers& raw = wire_buffers());
+      void handle_message(const connection_ptr& c, const packed_transaction& msg) = delete; // transaction_metadata_ptr overload used instead
+      void handle_message(const connection_ptr& c, const transaction_metadata_ptr& trx, const wire_buffers& raw);
+
+      /** \brief Accept the compact blocks of a connection which are complete
+       *
+       * Compact blocks are accepted in the order they were received, so a
+       * block waiting for missing transactions holds back the ones after it.
+       */
+      void accept_compact_blocks(const connection_ptr& c);
+      /** \brief Give up on rebuilding the pending compact blocks
+       *
+       * Requests the full blocks instead, starting from the first pending one.
+       */
+      void request_full_blocks(const connection_ptr& c);
 
       void start_conn_timer(boost::asio::steady_timer::duration du, std::weak_ptr<connection> from_connection);
       void start_txn_timer();
@@ -311,10 +387,24 @@ namespace eosio {
    constexpr auto     def_txn_expire_wait = std::chrono::seconds(3);
    constexpr auto     def_resp_expected_wait = std::chrono::seconds(5);
    constexpr auto     def_sync_fetch_span = 100;
+   constexpr auto     def_block_compression_threshold = 1024;
+   constexpr size_t   def_max_pending_compact_blocks = 12; // per peer, one round of a producer
 
    constexpr auto     message_header_size = 4;
    constexpr uint32_t signed_block_which = 7;        // see protocol net_message
    constexpr uint32_t packed_transaction_which = 8;  // see protocol net_message
+   constexpr uint32_t compressed_message_which = 9;  // see protocol net_message
+   constexpr uint32_t compact_block_which = 10;      // see protocol net_message
+
+   /// name of a net_message type, used for per type statistics
+   static const char* net_message_name( uint32_t which ) {
+      static const char* const names[] = {
+         "handshake", "chain_size", "go_away", "time", "notice", "request", "sync_request",
+         "signed_block", "packed_transaction", "compressed", "compact_block",
+         "get_block_transactions", "block_transactions"
+      };
+      return which < sizeof( names ) / sizeof( names[0] ) ? names[which] : "unknown";
+   }
 
    /**
     *  For a while, network version was a 16 bit value equal to the second set of 16 bits
@@ -336,8 +426,10 @@ namespace eosio {
     */
    constexpr uint16_t proto_base = 0;
    constexpr uint16_t proto_explicit_sync = 1;
+   constexpr uint16_t proto_compressed_message = 2;   // peer understands compressed_message
+   constexpr uint16_t proto_compact_block = 3;        // peer understands compact_block_message
 
-   constexpr uint16_t net_version = proto_explicit_sync;
+   constexpr uint16_t net_version = proto_compact_block;
 
    struct transaction_state {
       transaction_id_type id;
@@ -375,6 +467,15 @@ namespace eosio {
          >
       > peer_block_state_index;
 
+   /// blocks accepted by this node above the last irreversible block
+   typedef multi_index_container<
+      eosio::peer_block_state,
+      indexed_by<
+         ordered_unique< tag<by_id>, member<eosio::peer_block_state, block_id_type, &eosio::peer_block_state::id >, sha256_less >,
+         ordered_non_unique< tag<by_block_num>, member<eosio::peer_block_state, uint32_t, &eosio::peer_block_state::block_num > >
+         >
+      > known_block_index;
+
 
    struct update_block_num {
       uint32_t new_bnum;
@@ -421,6 +522,8 @@ namespace eosio {
 
       uint32_t write_queue_size() const { return _write_queue_size; }
 
+      uint32_t write_queue_count() const { return _write_queue.size() + _sync_write_queue.size(); }
+
       bool is_out_queue_empty() const { return _out_queue.empty(); }
 
       bool ready_to_send() const {
@@ -485,6 +588,41 @@ namespace eosio {
    }; // queued_buffer
 
 
+   /**
+    * Lazily created plain and compressed send buffers of a block, shared by all
+    * connections the block is sent to.
+    */
+   class block_send_buffers {
+   public:
+      explicit block_send_buffers( const signed_block_ptr& sb ) : block( sb ) {}
+      /// reuses the buffers the block was received in
+      block_send_buffers( const signed_block_ptr& sb, const wire_buffers& raw )
+      : block( sb ), plain_buffer( raw.plain ), compressed_buffer( raw.compressed ) {}
+
+      const std::shared_ptr<std::vector<char>>& plain();
+      /// falls back to the plain buffer if compression would not make it smaller
+      const std::shared_ptr<std::vector<char>>& compressed();
+      const std::shared_ptr<std::vector<char>>& compact();
+      /// creates the buffers the configured block relay can use, so that later calls only return them
+      void prepare();
+
+   private:
+      signed_block_ptr                    block;
+      std::shared_ptr<std::vector<char>>  plain_buffer;
+      std::shared_ptr<std::vector<char>>  compressed_buffer;
+      std::shared_ptr<std::vector<char>>  compact_buffer;
+   };
+
+   /**
+    * A compact block being rebuilt from locally known transactions.
+    */
+   struct pending_compact_block {
+      block_id_type       id;
+      block_header_state  header_state; ///< validated against the previous block, the next compact block can link to it
+      signed_block_ptr    block;   ///< receipts of missing transactions only hold the transaction id
+      vector<uint32_t>    missing; ///< indexes of the transactions requested from the peer
+   };
+
    class connection : public std::enable_shared_from_this<connection> {
    public:
       explicit connection( string endpoint );
@@ -497,10 +635,11 @@ namespace eosio {
       transaction_state_index trx_state;
       optional<sync_state>    peer_requested;  // this peer is requesting info from us
       std::shared_ptr<boost::asio::io_context>  server_ioc; // keep ioc alive
-      boost::asio::io_context::strand           strand;
+      boost::asio::io_context::strand           strand; // net-threads strand for socket completion handlers
       socket_ptr                                socket;
 
       fc::message_buffer<1024*1024>    pending_message_buffer;
+      deque<pending_compact_block>     pending_compact_blocks; ///< in the order received
       fc::optional<std::size_t>        outstanding_read_bytes;
 
 
@@ -508,6 +647,15 @@ namespace eosio {
 
       uint32_t                reads_in_flight = 0;
       uint32_t                trx_in_progress_size = 0;
+      uint64_t                block_bytes_sent = 0;
+      uint64_t                block_wire_bytes_sent = 0;
+      uint64_t                block_bytes_received = 0;
+      uint64_t                block_wire_bytes_received = 0;
+      vector<uint64_t>        bytes_sent_by_type;      ///< indexed by net_message which, as written to the socket
+      vector<uint64_t>        bytes_received_by_type;  ///< indexed by net_message which, as read from the socket
+      fc::microseconds        write_time;              ///< time spent waiting on async_write to complete
+      uint64_t                sync_blocks_sent = 0;
+      uint64_t                sync_blocks_received = 0;
       fc::sha256              node_id;
       handshake_message       last_handshake_recv;
       handshake_message       last_handshake_sent;
@@ -529,6 +677,22 @@ namespace eosio {
          stat.connecting = connecting;
          stat.syncing = syncing;
          stat.last_handshake = last_handshake_recv;
+         stat.block_bytes_sent = block_bytes_sent;
+         stat.block_wire_bytes_sent = block_wire_bytes_sent;
+         stat.block_bytes_received = block_bytes_received;
+         stat.block_wire_bytes_received = block_wire_bytes_received;
+         for( size_t i = 0; i < bytes_sent_by_type.size(); ++i ) {
+            if( bytes_sent_by_type[i] ) stat.bytes_sent_by_type[net_message_name( i )] = bytes_sent_by_type[i];
+         }
+         for( size_t i = 0; i < bytes_received_by_type.size(); ++i ) {
+            if( bytes_received_by_type[i] ) stat.bytes_received_by_type[net_message_name( i )] = bytes_received_by_type[i];
+         }
+         stat.write_queue_size = buffer_queue.write_queue_size();
+         stat.write_queue_messages = buffer_queue.write_queue_count();
+         stat.write_time_us = write_time.count();
+         stat.sync_blocks_sent = sync_blocks_sent;
+         stat.sync_blocks_received = sync_blocks_received;
+         stat.round_trip_us = round_trip / 1000;
          return stat;
       }
 
@@ -544,6 +708,7 @@ namespace eosio {
 
       // Computed data
       double                         offset{0};       //!< peer offset
+      double                         round_trip{0};   //!< round trip delay of the last time_message exchange
 
       static const size_t            ts_buffer_size{32};
       char                           ts[ts_buffer_size];          //!< working buffer for making human readable timestamps
@@ -585,9 +750,14 @@ namespace eosio {
 
       void enqueue( const net_message &msg, bool trigger_send = true );
       void enqueue_block( const signed_block_ptr& sb, bool trigger_send = true, bool to_sync_queue = false);
+      void enqueue_block( block_send_buffers& buffers, bool trigger_send, int priority, bool to_sync_queue );
+      void enqueue_compact_block( block_send_buffers& buffers );
+      bool accepts_compressed_blocks() const;
+      bool accepts_compact_blocks() const;
+      /// block_size is the uncompressed size of the block carried by send_buffer, if any
       void enqueue_buffer( const std::shared_ptr<std::vector<char>>& send_buffer,
                            bool trigger_send, int priority, go_away_reason close_after_send,
-                           bool to_sync_queue = false);
+                           bool to_sync_queue = false, size_t block_size = 0);
       void cancel_sync(go_away_reason);
       void flush_queues();
       bool enqueue_sync_block();
@@ -609,6 +779,11 @@ namespace eosio {
       bool add_peer_block(const peer_block_state& pbs);
       bool peer_has_block(const block_id_type& blkid);
 
+      void count_bytes( vector<uint64_t>& by_type, uint32_t which, size_t size ) {
+         if( which >= by_type.size() ) by_type.resize( which + 1 );
+         by_type[which] += size;
+      }
+
       fc::optional<fc::variant_object> _logger_variant;
       const fc::variant_object& get_logger_variant()  {
          if (!_logger_variant) {
@@ -653,11 +828,18 @@ namespace eosio {
          EOS_ASSERT( false, plugin_config_exception, "operator()(packed_transaction&&) should be called" );
       }
 
+      void operator()( const compressed_message& msg ) const {
+         EOS_ASSERT( false, plugin_config_exception, "compressed_message should be decompressed by process_next_message" );
+      }
+      void operator()( compressed_message& msg ) const {
+         EOS_ASSERT( false, plugin_config_exception, "compressed_message should be decompressed by process_next_message" );
+      }
+
       void operator()( signed_block&& msg ) const {
-         impl.handle_message( c, std::make_shared<signed_block>( std::move( msg ) ) );
+         EOS_ASSERT( false, plugin_config_exception, "signed_block should be unpacked by process_next_message" );
       }
       void operator()( packed_transaction&& msg ) const {
-         impl.handle_message( c, std::make_shared<packed_transaction>( std::move( msg ) ) );
+         EOS_ASSERT( false, plugin_config_exception, "packed_transaction should be unpacked by process_next_message" );
       }
 
       template <typename T>
@@ -707,15 +889,20 @@ namespace eosio {
    public:
       std::multimap<block_id_type, connection_ptr, sha256_less> received_blocks;
       std::multimap<transaction_id_type, connection_ptr, sha256_less> received_transactions;
+      std::map<block_id_type, block_send_buffers, sha256_less> received_block_buffers; ///< relayed as received
+      std::map<transaction_id_type, std::shared_ptr<vector<char>>, sha256_less> received_transaction_buffers; ///< relayed as received
+      optional<boost::asio::io_context::strand> bcast_strand; ///< prepares the buffers of broadcast blocks on a net thread, in order
 
       void bcast_transaction(const transaction_metadata_ptr& trx);
       void rejected_transaction(const transaction_id_type& msg);
       void bcast_block(const block_state_ptr& bs);
+      void send_block(const block_state_ptr& bs, block_send_buffers& buffers, const std::set<connection_ptr>& skips);
       void rejected_block(const block_id_type& id);
 
-      void recv_block(const connection_ptr& conn, const block_id_type& msg, uint32_t bnum);
+      void recv_block(const connection_ptr& conn, const signed_block_ptr& b, const block_id_type& msg, uint32_t bnum,
+                      const wire_buffers& raw);
       void expire_blocks( uint32_t bnum );
-      void recv_transaction(const connection_ptr& conn, const transaction_id_type& id);
+      void recv_transaction(const connection_ptr& conn, const transaction_id_type& id, const wire_buffers& raw);
       void recv_notice(const connection_ptr& conn, const notice_message& msg, bool generated);
 
       void retry_fetch(const connection_ptr& conn);
@@ -728,7 +915,7 @@ namespace eosio {
         trx_state(),
         peer_requested(),
         server_ioc( my_impl->server_ioc ),
-        strand( app().get_io_service() ),
+        strand( *my_impl->server_ioc ),
         socket( std::make_shared<tcp::socket>( std::ref( *my_impl->server_ioc ))),
         node_id(),
         last_handshake_recv(),
@@ -754,7 +941,7 @@ namespace eosio {
         trx_state(),
         peer_requested(),
         server_ioc( my_impl->server_ioc ),
-        strand( app().get_io_service() ),
+        strand( *my_impl->server_ioc ),
         socket( s ),
         node_id(),
         last_handshake_recv(),
@@ -794,6 +981,7 @@ namespace eosio {
 
    void connection::reset() {
       peer_requested.reset();
+      pending_compact_blocks.clear();
       blk_state.clear();
       trx_state.clear();
    }
@@ -823,6 +1011,11 @@ namespace eosio {
       fc_dlog(logger, "canceling wait on ${p}", ("p",peer_name()));
       cancel_wait();
       if( read_delay_timer ) read_delay_timer->cancel();
+      // the read buffer belongs to the strand, a read handler may still be using it
+      boost::asio::post( strand, [self = shared_from_this()]() {
+         self->pending_message_buffer.reset();
+         self->outstanding_read_bytes.reset();
+      });
    }
 
    void connection::blk_send_branch() {
@@ -955,14 +1148,17 @@ namespace eosio {
       std::vector<boost::asio::const_buffer> bufs;
       buffer_queue.fill_out_buffer( bufs );
 
+      const auto write_start = fc::time_point::now();
       boost::asio::async_write(*socket, bufs,
-            boost::asio::bind_executor(strand, [c, priority]( boost::system::error_code ec, std::size_t w ) {
-         app().post(priority, [c, priority, ec, w]() {
+            boost::asio::bind_executor(strand, [c, priority, write_start]( boost::system::error_code ec, std::size_t w ) {
+         const auto write_time = fc::time_point::now() - write_start;
+         app().post(priority, [c, priority, ec, w, write_time]() {
             try {
                auto conn = c.lock();
                if(!conn)
                   return;
 
+               conn->write_time += write_time;
                conn->buffer_queue.out_callback( ec, w );
 
                if(ec) {
@@ -1030,6 +1226,7 @@ namespace eosio {
          signed_block_ptr sb = cc.fetch_block_by_number(num);
          if(sb) {
             enqueue_block( sb, trigger_send, true);
+            ++sync_blocks_sent;
             return true;
          }
       } catch ( ... ) {
@@ -1091,19 +1288,183 @@ namespace eosio {
       return create_send_buffer( packed_transaction_which, trx );
    }
 
+   namespace bio = boost::iostreams;
+
+   template<size_t Limit>
+   struct decompress_limiter {
+      using char_type = char;
+      using category = bio::multichar_output_filter_tag;
+
+      template<typename Sink>
+      size_t write(Sink &sink, const char* s, size_t count)
+      {
+         EOS_ASSERT(_total + count <= Limit, plugin_exception, "Exceeded maximum decompressed message size");
+         _total += count;
+         return bio::write(sink, s, count);
+      }
+
+      size_t _total = 0;
+   };
+
+   static bytes zlib_compress( const char* data, size_t size ) {
+      bytes out;
+      bio::filtering_ostream comp;
+      comp.push( bio::zlib_compressor( bio::zlib::best_speed ) );
+      comp.push( bio::back_inserter( out ) );
+      bio::write( comp, data, size );
+      bio::close( comp );
+      return out;
+   }
+
+   /// appends the decompressed data to out
+   static void zlib_decompress( const bytes& data, std::vector<char>& out ) {
+      try {
+         bio::filtering_ostream decomp;
+         decomp.push( bio::zlib_decompressor() );
+         decomp.push( decompress_limiter<def_send_buffer_size*2>() ); // same limit as an uncompressed message
+         decomp.push( bio::back_inserter( out ) );
+         bio::write( decomp, data.data(), data.size() );
+         bio::close( decomp );
+      } catch( fc::exception& er ) {
+         throw;
+      } catch( ... ) {
+         fc::unhandled_exception er( FC_LOG_MESSAGE( warn, "internal decompression error"), std::current_exception() );
+         throw er;
+      }
+   }
+
+   /**
+    * Wraps the payload of a send buffer created by create_send_buffer into a compressed_message.
+    * Returns send_buffer itself if compression does not reduce its size.
+    */
+   static std::shared_ptr<std::vector<char>> create_compressed_send_buffer( const std::shared_ptr<std::vector<char>>& send_buffer,
+                                                                            message_compression compression ) {
+      if( compression != compression_zlib )
+         return send_buffer;
+
+      compressed_message cm;
+      cm.compression = compression;
+      cm.uncompressed_size = send_buffer->size() - message_header_size;
+      cm.data = zlib_compress( send_buffer->data() + message_header_size, cm.uncompressed_size );
+
+      auto compressed_buffer = create_send_buffer( compressed_message_which, cm );
+      if( compressed_buffer->size() >= send_buffer->size() )
+         return send_buffer;
+      return compressed_buffer;
+   }
+
+   /**
+    * Returns a send buffer, as created by create_send_buffer, of the net_message wrapped by a compressed_message.
+    */
+   static std::shared_ptr<std::vector<char>> decompress_message( const compressed_message& cm ) {
+      EOS_ASSERT( cm.compression == compression_zlib, plugin_exception,
+                  "unknown message compression ${c}", ("c", cm.compression) );
+      const uint32_t payload_size = cm.uncompressed_size;
+      auto send_buffer = std::make_shared<vector<char>>( message_header_size );
+      memcpy( send_buffer->data(), &payload_size, message_header_size );
+      send_buffer->reserve( message_header_size + payload_size );
+      zlib_decompress( cm.data, *send_buffer );
+      EOS_ASSERT( send_buffer->size() == message_header_size + payload_size, plugin_exception,
+                  "decompressed size ${s} does not match expected ${e}",
+                  ("s", send_buffer->size() - message_header_size)("e", payload_size) );
+      return send_buffer;
+   }
+
+   const std::shared_ptr<std::vector<char>>& block_send_buffers::plain() {
+      if( !plain_buffer ) {
+         plain_buffer = create_send_buffer( block );
+      }
+      return plain_buffer;
+   }
+
+   const std::shared_ptr<std::vector<char>>& block_send_buffers::compressed() {
+      if( !compressed_buffer ) {
+         const auto& buff = plain();
+         if( buff->size() < my_impl->block_compression_threshold ) {
+            compressed_buffer = buff;
+         } else {
+            compressed_buffer = create_compressed_send_buffer( buff, my_impl->block_compression );
+         }
+      }
+      return compressed_buffer;
+   }
+
+   const std::shared_ptr<std::vector<char>>& block_send_buffers::compact() {
+      if( !compact_buffer ) {
+         compact_block_message cb;
+         cb.header = *block;
+         cb.block_extensions = block->block_extensions;
+         cb.transactions.reserve( block->transactions.size() );
+         for( const auto& receipt : block->transactions ) {
+            compact_transaction_receipt cr;
+            static_cast<transaction_receipt_header&>( cr ) = receipt;
+            if( receipt.trx.contains<packed_transaction>() ) {
+               cr.id = receipt.trx.get<packed_transaction>().id();
+               cr.packed = true;
+            } else {
+               cr.id = receipt.trx.get<transaction_id_type>();
+            }
+            cb.transactions.emplace_back( std::move( cr ) );
+         }
+         compact_buffer = create_send_buffer( compact_block_which, cb );
+      }
+      return compact_buffer;
+   }
+
+   void block_send_buffers::prepare() {
+      plain();
+      if( my_impl->block_compression != compression_none ) {
+         compressed();
+      }
+      if( my_impl->compact_blocks ) {
+         compact();
+      }
+   }
+
+   bool connection::accepts_compact_blocks() const {
+      return my_impl->compact_blocks && protocol_version >= proto_compact_block;
+   }
+
+   void connection::enqueue_compact_block( block_send_buffers& buffers ) {
+      enqueue_buffer( buffers.compact(), true, priority::high, no_reason, false, buffers.plain()->size() );
+   }
+
+   bool connection::accepts_compressed_blocks() const {
+      return my_impl->block_compression != compression_none && protocol_version >= proto_compressed_message;
+   }
+
    void connection::enqueue_block( const signed_block_ptr& sb, bool trigger_send, bool to_sync_queue) {
-      enqueue_buffer( create_send_buffer( sb ), trigger_send, priority::low, no_reason, to_sync_queue);
+      block_send_buffers buffers( sb );
+      enqueue_block( buffers, trigger_send, priority::low, to_sync_queue );
+   }
+
+   void connection::enqueue_block( block_send_buffers& buffers, bool trigger_send, int priority, bool to_sync_queue ) {
+      const auto& send_buffer = accepts_compressed_blocks() ? buffers.compressed() : buffers.plain();
+      enqueue_buffer( send_buffer, trigger_send, priority, no_reason, to_sync_queue, buffers.plain()->size() );
    }
 
    void connection::enqueue_buffer( const std::shared_ptr<std::vector<char>>& send_buffer,
                                     bool trigger_send, int priority, go_away_reason close_after_send,
-                                    bool to_sync_queue)
+                                    bool to_sync_queue, size_t block_size)
    {
+      fc::datastream<const char*> peek_ds( send_buffer->data() + message_header_size, send_buffer->size() - message_header_size );
+      unsigned_int which{};
+      fc::raw::unpack( peek_ds, which );
+      const size_t size = send_buffer->size();
+
       connection_wptr weak_this = shared_from_this();
       queue_write(send_buffer,trigger_send, priority,
-                  [weak_this, close_after_send](boost::system::error_code ec, std::size_t ) {
+                  [weak_this, close_after_send, which = which.value, size, block_size](boost::system::error_code ec, std::size_t ) {
                      connection_ptr conn = weak_this.lock();
                      if (conn) {
+                        if( !ec ) {
+                           // counted once written, messages dropped from the queue or failing to write are not
+                           conn->count_bytes( conn->bytes_sent_by_type, which, size );
+                           if( block_size ) {
+                              conn->block_bytes_sent += block_size;
+                              conn->block_wire_bytes_sent += size;
+                           }
+                        }
                         if (close_after_send != no_reason) {
                            elog ("sent a go away message: ${r}, closing connection to ${p}",("r", reason_str(close_after_send))("p", conn->peer_name()));
                            my_impl->close(conn);
@@ -1176,7 +1537,11 @@ namespace eosio {
 
    void connection::fetch_timeout( boost::system::error_code ec ) {
       if( !ec ) {
-         my_impl->dispatcher->retry_fetch(shared_from_this());
+         if( !pending_compact_blocks.empty() ) {
+            my_impl->request_full_blocks(shared_from_this());
+         } else {
+            my_impl->dispatcher->retry_fetch(shared_from_this());
+         }
       }
       else if( ec == boost::asio::error::operation_aborted ) {
          if( !connected() ) {
@@ -1539,6 +1904,7 @@ namespace eosio {
             return;
          }
          sync_next_expected_num = blk_num + 1;
+         ++c->sync_blocks_received;
       }
       if (state == head_catchup) {
          fc_dlog(logger, "sync_manager in head_catchup state");
@@ -1589,10 +1955,27 @@ namespace eosio {
       }
       received_blocks.erase(range.first, range.second);
 
+      auto buffers = std::make_shared<block_send_buffers>( bs->block );
+      auto bitr = received_block_buffers.find( bs->id );
+      if( bitr != received_block_buffers.end() ) {
+         *buffers = std::move( bitr->second );
+         received_block_buffers.erase( bitr );
+      }
+
+      // serializing and compressing the block is left to a net thread, the strand and the fifo order of equal
+      // priority tasks of the application keep the blocks in order
+      boost::asio::post( *bcast_strand, [this, bs, buffers, skips{std::move( skips )}]() {
+         buffers->prepare();
+         app().post( priority::high, [this, bs, buffers, skips]() {
+            send_block( bs, *buffers, skips );
+         } );
+      } );
+   }
+
+   void dispatch_manager::send_block(const block_state_ptr& bs, block_send_buffers& buffers, const std::set<connection_ptr>& skips) {
       uint32_t bnum = bs->block_num;
       peer_block_state pbstate{bs->id, bnum};
 
-      std::shared_ptr<std::vector<char>> send_buffer;
       for( auto& cp : my_impl->connections ) {
          if( skips.find( cp ) != skips.end() || !cp->current() ) {
             continue;
@@ -1602,18 +1985,23 @@ namespace eosio {
             if( !cp->add_peer_block( pbstate ) ) {
                continue;
             }
-            if( !send_buffer ) {
-               send_buffer = create_send_buffer( bs->block );
-            }
             fc_dlog(logger, "bcast block ${b} to ${p}", ("b", bnum)("p", cp->peer_name()));
-            cp->enqueue_buffer( send_buffer, true, priority::high, no_reason );
+            if( cp->accepts_compact_blocks() ) {
+               cp->enqueue_compact_block( buffers );
+            } else {
+               cp->enqueue_block( buffers, true, priority::high, false );
+            }
          }
       }
 
    }
 
-   void dispatch_manager::recv_block(const connection_ptr& c, const block_id_type& id, uint32_t bnum) {
+   void dispatch_manager::recv_block(const connection_ptr& c, const signed_block_ptr& b, const block_id_type& id, uint32_t bnum,
+                                     const wire_buffers& raw) {
       received_blocks.insert(std::make_pair(id, c));
+      if( raw.plain ) {
+         received_block_buffers.emplace( id, block_send_buffers( b, raw ) );
+      }
       if (c &&
           c->last_req &&
           c->last_req->req_blocks.mode != none &&
@@ -1630,6 +2018,7 @@ namespace eosio {
       fc_dlog( logger, "rejected block ${id}", ("id", id) );
       auto range = received_blocks.equal_range(id);
       received_blocks.erase(range.first, range.second);
+      received_block_buffers.erase(id);
    }
 
    void dispatch_manager::expire_blocks( uint32_t lib_num ) {
@@ -1642,6 +2031,13 @@ namespace eosio {
             ++i;
          }
       }
+      for( auto i = received_block_buffers.begin(); i != received_block_buffers.end(); ) {
+         if( block_header::num_from_id( i->first ) <= lib_num ) {
+            i = received_block_buffers.erase( i );
+         } else {
+            ++i;
+         }
+      }
    }
 
    void dispatch_manager::bcast_transaction(const transaction_metadata_ptr& ptrx) {
@@ -1654,6 +2050,13 @@ namespace eosio {
       }
       received_transactions.erase(range.first, range.second);
 
+      std::shared_ptr<std::vector<char>> buff;
+      auto bitr = received_transaction_buffers.find( id );
+      if( bitr != received_transaction_buffers.end() ) {
+         buff = std::move( bitr->second );
+         received_transaction_buffers.erase( bitr );
+      }
+
       if( my_impl->local_txns.get<by_id>().find( id ) != my_impl->local_txns.end() ) { //found
          fc_dlog(logger, "found trxid in local_trxs" );
          return;
@@ -1662,9 +2065,11 @@ namespace eosio {
       time_point_sec trx_expiration = ptrx->packed_trx->expiration();
       const packed_transaction& trx = *ptrx->packed_trx;
 
-      auto buff = create_send_buffer( trx );
+      if( !buff ) {
+         buff = create_send_buffer( trx );
+      }
 
-      node_transaction_state nts = {id, trx_expiration, 0, buff};
+      node_transaction_state nts = {id, trx_expiration, 0, buff, ptrx->packed_trx};
       my_impl->local_txns.insert(std::move(nts));
 
       my_impl->send_transaction_to_all( buff, [&id, &skips, trx_expiration](const connection_ptr& c) -> bool {
@@ -1682,8 +2087,11 @@ namespace eosio {
 
    }
 
-   void dispatch_manager::recv_transaction(const connection_ptr& c, const transaction_id_type& id) {
+   void dispatch_manager::recv_transaction(const connection_ptr& c, const transaction_id_type& id, const wire_buffers& raw) {
       received_transactions.insert(std::make_pair(id, c));
+      if( raw.plain ) {
+         received_transaction_buffers.emplace( id, raw.plain );
+      }
       if (c &&
           c->last_req &&
           c->last_req->req_trx.mode != none &&
@@ -1700,6 +2108,7 @@ namespace eosio {
       fc_dlog(logger,"not sending rejected transaction ${tid}",("tid",id));
       auto range = received_transactions.equal_range(id);
       received_transactions.erase(range.first, range.second);
+      received_transaction_buffers.erase(id);
    }
 
    void dispatch_manager::recv_notice(const connection_ptr& c, const notice_message& msg, bool generated) {
@@ -1852,29 +2261,39 @@ namespace eosio {
       auto current_endpoint = *endpoint_itr;
       ++endpoint_itr;
       c->connecting = true;
-      c->pending_message_buffer.reset();
       connection_wptr weak_conn = c;
-      c->socket->async_connect( current_endpoint, boost::asio::bind_executor( c->strand,
-            [weak_conn, endpoint_itr, this]( const boost::system::error_code& err ) {
-         app().post( priority::low, [weak_conn, endpoint_itr, this, err]() {
+      // the read buffer belongs to the strand, a read handler of the previous session may still be using it
+      boost::asio::post( c->strand, [weak_conn, current_endpoint, endpoint_itr, this]() {
+         auto c = weak_conn.lock();
+         if( !c ) return;
+         c->pending_message_buffer.reset();
+         c->outstanding_read_bytes.reset();
+         app().post( priority::low, [weak_conn, current_endpoint, endpoint_itr, this]() {
             auto c = weak_conn.lock();
             if( !c ) return;
-            if( !err && c->socket->is_open()) {
-               if( start_session( c )) {
-                  c->send_handshake();
-               }
-            } else {
-               if( endpoint_itr != tcp::resolver::iterator()) {
-                  close( c );
-                  connect( c, endpoint_itr );
-               } else {
-                  fc_elog( logger, "connection failed to ${peer}: ${error}", ("peer", c->peer_name())( "error", err.message()));
-                  c->connecting = false;
-                  my_impl->close( c );
-               }
-            }
+            c->socket->async_connect( current_endpoint, boost::asio::bind_executor( c->strand,
+                  [weak_conn, endpoint_itr, this]( const boost::system::error_code& err ) {
+               app().post( priority::low, [weak_conn, endpoint_itr, this, err]() {
+                  auto c = weak_conn.lock();
+                  if( !c ) return;
+                  if( !err && c->socket->is_open()) {
+                     if( start_session( c )) {
+                        c->send_handshake();
+                     }
+                  } else {
+                     if( endpoint_itr != tcp::resolver::iterator()) {
+                        close( c );
+                        connect( c, endpoint_itr );
+                     } else {
+                        fc_elog( logger, "connection failed to ${peer}: ${error}", ("peer", c->peer_name())( "error", err.message()));
+                        c->connecting = false;
+                        my_impl->close( c );
+                     }
+                  }
+               } );
+            } ) );
          } );
-      } ) );
+      } );
    }
 
    bool net_plugin_impl::start_session(const connection_ptr& con) {
@@ -2026,60 +2445,50 @@ namespace eosio {
             conn->pending_message_buffer.get_buffer_sequence_for_boost_async_read(), completion_handler,
             boost::asio::bind_executor( conn->strand,
             [this,weak_conn]( boost::system::error_code ec, std::size_t bytes_transferred ) {
-            app().post( priority::medium, [this,weak_conn, ec, bytes_transferred]() {
+            // executed on a net-threads thread: unpack here so the main thread only handles ready messages
+            auto msgs = std::make_shared<vector<unpacked_message>>();
+            string read_error;
+            bool read_ok = true;
+            if( !ec ) {
+               auto conn = weak_conn.lock();
+               if( !conn ) {
+                  return;
+               }
+               try {
+                  read_ok = read_messages( conn, bytes_transferred, *msgs, read_error );
+               } catch( const fc::exception& ex ) {
+                  read_error = ex.to_string();
+                  read_ok = false;
+               } catch( const std::exception& ex ) {
+                  read_error = ex.what();
+                  read_ok = false;
+               } catch( ... ) {
+                  read_error = "unknown exception";
+                  read_ok = false;
+               }
+            }
+
+            app().post( priority::medium, [this,weak_conn, ec, msgs, read_ok, read_error{std::move(read_error)}]() {
                auto conn = weak_conn.lock();
                if (!conn || !conn->socket || !conn->socket->is_open()) {
                   return;
                }
 
                --conn->reads_in_flight;
-               conn->outstanding_read_bytes.reset();
 
                try {
                   if( !ec ) {
-                     if (bytes_transferred > conn->pending_message_buffer.bytes_to_write()) {
-                        fc_elog( logger,"async_read_some callback: bytes_transfered = ${bt}, buffer.bytes_to_write = ${btw}",
-                                 ("bt",bytes_transferred)("btw",conn->pending_message_buffer.bytes_to_write()) );
-                     }
-                     EOS_ASSERT(bytes_transferred <= conn->pending_message_buffer.bytes_to_write(), plugin_exception, "");
-                     conn->pending_message_buffer.advance_write_ptr(bytes_transferred);
-                     while (conn->pending_message_buffer.bytes_to_read() > 0) {
-                        uint32_t bytes_in_buffer = conn->pending_message_buffer.bytes_to_read();
-
-                        if (bytes_in_buffer < message_header_size) {
-                           conn->outstanding_read_bytes.emplace(message_header_size - bytes_in_buffer);
-                           break;
-                        } else {
-                           uint32_t message_length;
-                           auto index = conn->pending_message_buffer.read_index();
-                           conn->pending_message_buffer.peek(&message_length, sizeof(message_length), index);
-                           if(message_length > def_send_buffer_size*2 || message_length == 0) {
-                              boost::system::error_code ec;
-                              fc_elog( logger,"incoming message length unexpected (${i}), from ${p}",
-                                       ("i", message_length)("p",boost::lexical_cast<std::string>(conn->socket->remote_endpoint(ec))) );
-                              close(conn);
-                              return;
-                           }
-
-                           auto total_message_bytes = message_length + message_header_size;
-
-                           if (bytes_in_buffer >= total_message_bytes) {
-                              conn->pending_message_buffer.advance_read_ptr(message_header_size);
-                              if (!process_next_message(conn, message_length)) {
-                                 return;
-                              }
-                           } else {
-                              auto outstanding_message_bytes = total_message_bytes - bytes_in_buffer;
-                              auto available_buffer_bytes = conn->pending_message_buffer.bytes_to_write();
-                              if (outstanding_message_bytes > available_buffer_bytes) {
-                                 conn->pending_message_buffer.add_space( outstanding_message_bytes - available_buffer_bytes );
-                              }
-
-                              conn->outstanding_read_bytes.emplace(outstanding_message_bytes);
-                              break;
-                           }
+                     for( auto& m : *msgs ) {
+                        handle_unpacked_message( conn, m );
+                        if( !conn->socket->is_open() ) {
+                           return;
                         }
                      }
+                     if( !read_ok ) {
+                        fc_elog( logger, "Error handling read data from ${p}: ${e}", ("p", conn->peer_name())("e", read_error) );
+                        close( conn );
+                        return;
+                     }
                      start_read_message(conn);
                   } else {
                      auto pname = conn->peer_name();
@@ -2115,45 +2524,145 @@ namespace eosio {
       }
    }
 
-   bool net_plugin_impl::process_next_message(const connection_ptr& conn, uint32_t message_length) {
+   bool net_plugin_impl::read_messages(const connection_ptr& conn, std::size_t bytes_transferred,
+                                       vector<unpacked_message>& msgs, string& error) {
+      conn->outstanding_read_bytes.reset();
+      if (bytes_transferred > conn->pending_message_buffer.bytes_to_write()) {
+         error = "async_read_some callback: bytes_transfered = " + std::to_string( bytes_transferred ) +
+                 ", buffer.bytes_to_write = " + std::to_string( conn->pending_message_buffer.bytes_to_write() );
+         return false;
+      }
+      conn->pending_message_buffer.advance_write_ptr(bytes_transferred);
+      while (conn->pending_message_buffer.bytes_to_read() > 0) {
+         uint32_t bytes_in_buffer = conn->pending_message_buffer.bytes_to_read();
+
+         if (bytes_in_buffer < message_header_size) {
+            conn->outstanding_read_bytes.emplace(message_header_size - bytes_in_buffer);
+            break;
+         } else {
+            uint32_t message_length;
+            auto index = conn->pending_message_buffer.read_index();
+            conn->pending_message_buffer.peek(&message_length, sizeof(message_length), index);
+            if(message_length > def_send_buffer_size*2 || message_length == 0) {
+               error = "incoming message length unexpected (" + std::to_string( message_length ) + ")";
+               return false;
+            }
+
+            auto total_message_bytes = message_length + message_header_size;
+
+            if (bytes_in_buffer >= total_message_bytes) {
+               conn->pending_message_buffer.advance_read_ptr(message_header_size);
+               if (!process_next_message(conn, message_length, msgs)) {
+                  error = "unable to unpack message";
+                  return false;
+               }
+            } else {
+               auto outstanding_message_bytes = total_message_bytes - bytes_in_buffer;
+               auto available_buffer_bytes = conn->pending_message_buffer.bytes_to_write();
+               if (outstanding_message_bytes > available_buffer_bytes) {
+                  conn->pending_message_buffer.add_space( outstanding_message_bytes - available_buffer_bytes );
+               }
+
+               conn->outstanding_read_bytes.emplace(outstanding_message_bytes);
+               break;
+            }
+         }
+      }
+      return true;
+   }
+
+   bool net_plugin_impl::process_next_message(const connection_ptr& conn, uint32_t message_length, vector<unpacked_message>& msgs) {
       try {
-         // if next message is a block we already have, exit early
          auto peek_ds = conn->pending_message_buffer.create_peek_datastream();
          unsigned_int which{};
          fc::raw::unpack( peek_ds, which );
+
+         unpacked_message um;
+         um.wire_size = message_length + message_header_size;
+         um.size = um.wire_size;
+         um.which = which;
+
+         // if next message is a block we already have, exit early
          if( which == signed_block_which ) {
             block_header bh;
             fc::raw::unpack( peek_ds, bh );
-
-            controller& cc = chain_plug->chain();
             block_id_type blk_id = bh.id();
-            uint32_t blk_num = bh.block_num();
-            if( cc.fetch_block_by_id( blk_id ) ) {
-               sync_master->recv_block( conn, blk_id, blk_num );
+            if( is_known_block( blk_id ) ) {
                conn->pending_message_buffer.advance_read_ptr( message_length );
+               um.known_block = true;
+               um.block_id = blk_id;
+               msgs.emplace_back( std::move( um ) );
                return true;
             }
          }
-
-         auto ds = conn->pending_message_buffer.create_datastream();
          net_message msg;
-         fc::raw::unpack( ds, msg );
-         msg_handler m( *this, conn );
+         if( which == signed_block_which || which == packed_transaction_which || which == compressed_message_which ) {
+            // keep the received bytes, so relaying the block or transaction does not pack it again
+            auto wire = std::make_shared<vector<char>>( um.wire_size );
+            memcpy( wire->data(), &message_length, message_header_size );
+            conn->pending_message_buffer.read( wire->data() + message_header_size, message_length );
+            fc::datastream<const char*> ds( wire->data() + message_header_size, message_length );
+            fc::raw::unpack( ds, msg );
+            if( msg.contains<compressed_message>() ) {
+               um.raw.plain = decompress_message( msg.get<compressed_message>() );
+               um.raw.compressed = std::move( wire );
+               um.size = um.raw.plain->size();
+               fc::datastream<const char*> pds( um.raw.plain->data() + message_header_size, um.size - message_header_size );
+               net_message inner;
+               fc::raw::unpack( pds, inner );
+               EOS_ASSERT( !inner.contains<compressed_message>(), plugin_exception, "nested compressed_message" );
+               msg = std::move( inner );
+            } else {
+               um.raw.plain = std::move( wire );
+            }
+         } else {
+            auto ds = conn->pending_message_buffer.create_datastream();
+            fc::raw::unpack( ds, msg );
+         }
          if( msg.contains<signed_block>() ) {
-            m( std::move( msg.get<signed_block>() ) );
+            um.block = std::make_shared<signed_block>( std::move( msg.get<signed_block>() ) );
+            um.block_id = um.block->id();
          } else if( msg.contains<packed_transaction>() ) {
-            m( std::move( msg.get<packed_transaction>() ) );
+            auto ptrx = std::make_shared<packed_transaction>( std::move( msg.get<packed_transaction>() ) );
+            um.trx = std::make_shared<transaction_metadata>( ptrx );
          } else {
-            msg.visit( m );
+            um.msg.emplace( std::move( msg ) );
          }
+         msgs.emplace_back( std::move( um ) );
       } catch( const fc::exception& e ) {
          edump( (e.to_detail_string()) );
-         close( conn );
          return false;
       }
       return true;
    }
 
+   void net_plugin_impl::handle_unpacked_message(const connection_ptr& conn, unpacked_message& um) {
+      try {
+         conn->count_bytes( conn->bytes_received_by_type, um.which, um.wire_size );
+         if( um.known_block ) {
+            conn->block_bytes_received += um.size;
+            conn->block_wire_bytes_received += um.wire_size;
+            sync_master->recv_block( conn, um.block_id, block_header::num_from_id( um.block_id ) );
+         } else if( um.block ) {
+            conn->block_bytes_received += um.size;
+            conn->block_wire_bytes_received += um.wire_size;
+            handle_message( conn, um.block, um.block_id, um.raw );
+         } else if( um.trx ) {
+            handle_message( conn, um.trx, um.raw );
+         } else {
+            if( um.msg->contains<compact_block_message>() ) {
+               conn->block_bytes_received += um.size;
+               conn->block_wire_bytes_received += um.wire_size;
+            }
+            msg_handler m( *this, conn );
+            um.msg->visit( m );
+         }
+      } catch( const fc::exception& e ) {
+         edump( (e.to_detail_string()) );
+         close( conn );
+      }
+   }
+
    size_t net_plugin_impl::count_open_sockets() const
    {
       size_t count = 0;
@@ -2348,10 +2857,12 @@ namespace eosio {
          }
 
       c->offset = (double(c->rec - c->org) + double(msg.xmt - c->dst)) / 2;
+      c->round_trip = double(c->dst - c->org) - double(msg.xmt - c->rec);
       double NsecPerUsec{1000};
 
       if(logger.is_enabled(fc::log_level::all))
-         logger.log(FC_LOG_MESSAGE(all, "Clock offset is ${o}ns (${us}us)", ("o", c->offset)("us", c->offset/NsecPerUsec)));
+         logger.log(FC_LOG_MESSAGE(all, "Clock offset is ${o}ns (${us}us), round trip ${r}us",
+                                   ("o", c->offset)("us", c->offset/NsecPerUsec)("r", c->round_trip/NsecPerUsec)));
       c->org = 0;
       c->rec = 0;
    }
@@ -2467,7 +2978,7 @@ namespace eosio {
              trx->get_signatures().size() * sizeof(signature_type);
    }
 
-   void net_plugin_impl::handle_message(const connection_ptr& c, const packed_transaction_ptr& trx) {
+   void net_plugin_impl::handle_message(const connection_ptr& c, const transaction_metadata_ptr& ptrx, const wire_buffers& raw) {
       fc_dlog(logger, "got a packed transaction, cancel wait");
       peer_ilog(c, "received packed_transaction");
       controller& cc = my_impl->chain_plug->chain();
@@ -2480,14 +2991,15 @@ namespace eosio {
          return;
       }
 
-      auto ptrx = std::make_shared<transaction_metadata>( trx );
       const auto& tid = ptrx->id;
 
       if(local_txns.get<by_id>().find(tid) != local_txns.end()) {
          fc_dlog(logger, "got a duplicate transaction - dropping");
          return;
       }
-      dispatcher->recv_transaction(c, tid);
+      dispatcher->recv_transaction(c, tid, raw);
+      // signing keys are recovered by the producer_plugin through start_recover_keys, on its thread pool and
+      // bounded by max_transaction_cpu_usage, so only transactions that pass the duplicate check pay for it
       c->trx_in_progress_size += calc_trx_size( ptrx->packed_trx );
       chain_plug->accept_transaction(ptrx, [c, this, ptrx](const static_variant<fc::exception_ptr, transaction_trace_ptr>& result) {
          c->trx_in_progress_size -= calc_trx_size( ptrx->packed_trx );
@@ -2508,10 +3020,10 @@ namespace eosio {
       });
    }
 
-   void net_plugin_impl::handle_message(const connection_ptr& c, const signed_block_ptr& msg) {
+   void net_plugin_impl::handle_message(const connection_ptr& c, const signed_block_ptr& msg, const block_id_type& blk_id,
+                                        const wire_buffers& raw) {
       controller &cc = chain_plug->chain();
-      block_id_type blk_id = msg->id();
-      uint32_t blk_num = msg->block_num();
+      uint32_t blk_num = block_header::num_from_id(blk_id);
       fc_dlog(logger, "canceling wait on ${p}", ("p",c->peer_name()));
       c->cancel_wait();
 
@@ -2525,7 +3037,7 @@ namespace eosio {
          fc_elog( logger,"Caught an unknown exception trying to recall blockID" );
       }
 
-      dispatcher->recv_block(c, blk_id, blk_num);
+      dispatcher->recv_block(c, msg, blk_id, blk_num, raw);
       fc::microseconds age( fc::time_point::now() - msg->timestamp);
       peer_ilog(c, "received signed_block : #${n} block age in secs = ${age}",
               ("n",blk_num)("age",age.to_seconds()));
@@ -2574,6 +3086,166 @@ namespace eosio {
       }
    }
 
+   void net_plugin_impl::handle_message(const connection_ptr& c, const compact_block_message& msg) {
+      controller& cc = chain_plug->chain();
+      block_id_type blk_id = msg.header.id();
+      uint32_t blk_num = block_header::num_from_id(blk_id);
+      peer_dlog(c, "received compact_block_message #${n} with ${t} transactions", ("n", blk_num)("t", msg.transactions.size()));
+      c->cancel_wait();
+
+      try {
+         if( cc.fetch_block_by_id(blk_id) ) {
+            sync_master->recv_block(c, blk_id, blk_num);
+            return;
+         }
+      } catch( ...) {
+         fc_elog( logger,"Caught an unknown exception trying to recall blockID" );
+      }
+      if( blk_num <= cc.last_irreversible_block_num() ) {
+         return;
+      }
+
+      pending_compact_block pcb;
+      pcb.id = blk_id;
+      // nothing is kept for a header that does not extend a known block, or one of the peer's pending compact blocks,
+      // with the scheduled producer and its signature
+      bool linked = false;
+      try {
+         if( !c->pending_compact_blocks.empty() && c->pending_compact_blocks.back().id == msg.header.previous ) {
+            pcb.header_state = c->pending_compact_blocks.back().header_state.next( msg.header );
+            linked = true;
+         } else if( auto prev = cc.fetch_block_state_by_id( msg.header.previous ) ) {
+            pcb.header_state = prev->next( msg.header );
+            linked = true;
+         }
+      } catch( const fc::exception& ex ) {
+         peer_elog( c, "bad compact_block_message header #${n} : ${m}", ("n", blk_num)("m", ex.to_string()) );
+         close( c );
+         return;
+      }
+      if( !linked || c->pending_compact_blocks.size() >= def_max_pending_compact_blocks ) {
+         fc_dlog( logger, "compact block #${n} from ${p} is unlinkable or over ${m} pending, requesting full blocks",
+                  ("n", blk_num)("p", c->peer_name())("m", def_max_pending_compact_blocks) );
+         c->pending_compact_blocks.emplace_back( std::move( pcb ) );
+         request_full_blocks( c );
+         return;
+      }
+
+      pcb.block = std::make_shared<signed_block>( msg.header );
+      pcb.block->block_extensions = msg.block_extensions;
+      pcb.block->transactions.reserve( msg.transactions.size() );
+      const auto& local_by_id = local_txns.get<by_id>();
+      for( uint32_t i = 0; i < msg.transactions.size(); ++i ) {
+         const auto& cr = msg.transactions[i];
+         transaction_receipt receipt;
+         static_cast<transaction_receipt_header&>( receipt ) = cr;
+         receipt.trx = cr.id;
+         if( cr.packed ) {
+            auto ltx = local_by_id.find( cr.id );
+            if( ltx != local_by_id.end() && ltx->packed_trx ) {
+               receipt.trx = *ltx->packed_trx;
+            } else {
+               pcb.missing.push_back( i );
+            }
+         }
+         pcb.block->transactions.emplace_back( std::move( receipt ) );
+      }
+
+      if( !pcb.missing.empty() ) {
+         fc_dlog( logger, "requesting ${m} of ${t} transactions of compact block #${n} from ${p}",
+                  ("m", pcb.missing.size())("t", msg.transactions.size())("n", blk_num)("p", c->peer_name()) );
+         c->enqueue( get_block_transactions_message{ blk_id, pcb.missing } );
+      }
+      c->pending_compact_blocks.emplace_back( std::move( pcb ) );
+      accept_compact_blocks( c );
+   }
+
+   void net_plugin_impl::handle_message(const connection_ptr& c, const get_block_transactions_message& msg) {
+      peer_dlog(c, "received get_block_transactions_message for ${n} transactions", ("n", msg.indexes.size()));
+      block_transactions_message reply;
+      reply.block_id = msg.block_id;
+      signed_block_ptr b;
+      try {
+         b = chain_plug->chain().fetch_block_by_id( msg.block_id );
+      } catch( const assert_exception& ex ) {
+         fc_ilog( logger, "caught assert on fetch_block_by_id, ${ex}", ("ex", ex.what()) );
+      }
+      if( b ) {
+         reply.transactions.reserve( msg.indexes.size() );
+         for( auto i : msg.indexes ) {
+            if( i >= b->transactions.size() || !b->transactions[i].trx.contains<packed_transaction>() ) {
+               peer_elog( c, "Invalid get_block_transactions_message, index ${i}", ("i", i) );
+               close( c );
+               return;
+            }
+            reply.transactions.push_back( b->transactions[i].trx.get<packed_transaction>() );
+         }
+      }
+      c->enqueue( reply );
+   }
+
+   void net_plugin_impl::handle_message(const connection_ptr& c, const block_transactions_message& msg) {
+      peer_dlog(c, "received block_transactions_message with ${n} transactions", ("n", msg.transactions.size()));
+      auto itr = std::find_if( c->pending_compact_blocks.begin(), c->pending_compact_blocks.end(),
+                               [&]( const pending_compact_block& pcb ) { return pcb.id == msg.block_id; } );
+      if( itr == c->pending_compact_blocks.end() ) {
+         return;
+      }
+      if( msg.transactions.size() != itr->missing.size() ) {
+         fc_wlog( logger, "got ${g} of ${m} missing transactions of compact block from ${p}",
+                  ("g", msg.transactions.size())("m", itr->missing.size())("p", c->peer_name()) );
+         request_full_blocks( c );
+         return;
+      }
+      for( size_t i = 0; i < msg.transactions.size(); ++i ) {
+         itr->block->transactions[itr->missing[i]].trx = msg.transactions[i];
+      }
+      itr->missing.clear();
+      accept_compact_blocks( c );
+   }
+
+   void net_plugin_impl::accept_compact_blocks(const connection_ptr& c) {
+      while( !c->pending_compact_blocks.empty() && c->pending_compact_blocks.front().missing.empty() ) {
+         pending_compact_block pcb = std::move( c->pending_compact_blocks.front() );
+
+         // a locally known transaction may differ from the one in the block, e.g. in signatures or compression
+         vector<digest_type> trx_digests;
+         trx_digests.reserve( pcb.block->transactions.size() );
+         for( const auto& receipt : pcb.block->transactions ) {
+            trx_digests.emplace_back( receipt.digest() );
+         }
+         if( merkle( std::move( trx_digests ) ) != pcb.block->transaction_mroot ) {
+            fc_dlog( logger, "rebuilt compact block ${id} does not match its transaction_mroot", ("id", pcb.id) );
+            request_full_blocks( c );
+            return;
+         }
+
+         c->pending_compact_blocks.pop_front();
+         handle_message( c, pcb.block, pcb.id );
+         if( !c->connected() ) {
+            return;
+         }
+      }
+      if( !c->pending_compact_blocks.empty() ) {
+         c->fetch_wait(); // falls back to full blocks if the missing transactions do not arrive
+      }
+   }
+
+   void net_plugin_impl::request_full_blocks(const connection_ptr& c) {
+      for( const auto& pcb : c->pending_compact_blocks ) {
+         request_message req;
+         req.req_trx.mode = none;
+         req.req_blocks.mode = normal;
+         req.req_blocks.ids.push_back( pcb.id );
+         c->enqueue( req );
+         c->last_req = std::move( req );
+      }
+      c->pending_compact_blocks.clear();
+      if( c->last_req ) {
+         c->fetch_wait();
+      }
+   }
+
    void net_plugin_impl::start_conn_timer(boost::asio::steady_timer::duration du, std::weak_ptr<connection> from_connection) {
       connector_check->expires_from_now( du);
       connector_check->async_wait( [this, from_connection](boost::system::error_code ec) {
@@ -2646,6 +3318,10 @@ namespace eosio {
          stale_txn_e.erase(stale_txn_e.lower_bound(time_point_sec()), stale_txn_e.upper_bound(time_point::now()));
          auto &stale_blk = c->blk_state.get<by_block_num>();
          stale_blk.erase( stale_blk.lower_bound(1), stale_blk.upper_bound(lib) );
+         if( !c->pending_compact_blocks.empty() &&
+             block_header::num_from_id( c->pending_compact_blocks.back().id ) <= lib ) {
+            c->pending_compact_blocks.clear();
+         }
       }
       fc_dlog(logger, "expire_txns ${n}us size ${s} removed ${r}",
             ("n", time_point::now() - now)("s", start_size)("r", start_size - local_txns.size()) );
@@ -2700,8 +3376,19 @@ namespace eosio {
       c->close();
    }
 
+   bool net_plugin_impl::is_known_block( const block_id_type& id ) {
+      std::lock_guard<std::mutex> g( known_blocks_mtx );
+      return known_blocks.find( id ) != known_blocks.end();
+   }
+
    void net_plugin_impl::accepted_block(const block_state_ptr& block) {
       fc_dlog(logger,"signaled, id = ${id}",("id", block->id));
+      {
+         std::lock_guard<std::mutex> g( known_blocks_mtx );
+         known_blocks.insert( peer_block_state{block->id, block->block_num} );
+         auto& by_num = known_blocks.get<by_block_num>();
+         by_num.erase( by_num.begin(), by_num.upper_bound( chain_plug->chain().last_irreversible_block_num() ) );
+      }
       dispatcher->bcast_block(block);
    }
 
@@ -2868,6 +3555,12 @@ namespace eosio {
            "Number of worker threads in net_plugin thread pool" )
          ( "sync-fetch-span", bpo::value<uint32_t>()->default_value(def_sync_fetch_span), "number of blocks to retrieve in a chunk from any individual peer during synchronization")
          ( "use-socket-read-watermark", bpo::value<bool>()->default_value(false), "Enable expirimental socket read watermark optimization")
+         ( "p2p-compact-blocks", bpo::value<bool>()->default_value(false),
+           "Relay blocks as header plus transaction ids to peers that support it, letting them rebuild the block from transactions they already have")
+         ( "p2p-block-compression", bpo::value<string>()->default_value("none"),
+           "Compression of blocks sent to peers that support it, can be 'none' or 'zlib'. Peers always accept compressed blocks.")
+         ( "p2p-block-compression-threshold", bpo::value<uint32_t>()->default_value(def_block_compression_threshold),
+           "Blocks smaller than this number of bytes are sent uncompressed")
          ( "peer-log-format", bpo::value<string>()->default_value( "[\"${_name}\" ${_ip}:${_port}]" ),
            "The string used to format peers when logging messages about them.  Variables are escaped with ${<variable name>}.\n"
            "Available Variables:\n"
@@ -2907,6 +3600,18 @@ namespace eosio {
 
          my->use_socket_read_watermark = options.at( "use-socket-read-watermark" ).as<bool>();
 
+         my->compact_blocks = options.at( "p2p-compact-blocks" ).as<bool>();
+
+         const auto& block_compression = options.at( "p2p-block-compression" ).as<string>();
+         if( block_compression == "zlib" ) {
+            my->block_compression = compression_zlib;
+         } else {
+            EOS_ASSERT( block_compression == "none", chain::plugin_config_exception,
+                        "unknown p2p-block-compression ${c}", ("c", block_compression) );
+            my->block_compression = compression_none;
+         }
+         my->block_compression_threshold = options.at( "p2p-block-compression-threshold" ).as<uint32_t>();
+
          if( options.count( "p2p-listen-endpoint" ) && options.at("p2p-listen-endpoint").as<string>().length()) {
             my->p2p_address = options.at( "p2p-listen-endpoint" ).as<string>();
          }
@@ -2979,6 +3684,7 @@ namespace eosio {
       for( uint16_t i = 0; i < my->thread_pool_size; ++i ) {
          boost::asio::post( *my->thread_pool, [ioc = my->server_ioc]() { ioc->run(); } );
       }
+      my->dispatcher->bcast_strand.emplace( *my->server_ioc );
 
       my->resolver = std::make_shared<tcp::resolver>( std::ref( *my->server_ioc ));
       if( my->p2p_address.size() > 0 ) {
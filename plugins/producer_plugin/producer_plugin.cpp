@@ -9,6 +9,7 @@
 #include <eosio/chain/generated_transaction_object.hpp>
 #include <eosio/chain/transaction_object.hpp>
 #include <eosio/chain/snapshot.hpp>
+#include <eosio/chain/access_set.hpp>
 
 #include <fc/io/json.hpp>
 #include <fc/smart_ref_impl.hpp>
@@ -181,6 +182,39 @@ class producer_plugin_impl : public std::enable_shared_from_this<producer_plugin
       // path to write the snapshots to
       bfs::path _snapshots_dir;
 
+      // order pending transactions by the groups of accounts they touch instead of by arrival
+      bool _plan_pending_transactions = false;
+      std::map<chain::account_name, uint64_t> _transaction_priorities;
+
+      /**
+       * The order to apply trxs in, from plan_block over the accounts each one is predicted to touch. The priority
+       * of a transaction is the highest configured for the contracts and actors of its actions.
+       */
+      vector<size_t> plan_transactions( const vector<transaction_metadata_ptr>& trxs ) const {
+         vector<access_set> access;
+         vector<uint64_t> priorities;
+         access.reserve( trxs.size() );
+         priorities.reserve( trxs.size() );
+         for( const auto& trx : trxs ) {
+            const auto& t = trx->packed_trx->get_transaction();
+            access.emplace_back( predict_access( t ) );
+
+            uint64_t priority = 0;
+            auto priority_of = [&]( account_name a ) {
+               auto itr = _transaction_priorities.find( a );
+               if( itr != _transaction_priorities.end() )
+                  priority = std::max( priority, itr->second );
+            };
+            for( const auto& act : t.actions ) {
+               priority_of( act.account );
+               for( const auto& auth : act.authorization )
+                  priority_of( auth.actor );
+            }
+            priorities.push_back( priority );
+         }
+         return plan_block( access, priorities );
+      }
+
 
       void on_block( const block_state_ptr& bsp ) {
          if( bsp->header.timestamp <= _last_signed_block_time ) return;
@@ -554,6 +588,10 @@ void producer_plugin::set_program_options(
           "Number of worker threads in producer thread pool")
          ("snapshots-dir", bpo::value<bfs::path>()->default_value("snapshots"),
           "the location of the snapshots directory (absolute path or relative to application data dir)")
+         ("plan-pending-transactions", bpo::bool_switch()->default_value(false),
+          "Apply pending transactions grouped by the contracts and actors their actions touch, groups ordered by transaction-priority, instead of in arrival order")
+         ("transaction-priority", bpo::value<vector<string>>()->composing()->multitoken(),
+          "Priority of the transactions to or authorized by an account with plan-pending-transactions, as <account>=<priority> (may specify multiple times, default 0)")
          ;
    config_file_options.add(producer_options);
 }
@@ -686,6 +724,15 @@ void producer_plugin::plugin_initialize(const boost::program_options::variables_
 
    my->_incoming_defer_ratio = options.at("incoming-defer-ratio").as<double>();
 
+   my->_plan_pending_transactions = options.at("plan-pending-transactions").as<bool>();
+   if( options.count("transaction-priority") ) {
+      for( const auto& spec : options.at("transaction-priority").as<vector<string>>() ) {
+         auto delim = spec.find("=");
+         EOS_ASSERT( delim != std::string::npos, plugin_config_exception, "Missing \"=\" in transaction-priority ${s}", ("s", spec) );
+         my->_transaction_priorities[account_name( spec.substr(0, delim) )] = std::stoull( spec.substr(delim + 1) );
+      }
+   }
+
    auto thread_pool_size = options.at( "producer-threads" ).as<uint16_t>();
    EOS_ASSERT( thread_pool_size > 0, plugin_config_exception,
                "producer-threads ${num} must be greater than 0", ("num", thread_pool_size));
@@ -1183,6 +1230,19 @@ producer_plugin_impl::start_block_result producer_plugin_impl::start_block() {
       try {
          size_t orig_pending_txn_size = _pending_incoming_transactions.size();
 
+         if( _plan_pending_transactions && orig_pending_txn_size > 1 ) {
+            // reorder the transactions present now, those requeued while applying them stay behind
+            vector<transaction_metadata_ptr> trxs;
+            trxs.reserve( orig_pending_txn_size );
+            for( const auto& e : _pending_incoming_transactions )
+               trxs.push_back( std::get<0>(e) );
+
+            decltype(_pending_incoming_transactions) planned;
+            for( auto i : plan_transactions( trxs ) )
+               planned.push_back( std::move( _pending_incoming_transactions[i] ) );
+            _pending_incoming_transactions = std::move( planned );
+         }
+
          // Processing unapplied transactions...
          //
          if (_producers.empty() && persisted_by_id.empty()) {
@@ -1207,11 +1267,10 @@ producer_plugin_impl::start_block_result producer_plugin_impl::start_block() {
                   }
                };
 
+               // drop the droppable transactions and collect the appliable ones, in the order of the map unless planned
+               vector<transaction_metadata_ptr> appliable_trxs;
                auto itr = unapplied_trxs.begin();
                while( itr != unapplied_trxs.end() ) {
-                  auto itr_next = itr; // save off next since itr may be invalidated by loop
-                  ++itr_next;
-
                   if( preprocess_deadline <= fc::time_point::now() ) exhausted = true;
                   if( exhausted ) break;
                   const auto& trx = itr->second;
@@ -1223,42 +1282,56 @@ producer_plugin_impl::start_block_result producer_plugin_impl::start_block() {
                         fc_dlog(_trx_trace_log, "[TRX_TRACE] Node with producers configured is dropping an EXPIRED transaction that was PREVIOUSLY ACCEPTED : ${txid}",
                                ("txid", trx->id));
                      }
-                     itr = unapplied_trxs.erase( itr ); // unapplied_trxs map has not been modified, so simply erase and continue
+                     itr = unapplied_trxs.erase( itr );
                      continue;
                   } else if (category == tx_category::PERSISTED ||
                             (category == tx_category::UNEXPIRED_UNPERSISTED && _pending_block_mode == pending_block_mode::producing))
                   {
-                     ++num_processed;
-
-                     try {
-                        auto deadline = fc::time_point::now() + fc::milliseconds(_max_transaction_time_ms);
-                        bool deadline_is_subjective = false;
-                        if (_max_transaction_time_ms < 0 || (_pending_block_mode == pending_block_mode::producing && preprocess_deadline < deadline)) {
-                           deadline_is_subjective = true;
-                           deadline = preprocess_deadline;
-                        }
+                     appliable_trxs.push_back( trx );
+                  }
+                  ++itr;
+               }
+
+               if( !exhausted && _plan_pending_transactions && appliable_trxs.size() > 1 ) {
+                  vector<transaction_metadata_ptr> planned;
+                  planned.reserve( appliable_trxs.size() );
+                  for( auto i : plan_transactions( appliable_trxs ) )
+                     planned.push_back( std::move( appliable_trxs[i] ) );
+                  appliable_trxs = std::move( planned );
+               }
+
+               for( const auto& trx : appliable_trxs ) {
+                  if( preprocess_deadline <= fc::time_point::now() ) exhausted = true;
+                  if( exhausted ) break;
+
+                  ++num_processed;
 
-                        auto trace = chain.push_transaction(trx, deadline);
-                        if (trace->except) {
-                           if (failure_is_subjective(*trace->except, deadline_is_subjective)) {
-                              exhausted = true;
-                              break;
-                           } else {
-                              // this failed our configured maximum transaction time, we don't want to replay it
-                              // chain.plus_transactions can modify unapplied_trxs, so erase by id
-                              unapplied_trxs.erase( trx->signed_id );
-                              ++num_failed;
-                           }
+                  try {
+                     auto deadline = fc::time_point::now() + fc::milliseconds(_max_transaction_time_ms);
+                     bool deadline_is_subjective = false;
+                     if (_max_transaction_time_ms < 0 || (_pending_block_mode == pending_block_mode::producing && preprocess_deadline < deadline)) {
+                        deadline_is_subjective = true;
+                        deadline = preprocess_deadline;
+                     }
+
+                     auto trace = chain.push_transaction(trx, deadline);
+                     if (trace->except) {
+                        if (failure_is_subjective(*trace->except, deadline_is_subjective)) {
+                           exhausted = true;
+                           break;
                         } else {
-                           ++num_applied;
+                           // this failed our configured maximum transaction time, we don't want to replay it
+                           // chain.plus_transactions can modify unapplied_trxs, so erase by id
+                           unapplied_trxs.erase( trx->signed_id );
+                           ++num_failed;
                         }
-                     } catch ( const guard_exception& e ) {
-                        chain_plug->handle_guard_exception(e);
-                        return start_block_result::failed;
-                     } FC_LOG_AND_DROP();
-                  }
-
-                  itr = itr_next;
+                     } else {
+                        ++num_applied;
+                     }
+                  } catch ( const guard_exception& e ) {
+                     chain_plug->handle_guard_exception(e);
+                     return start_block_result::failed;
+                  } FC_LOG_AND_DROP();
                }
 
                fc_dlog(_log, "Processed ${m} of ${n} previously applied transactions, Applied ${applied}, Failed/Dropped ${failed}",
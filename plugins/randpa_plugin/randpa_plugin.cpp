@@ -3,6 +3,7 @@
 #include <eosio/randpa_plugin/prefix_chain_tree.hpp>
 #include <eosio/randpa_plugin/randpa.hpp>
 #include <eosio/chain/plugin_interface.hpp>
+#include <eosio/chain/fork_database.hpp>
 #include <fc/io/json.hpp>
 #include <queue>
 #include <chrono>
@@ -132,13 +133,7 @@ public:
         prefix_tree_ptr tree(new prefix_tree(std::make_shared<tree_node>(tree_node { lib_id })));
         dlog("Copying master chain from fork_db");
 
-        auto current_block = ctrl.head_block_state();
-
-        vector<block_state_ptr> blocks;
-        while (current_block && current_block->id != lib_id) {
-            blocks.push_back(current_block);
-            current_block = ctrl.fetch_block_state_by_id(current_block->prev());
-        }
+        auto blocks = ctrl.fork_db().fetch_branch(ctrl.head_block_id(), ctrl.last_irreversible_block_num());
         std::reverse(blocks.begin(), blocks.end());
 
         auto base_block = lib_id;
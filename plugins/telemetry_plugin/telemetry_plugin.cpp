@@ -5,11 +5,17 @@
 #include <eosio/telemetry_plugin/telemetry_plugin.hpp>
 #include <fc/exception/exception.hpp>
 #include <eosio/chain/plugin_interface.hpp>
+#include <eosio/net_plugin/net_plugin.hpp>
 #include <prometheus/exposer.h>
+#include <boost/asio/steady_timer.hpp>
+#include <array>
 
 #define LATENCY_HISTOGRAM_KEYPOINTS \
     {1000, 2000, 3000, 4000, 5000, 6000, 7000, 8000, 9000, 10000, 15000, 20000, 180000}
 
+#define BLOCK_TIME_HISTOGRAM_KEYPOINTS \
+    {100, 500, 1000, 5000, 10000, 25000, 50000, 100000, 200000, 300000, 400000, 500000, 1000000}
+
 
 namespace eosio {
     using namespace chain::plugin_interface;
@@ -21,6 +27,7 @@ namespace eosio {
     private:
         channels::accepted_block::channel_type::handle _on_accepted_block_handle;
         channels::irreversible_block::channel_type::handle _on_irreversible_block_handle;
+        channels::block_profiled::channel_type::handle _on_block_profiled_handle;
 
         std::unique_ptr<Exposer> exposer;
         std::shared_ptr<Registry> registry;
@@ -29,6 +36,37 @@ namespace eosio {
         std::unique_ptr<Histogram> irreversible_latency_hist;
         std::unique_ptr<Gauge> last_irreversible_latency;
 
+        /// filled by block profiles, only published when chain_plugin's profile-blocks is set
+        Family<Histogram>* block_time = nullptr;
+        Family<Histogram>* block_phase_time = nullptr;
+        Family<Counter>* action_time = nullptr;
+        std::map<bool, Histogram*> block_time_by_produced;
+        std::array<Histogram*, chain::profile_phase_count> phase_time{};
+        std::map<chain::account_name, Counter*> action_time_by_receiver; ///< at most max_action_receivers
+        Counter* action_time_other = nullptr; ///< receivers beyond max_action_receivers
+
+        /// metrics of a single net_plugin connection, removed from their families once the peer disconnects
+        struct peer_metrics {
+            std::map<std::string, Counter*> bytes_sent;
+            std::map<std::string, Counter*> bytes_received;
+            Gauge* write_queue_size = nullptr;
+            Gauge* write_queue_messages = nullptr;
+            Counter* write_time = nullptr;
+            Gauge* sync_blocks_per_second = nullptr;
+            Gauge* round_trip = nullptr;
+            connection_status last; ///< counters are exported as the increase since this status
+        };
+
+        Family<Counter>* peer_bytes_sent = nullptr;
+        Family<Counter>* peer_bytes_received = nullptr;
+        Family<Gauge>* peer_write_queue_size = nullptr;
+        Family<Gauge>* peer_write_queue_messages = nullptr;
+        Family<Counter>* peer_write_time = nullptr;
+        Family<Gauge>* peer_sync_blocks_per_second = nullptr;
+        Family<Gauge>* peer_round_trip = nullptr;
+        std::map<std::string, peer_metrics> peers;
+        std::unique_ptr<boost::asio::steady_timer> peer_timer;
+
         void start_server() {
             exposer = std::make_unique<Exposer>(endpoint, uri, threads);
         }
@@ -46,6 +84,41 @@ namespace eosio {
                         last_irreversible_latency->Set(latency_millis);
                         irreversible_latency_hist->Observe(latency_millis);
                     });
+
+            _on_block_profiled_handle = app().get_channel<channels::block_profiled>()
+                    .subscribe([this](const chain::block_profile_ptr& p) {
+                        observe_block_profile(*p);
+                    });
+        }
+
+        void observe_block_profile(const chain::block_profile& p) {
+            auto& total = block_time_by_produced[p.produced];
+            if (!total)
+                total = &block_time->Add({{"produced", p.produced ? "true" : "false"}},
+                                         Histogram::BucketBoundaries{BLOCK_TIME_HISTOGRAM_KEYPOINTS});
+            total->Observe(p.total_us);
+
+            for (size_t i = 0; i < phase_time.size(); ++i) {
+                const auto phase = static_cast<chain::profile_phase>(i);
+                if (!phase_time[i])
+                    phase_time[i] = &block_phase_time->Add({{"phase", fc::reflector<chain::profile_phase>::to_string(phase)}},
+                                                           Histogram::BucketBoundaries{BLOCK_TIME_HISTOGRAM_KEYPOINTS});
+                phase_time[i]->Observe(p.phase_us(phase));
+            }
+
+            // every receiver would be a time series of its own, only the first ones seen are kept apart
+            for (const auto& a : p.actions) {
+                auto itr = action_time_by_receiver.find(a.receiver);
+                if (itr == action_time_by_receiver.end() && action_time_by_receiver.size() < max_action_receivers)
+                    itr = action_time_by_receiver.emplace(a.receiver, &action_time->Add({{"receiver", a.receiver.to_string()}})).first;
+                if (itr != action_time_by_receiver.end()) {
+                    itr->second->Increment(a.time_us);
+                } else {
+                    if (!action_time_other)
+                        action_time_other = &action_time->Add({{"receiver", "(other)"}});
+                    action_time_other->Increment(a.time_us);
+                }
+            }
         }
 
         void add_metrics() {
@@ -79,18 +152,156 @@ namespace eosio {
             );
 
 
+            peer_bytes_sent = &BuildCounter()
+                    .Name("p2p_bytes_sent_total")
+                    .Help("Bytes written to a peer per message type")
+                    .Register(*registry);
+            peer_bytes_received = &BuildCounter()
+                    .Name("p2p_bytes_received_total")
+                    .Help("Bytes read from a peer per message type")
+                    .Register(*registry);
+            peer_write_queue_size = &BuildGauge()
+                    .Name("p2p_write_queue_bytes")
+                    .Help("Bytes waiting in the write queue of a peer")
+                    .Register(*registry);
+            peer_write_queue_messages = &BuildGauge()
+                    .Name("p2p_write_queue_messages")
+                    .Help("Messages waiting in the write queue of a peer")
+                    .Register(*registry);
+            peer_write_time = &BuildCounter()
+                    .Name("p2p_write_time_us_total")
+                    .Help("Time spent waiting on socket writes to a peer to complete")
+                    .Register(*registry);
+            peer_sync_blocks_per_second = &BuildGauge()
+                    .Name("p2p_sync_blocks_per_second")
+                    .Help("Blocks per second received from a peer while syncing")
+                    .Register(*registry);
+            peer_round_trip = &BuildGauge()
+                    .Name("p2p_round_trip_us")
+                    .Help("Round trip delay of the last time_message exchange with a peer")
+                    .Register(*registry);
+
+            block_time = &BuildHistogram()
+                    .Name("block_time_us")
+                    .Help("Time from the start of a profiled block to its commit")
+                    .Register(*registry);
+            block_phase_time = &BuildHistogram()
+                    .Name("block_phase_time_us")
+                    .Help("Time spent in each phase of a profiled block")
+                    .Register(*registry);
+            action_time = &BuildCounter()
+                    .Name("action_time_us_total")
+                    .Help("Time spent executing actions of profiled blocks per receiver")
+                    .Register(*registry);
+
             exposer->RegisterCollectable(std::weak_ptr<Registry>(registry));
         }
 
+        static uint64_t increase(uint64_t current, uint64_t last) {
+            // a reconnected peer starts counting from zero again
+            return current >= last ? current - last : current;
+        }
+
+        static void add_bytes(Family<Counter>& family, std::map<std::string, Counter*>& counters, const std::string& peer,
+                              const map<string, uint64_t>& current, const map<string, uint64_t>& last) {
+            for (const auto& item : current) {
+                auto& counter = counters[item.first];
+                if (!counter)
+                    counter = &family.Add({{"peer", peer}, {"type", item.first}});
+                auto itr = last.find(item.first);
+                counter->Increment(increase(item.second, itr == last.end() ? 0 : itr->second));
+            }
+        }
+
+        void remove_peer(peer_metrics& m) {
+            for (const auto& item : m.bytes_sent)
+                peer_bytes_sent->Remove(item.second);
+            for (const auto& item : m.bytes_received)
+                peer_bytes_received->Remove(item.second);
+            peer_write_queue_size->Remove(m.write_queue_size);
+            peer_write_queue_messages->Remove(m.write_queue_messages);
+            peer_write_time->Remove(m.write_time);
+            peer_sync_blocks_per_second->Remove(m.sync_blocks_per_second);
+            peer_round_trip->Remove(m.round_trip);
+        }
+
+        void update_peer_metrics(const std::vector<connection_status>& connections) {
+            std::set<std::string> seen;
+            for (const auto& stat : connections) {
+                const std::string& peer = stat.peer.empty() ? stat.last_handshake.p2p_address : stat.peer;
+                if (peer.empty() || !seen.insert(peer).second)
+                    continue; // still handshaking, or a duplicate connection to the same peer
+
+                auto itr = peers.find(peer);
+                if (itr == peers.end()) {
+                    itr = peers.emplace(peer, peer_metrics()).first;
+                    auto& m = itr->second;
+                    m.write_queue_size = &peer_write_queue_size->Add({{"peer", peer}});
+                    m.write_queue_messages = &peer_write_queue_messages->Add({{"peer", peer}});
+                    m.write_time = &peer_write_time->Add({{"peer", peer}});
+                    m.sync_blocks_per_second = &peer_sync_blocks_per_second->Add({{"peer", peer}});
+                    m.round_trip = &peer_round_trip->Add({{"peer", peer}});
+                }
+                auto& m = itr->second;
+                add_bytes(*peer_bytes_sent, m.bytes_sent, peer, stat.bytes_sent_by_type, m.last.bytes_sent_by_type);
+                add_bytes(*peer_bytes_received, m.bytes_received, peer, stat.bytes_received_by_type, m.last.bytes_received_by_type);
+                m.write_queue_size->Set(stat.write_queue_size);
+                m.write_queue_messages->Set(stat.write_queue_messages);
+                m.write_time->Increment(increase(stat.write_time_us, m.last.write_time_us));
+                m.sync_blocks_per_second->Set(double(increase(stat.sync_blocks_received, m.last.sync_blocks_received)) /
+                                              peer_interval.count());
+                m.round_trip->Set(stat.round_trip_us);
+                m.last = stat;
+            }
+
+            for (auto itr = peers.begin(); itr != peers.end();) {
+                if (seen.count(itr->first)) {
+                    ++itr;
+                } else {
+                    remove_peer(itr->second);
+                    itr = peers.erase(itr);
+                }
+            }
+        }
+
+        void start_peer_timer() {
+            peer_timer->expires_from_now(peer_interval);
+            peer_timer->async_wait([this](boost::system::error_code ec) {
+                if (ec)
+                    return;
+                // net_plugin connections are only touched on the main thread
+                app().post(priority::low, [this]() {
+                    update_peer_metrics(app().get_plugin<net_plugin>().connections());
+                    start_peer_timer();
+                });
+            });
+        }
+
+        void add_peer_metrics() {
+            auto net = app().find_plugin<net_plugin>();
+            if (!net || net->get_state() == abstract_plugin::registered)
+                return; // net_plugin is not enabled
+            peer_timer = std::make_unique<boost::asio::steady_timer>(app().get_io_service());
+            start_peer_timer();
+        }
+
     public:
         std::string endpoint;
         std::string uri;
         size_t threads{};
+        std::chrono::seconds peer_interval{5};
+        size_t max_action_receivers = 100;
 
         void initialize() {
             start_server();
             add_metrics();
             add_event_handlers();
+            add_peer_metrics();
+        }
+
+        void shutdown() {
+            if (peer_timer)
+                peer_timer->cancel();
         }
 
         virtual ~telemetry_plugin_impl() = default;
@@ -107,7 +318,11 @@ namespace eosio {
                 ("telemetry-uri", bpo::value<string>()->default_value("/metrics"),
                  "the base uri of the endpoint")
                 ("telemetry-threads", bpo::value<size_t>()->default_value(1),
-                 "the number of threads to use to process network messages to promethus server");
+                 "the number of threads to use to process network messages to promethus server")
+                ("telemetry-peer-interval", bpo::value<uint32_t>()->default_value(5),
+                 "the interval in seconds at which per peer net_plugin metrics are updated")
+                ("telemetry-action-receivers", bpo::value<uint32_t>()->default_value(100),
+                 "the number of action receivers whose execution time is exported separately, further receivers are exported together as receiver \"(other)\"");
     }
 
     void telemetry_plugin::plugin_initialize(const variables_map &options) {
@@ -116,6 +331,10 @@ namespace eosio {
             my->endpoint = options.at("telemetry-endpoint").as<string>();
             my->uri = options.at("telemetry-uri").as<string>();
             my->threads = options.at("telemetry-threads").as<size_t>();
+            my->peer_interval = std::chrono::seconds(options.at("telemetry-peer-interval").as<uint32_t>());
+            EOS_ASSERT(my->peer_interval.count() > 0, chain::plugin_config_exception,
+                       "telemetry-peer-interval must be greater than 0");
+            my->max_action_receivers = options.at("telemetry-action-receivers").as<uint32_t>();
         }
         FC_LOG_AND_RETHROW();
     }
@@ -132,6 +351,7 @@ namespace eosio {
 
     void telemetry_plugin::plugin_shutdown() {
         wlog("Telemetry plugin shutdown");
+        my->shutdown();
     }
 
 }
@@ -0,0 +1,186 @@
+/**
+ *  @file
+ *  @copyright defined in eos/LICENSE
+ */
+#pragma once
+#include <string>
+#include <vector>
+
+namespace eosio { namespace bench {
+
+/**
+ * A synthetic contract calling the intrinsics under test in a loop.
+ *
+ * The contract reads the number of iterations from the first 4 bytes of the action data. Action 1 runs setup once,
+ * any other action runs init and then body once per iteration. In body, $i is the iteration, $receiver the contract
+ * and $itr, $x and $f are scratch locals. Memory holds the iteration count at 0, scratch output at 16, 256 bytes of
+ * input at 64, 256 bytes of output at 512 and is free from 1024 to the end of its 64 KiB page.
+ */
+struct benchmark {
+   std::string name;
+   std::string intrinsic_class; ///< as registered with REGISTER_INTRINSICS
+   std::string imports;
+   std::string setup;
+   std::string init;
+   std::string body;
+};
+
+inline std::string make_wast( const benchmark& b ) {
+   return R"=====(
+(module
+ (import "env" "read_action_data" (func $read_action_data (param i32 i32) (result i32)))
+)=====" + b.imports + R"=====(
+ (table 0 anyfunc)
+ (memory $0 1)
+ (data (i32.const 64) "0123456789abcdef0123456789abcdef0123456789abcdef0123456789abcdef")
+ (data (i32.const 128) "0123456789abcdef0123456789abcdef0123456789abcdef0123456789abcdef")
+ (data (i32.const 192) "0123456789abcdef0123456789abcdef0123456789abcdef0123456789abcdef")
+ (data (i32.const 256) "0123456789abcdef0123456789abcdef0123456789abcdef0123456789abcdef")
+ (export "apply" (func $apply))
+ (func $apply (param $receiver i64) (param $code i64) (param $action i64)
+  (local $i i32)
+  (local $n i32)
+  (local $itr i32)
+  (local $x i64)
+  (local $f f64)
+  (if (i64.eq (get_local $action) (i64.const 1)) (then
+)=====" + b.setup + R"=====(
+   (return)
+  ))
+  (drop (call $read_action_data (i32.const 0) (i32.const 4)))
+  (set_local $n (i32.load (i32.const 0)))
+)=====" + b.init + R"=====(
+  (block $done
+   (loop $loop
+    (br_if $done (i32.ge_u (get_local $i) (get_local $n)))
+)=====" + b.body + R"=====(
+    (set_local $i (i32.add (get_local $i) (i32.const 1)))
+    (br $loop)
+   )
+  )
+  (i64.store (i32.const 16) (get_local $x))
+  (f64.store (i32.const 24) (get_local $f))
+ )
+)
+)=====";
+}
+
+namespace detail {
+
+const std::string db_imports = R"=====(
+ (import "env" "db_store_i64" (func $db_store_i64 (param i64 i64 i64 i64 i32 i32) (result i32)))
+ (import "env" "db_remove_i64" (func $db_remove_i64 (param i32)))
+ (import "env" "db_get_i64" (func $db_get_i64 (param i32 i32 i32) (result i32)))
+ (import "env" "db_find_i64" (func $db_find_i64 (param i64 i64 i64 i64) (result i32)))
+ (import "env" "db_next_i64" (func $db_next_i64 (param i32 i32) (result i32)))
+ (import "env" "db_lowerbound_i64" (func $db_lowerbound_i64 (param i64 i64 i64 i64) (result i32)))
+ (import "env" "db_get_batch_i64" (func $db_get_batch_i64 (param i32 i32 i32 i32) (result i32)))
+)=====";
+
+/// 64 rows with primary keys 0 to 63 and 32 byte values
+const std::string db_setup = R"=====(
+   (block $stored
+    (loop $store
+     (br_if $stored (i32.ge_u (get_local $i) (i32.const 64)))
+     (drop (call $db_store_i64 (get_local $receiver) (get_local $receiver) (get_local $receiver) (i64.extend_u/i32 (get_local $i)) (i32.const 64) (i32.const 32)))
+     (set_local $i (i32.add (get_local $i) (i32.const 1)))
+     (br $store)
+    )
+   )
+)=====";
+
+} /// detail
+
+inline std::vector<benchmark> all_benchmarks() {
+   return {
+      { "baseline", "none", "", "", "", "" },
+
+      { "db_store_remove", "database_api", detail::db_imports, "", "", R"=====(
+    (call $db_remove_i64 (call $db_store_i64 (get_local $receiver) (get_local $receiver) (get_local $receiver) (i64.extend_u/i32 (i32.add (get_local $i) (i32.const 1000))) (i32.const 64) (i32.const 32)))
+)=====" },
+
+      { "db_find_get", "database_api", detail::db_imports, detail::db_setup, "", R"=====(
+    (set_local $itr (call $db_find_i64 (get_local $receiver) (get_local $receiver) (get_local $receiver) (i64.extend_u/i32 (i32.and (get_local $i) (i32.const 63)))))
+    (drop (call $db_get_i64 (get_local $itr) (i32.const 512) (i32.const 32)))
+)=====" },
+
+      { "db_next", "database_api", detail::db_imports, detail::db_setup, R"=====(
+  (set_local $itr (call $db_lowerbound_i64 (get_local $receiver) (get_local $receiver) (get_local $receiver) (i64.const 0)))
+)=====", R"=====(
+    (set_local $itr (call $db_next_i64 (get_local $itr) (i32.const 16)))
+    (if (i32.lt_s (get_local $itr) (i32.const 0)) (then
+     (set_local $itr (call $db_lowerbound_i64 (get_local $receiver) (get_local $receiver) (get_local $receiver) (i64.const 0)))
+    ))
+)=====" },
+
+      // one call is a scan of the 64 rows, a db_get_i64 and db_next_i64 pair per row
+      { "db_scan_per_row", "database_api", detail::db_imports, detail::db_setup, "", R"=====(
+    (set_local $itr (call $db_lowerbound_i64 (get_local $receiver) (get_local $receiver) (get_local $receiver) (i64.const 0)))
+    (block $scanned
+     (loop $scan
+      (br_if $scanned (i32.lt_s (get_local $itr) (i32.const 0)))
+      (drop (call $db_get_i64 (get_local $itr) (i32.const 512) (i32.const 32)))
+      (set_local $itr (call $db_next_i64 (get_local $itr) (i32.const 16)))
+      (br $scan)
+     )
+    )
+)=====" },
+
+      // one call is a scan of the 64 rows, copied by db_get_batch_i64 as many at a time as fit in 4 KiB
+      { "db_scan_batch", "database_api", detail::db_imports, detail::db_setup, "", R"=====(
+    (set_local $itr (call $db_lowerbound_i64 (get_local $receiver) (get_local $receiver) (get_local $receiver) (i64.const 0)))
+    (block $scanned
+     (loop $scan
+      (br_if $scanned (i32.lt_s (get_local $itr) (i32.const 0)))
+      (set_local $itr (call $db_get_batch_i64 (get_local $itr) (i32.const 1024) (i32.const 4096) (i32.const 16)))
+      (br $scan)
+     )
+    )
+)=====" },
+
+      { "memcpy_256", "memory_api", R"=====(
+ (import "env" "memcpy" (func $memcpy (param i32 i32 i32) (result i32)))
+)=====", "", "", R"=====(
+    (drop (call $memcpy (i32.const 512) (i32.const 64) (i32.const 256)))
+)=====" },
+
+      { "memset_256", "memory_api", R"=====(
+ (import "env" "memset" (func $memset (param i32 i32 i32) (result i32)))
+)=====", "", "", R"=====(
+    (drop (call $memset (i32.const 512) (get_local $i) (i32.const 256)))
+)=====" },
+
+      { "sha256_256", "crypto_api", R"=====(
+ (import "env" "sha256" (func $sha256 (param i32 i32 i32)))
+)=====", "", "", R"=====(
+    (call $sha256 (i32.const 64) (i32.const 256) (i32.const 512))
+)=====" },
+
+      { "ripemd160_256", "crypto_api", R"=====(
+ (import "env" "ripemd160" (func $ripemd160 (param i32 i32 i32)))
+)=====", "", "", R"=====(
+    (call $ripemd160 (i32.const 64) (i32.const 256) (i32.const 512))
+)=====" },
+
+      // f64 instructions are injected as calls to the softfloat intrinsics
+      { "f64_mul_add_div", "softfloat_api", "", "", R"=====(
+  (set_local $f (f64.const 1))
+)=====", R"=====(
+    (set_local $f (f64.div (f64.add (f64.mul (get_local $f) (f64.const 1.000001)) (f64.const 0.5)) (f64.const 1.0000001)))
+)=====" },
+
+      { "multi3", "compiler_builtins", R"=====(
+ (import "env" "__multi3" (func $__multi3 (param i32 i64 i64 i64 i64)))
+)=====", "", "", R"=====(
+    (call $__multi3 (i32.const 16) (i64.extend_u/i32 (get_local $i)) (i64.const 0) (i64.const 1000000007) (i64.const 0))
+)=====" },
+
+      { "divti3", "compiler_builtins", R"=====(
+ (import "env" "__divti3" (func $__divti3 (param i32 i64 i64 i64 i64)))
+)=====", "", "", R"=====(
+    (call $__divti3 (i32.const 16) (i64.const 1000000007) (i64.const 0) (i64.extend_u/i32 (i32.add (get_local $i) (i32.const 1))) (i64.const 0))
+)=====" },
+   };
+}
+
+} } /// eosio::bench
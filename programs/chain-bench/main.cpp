@@ -0,0 +1,210 @@
+/**
+ *  @file
+ *  @copyright defined in eosio/LICENSE.txt
+ */
+#include "benchmarks.hpp"
+
+#include <eosio/testing/tester.hpp>
+
+#include <fc/io/json.hpp>
+#include <fc/variant_object.hpp>
+
+#include <boost/exception/diagnostic_information.hpp>
+#include <boost/program_options.hpp>
+
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+using namespace eosio::chain;
+using namespace eosio::testing;
+using namespace eosio::bench;
+namespace bpo = boost::program_options;
+using bpo::options_description;
+using bpo::variables_map;
+
+struct chain_bench {
+   void set_program_options(options_description& cli);
+   void initialize(const variables_map& options);
+   void run();
+
+   vector<std::pair<string, wasm_interface::vm_type>>  runtimes;
+   uint32_t                         iterations = 0;
+   uint32_t                         samples = 0;
+   string                           filter;
+   bool                             json = false;
+};
+
+/// the time of one intrinsic call in each sample, in nanoseconds
+struct sample_stats {
+   explicit sample_stats( vector<double> ns ) : ns_per_call( std::move(ns) ) {
+      std::sort( ns_per_call.begin(), ns_per_call.end() );
+   }
+
+   double percentile( uint32_t p )const {
+      return ns_per_call[ std::min<size_t>( ns_per_call.size() - 1, ns_per_call.size() * p / 100 ) ];
+   }
+
+   /// counts of samples per power of 2 bucket, as [ upper bound in ns, count ] pairs
+   vector<std::pair<uint64_t, uint32_t>> histogram()const {
+      vector<std::pair<uint64_t, uint32_t>> buckets;
+      for( double ns : ns_per_call ) {
+         uint64_t bound = 1;
+         while( bound < ns ) bound <<= 1;
+         if( buckets.empty() || buckets.back().first != bound )
+            buckets.emplace_back( bound, 0 );
+         ++buckets.back().second;
+      }
+      return buckets;
+   }
+
+   vector<double> ns_per_call;
+};
+
+void chain_bench::set_program_options(options_description& cli)
+{
+   cli.add_options()
+         ("runtime", bpo::value<vector<string>>()->composing()->default_value( {"wavm", "wabt"}, "wavm wabt" ),
+          "wasm runtime to benchmark, may be given more than once")
+         ("iterations", bpo::value<uint32_t>(&iterations)->default_value(1000),
+          "intrinsic calls per action")
+         ("samples", bpo::value<uint32_t>(&samples)->default_value(50),
+          "actions timed per benchmark, after one untimed action instantiating the contract")
+         ("filter", bpo::value<string>(&filter)->default_value(""),
+          "only run the benchmarks whose name or intrinsic class contains this string")
+         ("format", bpo::value<string>()->default_value("text"),
+          "text, or json for one object per benchmark and runtime")
+         ("help", "Print this help message and exit.")
+         ;
+}
+
+void chain_bench::initialize(const variables_map& options) {
+   for( const auto& r : options.at( "runtime" ).as<vector<string>>() ) {
+      std::istringstream in( r );
+      wasm_interface::vm_type vm;
+      in >> vm;
+      EOS_ASSERT( !in.fail(), fc::invalid_arg_exception, "unknown runtime ${r}", ("r", r) );
+      runtimes.emplace_back( r, vm );
+   }
+   const auto& format = options.at( "format" ).as<string>();
+   EOS_ASSERT( format == "text" || format == "json", fc::invalid_arg_exception, "unknown format ${f}", ("f", format) );
+   json = format == "json";
+   EOS_ASSERT( iterations > 0 && samples > 0, fc::invalid_arg_exception, "iterations and samples must be positive" );
+}
+
+void chain_bench::run() {
+   for( const auto& runtime : runtimes ) {
+      fc::temp_directory tempdir;
+      controller::config cfg;
+      cfg.blocks_dir = tempdir.path() / config::default_blocks_dir_name;
+      cfg.state_dir = tempdir.path() / config::default_state_dir_name;
+      cfg.state_size = 64*1024*1024;
+      cfg.state_guard_size = 0;
+      cfg.reversible_cache_size = 64*1024*1024;
+      cfg.reversible_guard_size = 0;
+      cfg.genesis.initial_timestamp = fc::time_point::from_iso_string("2020-01-01T00:00:00.000");
+      cfg.genesis.initial_key = tester::get_public_key( config::system_account_name, "active" );
+      cfg.wasm_runtime = runtime.second;
+      cfg.feature_activation_block_num = 0;
+      tester chain( cfg );
+
+      // the contracts of the benchmarks importing intrinsics behind a feature can only be set once it is active
+      chain.control->activate_feature( config::batch_db_iteration_feature );
+      for( uint32_t i = 0; i < 12 && !chain.control->is_feature_active( config::batch_db_iteration_feature ); ++i )
+         chain.produce_block();
+      EOS_ASSERT( chain.control->is_feature_active( config::batch_db_iteration_feature ), unsupported_feature,
+                  "the batch db iteration feature did not become active" );
+
+      uint32_t pushed = 0;
+      auto push = [&]( account_name account, uint64_t action, uint32_t sample ) {
+         signed_transaction trx;
+         // the sample number keeps the transactions of a benchmark distinct, the contract reads the iterations only
+         trx.actions.emplace_back( vector<permission_level>{{account, config::active_name}}, account, action,
+                                   fc::raw::pack( std::make_pair( iterations, sample ) ) );
+         chain.set_transaction_headers( trx );
+         trx.sign( tester::get_private_key( account, "active" ), chain.control->get_chain_id() );
+         auto trace = chain.push_transaction( trx );
+         if( ++pushed % 16 == 0 )
+            chain.produce_block();
+         return trace->action_traces.at( 0 ).elapsed;
+      };
+
+      char next_account = 'a';
+      for( const auto& b : all_benchmarks() ) {
+         if( !filter.empty() && b.name.find( filter ) == string::npos && b.intrinsic_class.find( filter ) == string::npos )
+            continue;
+
+         const account_name account( string( "bench" ) + next_account++ );
+         chain.create_account( account );
+         chain.set_code( account, make_wast( b ).c_str() );
+         chain.produce_block();
+
+         push( account, 1, 0 );
+         push( account, 0, 0 );
+
+         vector<double> ns;
+         for( uint32_t s = 1; s <= samples; ++s )
+            ns.push_back( push( account, 0, s ).count() * 1000.0 / iterations );
+         const sample_stats stats( std::move( ns ) );
+
+         if( json ) {
+            std::cout << fc::json::to_string( fc::mutable_variant_object()
+                  ( "benchmark", b.name )
+                  ( "intrinsic_class", b.intrinsic_class )
+                  ( "runtime", runtime.first )
+                  ( "iterations", iterations )
+                  ( "samples", samples )
+                  ( "ns_per_call", fc::mutable_variant_object()
+                     ( "min", stats.ns_per_call.front() )
+                     ( "p50", stats.percentile( 50 ) )
+                     ( "p90", stats.percentile( 90 ) )
+                     ( "p99", stats.percentile( 99 ) )
+                     ( "max", stats.ns_per_call.back() ) )
+                  ( "histogram_ns", stats.histogram() ) ) << std::endl;
+         } else {
+            std::cout << std::left << std::setw( 6 ) << runtime.first << std::setw( 20 ) << b.name << std::setw( 20 ) << b.intrinsic_class
+                      << std::right << std::fixed << std::setprecision( 1 )
+                      << " min " << std::setw( 9 ) << stats.ns_per_call.front()
+                      << " p50 " << std::setw( 9 ) << stats.percentile( 50 )
+                      << " p90 " << std::setw( 9 ) << stats.percentile( 90 )
+                      << " p99 " << std::setw( 9 ) << stats.percentile( 99 )
+                      << " max " << std::setw( 9 ) << stats.ns_per_call.back() << " ns/call" << std::endl;
+         }
+      }
+   }
+}
+
+int main(int argc, char** argv)
+{
+   options_description cli ("chain_bench command line options");
+   try {
+      chain_bench bench;
+      bench.set_program_options(cli);
+      variables_map vmap;
+      bpo::store(bpo::parse_command_line(argc, argv, cli), vmap);
+      bpo::notify(vmap);
+      if (vmap.count("help") > 0) {
+        cli.print(std::cerr);
+        return 0;
+      }
+      // the contract consoles and chain logs would drown the results
+      fc::logger::get(DEFAULT_LOGGER).set_log_level(fc::log_level::off);
+      bench.initialize(vmap);
+      bench.run();
+   } catch( const fc::exception& e ) {
+      elog( "${e}", ("e", e.to_detail_string()));
+      return -1;
+   } catch( const boost::exception& e ) {
+      elog("${e}", ("e",boost::diagnostic_information(e)));
+      return -1;
+   } catch( const std::exception& e ) {
+      elog("${e}", ("e",e.what()));
+      return -1;
+   } catch( ... ) {
+      elog("unknown exception");
+      return -1;
+   }
+
+   return 0;
+}
@@ -16,6 +16,10 @@
 #include <boost/filesystem.hpp>
 #include <boost/filesystem/path.hpp>
 
+#include <fstream>
+#include <set>
+#include <thread>
+
 using namespace eosio::chain;
 namespace bfs = boost::filesystem;
 namespace bpo = boost::program_options;
@@ -27,6 +31,8 @@ struct blocklog {
    {}
 
    void read_log();
+   void make_index();
+   void benchmark_index();
    void set_program_options(options_description& cli);
    void initialize(const variables_map& options);
 
@@ -36,8 +42,69 @@ struct blocklog {
    uint32_t                         last_block;
    bool                             no_pretty_print;
    bool                             as_json_array;
+   bool                             make_index_only;
+   bool                             benchmark_index_only;
+   uint32_t                         index_threads;
 };
 
+/// @return progress callback logging at most every 5 seconds
+static std::function<void(uint64_t, uint64_t)> index_progress() {
+   auto last_report = std::make_shared<fc::time_point>( fc::time_point::now() );
+   return [last_report]( uint64_t done, uint64_t total ) {
+      auto now = fc::time_point::now();
+      if( now - *last_report >= fc::seconds(5) || done == total ) {
+         ilog( "indexed ${d} of ${t} MiB (${p}%)", ("d", done >> 20)("t", total >> 20)("p", total ? done * 100 / total : 100) );
+         *last_report = now;
+      }
+   };
+}
+
+void blocklog::make_index() {
+   const auto block_file = blocks_dir / "blocks.log";
+   const auto index_file = blocks_dir / "blocks.index";
+   EOS_ASSERT( fc::is_regular_file( block_file ), block_log_not_found, "Block log not found in '${d}'", ("d", blocks_dir.generic_string()) );
+
+   ilog( "rebuilding ${i} with ${t} threads", ("i", index_file.generic_string())("t", index_threads) );
+   const auto start = fc::time_point::now();
+   const auto temp_file = blocks_dir / "blocks.index.tmp";
+   const auto blocks = block_log::build_index( block_file, temp_file, index_threads, index_progress() );
+   fc::rename( temp_file, index_file );
+   ilog( "indexed ${n} blocks in ${s} ms", ("n", blocks)("s", (fc::time_point::now() - start).count() / 1000) );
+}
+
+void blocklog::benchmark_index() {
+   const auto block_file = blocks_dir / "blocks.log";
+   EOS_ASSERT( fc::is_regular_file( block_file ), block_log_not_found, "Block log not found in '${d}'", ("d", blocks_dir.generic_string()) );
+   const double mib = double( fc::file_size( block_file ) ) / (1024 * 1024);
+
+   fc::temp_directory tempdir;
+   std::vector<std::string> results;
+   std::set<uint32_t> thread_counts{ 1, index_threads };
+   for( auto threads : thread_counts ) {
+      const auto index_file = tempdir.path() / ("blocks-" + std::to_string( threads ) + ".index");
+      const auto start = fc::time_point::now();
+      const auto blocks = block_log::build_index( block_file, index_file, threads );
+      const double seconds = std::max<int64_t>( (fc::time_point::now() - start).count(), 1 ) / 1000000.0;
+      ilog( "${t} threads: indexed ${n} blocks in ${s} s, ${mbps} MiB/s, ${bps} blocks/s",
+            ("t", threads)("n", blocks)("s", seconds)("mbps", uint64_t( mib / seconds ))("bps", uint64_t( blocks / seconds )) );
+
+      std::ifstream in( index_file.generic_string(), std::ios::binary );
+      results.emplace_back( std::istreambuf_iterator<char>( in ), std::istreambuf_iterator<char>() );
+   }
+   for( const auto& r : results ) {
+      EOS_ASSERT( r == results.front(), block_log_exception, "Indexes built with different thread counts differ" );
+   }
+   const auto existing = blocks_dir / "blocks.index";
+   if( fc::exists( existing ) ) {
+      std::ifstream in( existing.generic_string(), std::ios::binary );
+      std::string index( (std::istreambuf_iterator<char>( in )), std::istreambuf_iterator<char>() );
+      if( index == results.front() )
+         ilog( "built index matches ${i}", ("i", existing.generic_string()) );
+      else
+         wlog( "built index does not match ${i}", ("i", existing.generic_string()) );
+   }
+}
+
 void blocklog::read_log() {
    block_log block_logger(blocks_dir);
    const auto end = block_logger.read_head();
@@ -145,6 +212,13 @@ void blocklog::set_program_options(options_description& cli)
           "Do not pretty print the output.  Useful if piping to jq to improve performance.")
          ("as-json-array", bpo::bool_switch(&as_json_array)->default_value(false),
           "Print out json blocks wrapped in json array (otherwise the output is free-standing json objects).")
+         ("make-index", bpo::bool_switch(&make_index_only)->default_value(false),
+          "Rebuild blocks.index from blocks.log in blocks-dir, then exit.")
+         ("benchmark-index", bpo::bool_switch(&benchmark_index_only)->default_value(false),
+          "Build the index of blocks.log in blocks-dir into a temporary directory with one and with index-threads threads, "
+          "report the throughput of each and check that the results match, then exit.")
+         ("index-threads", bpo::value<uint32_t>(&index_threads)->default_value(std::max(std::thread::hardware_concurrency(), 1u)),
+          "Number of threads used to build the index.")
          ("help", "Print this help message and exit.")
          ;
 
@@ -185,7 +259,12 @@ int main(int argc, char** argv)
         return 0;
       }
       blog.initialize(vmap);
-      blog.read_log();
+      if (blog.make_index_only)
+         blog.make_index();
+      else if (blog.benchmark_index_only)
+         blog.benchmark_index();
+      else
+         blog.read_log();
    } catch( const fc::exception& e ) {
       elog( "${e}", ("e", e.to_detail_string()));
       return -1;
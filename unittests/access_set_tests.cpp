@@ -0,0 +1,110 @@
+/**
+ *  @file
+ *  @copyright defined in eos/LICENSE
+ */
+#include <boost/test/unit_test.hpp>
+
+#include <eosio/chain/access_set.hpp>
+#include <eosio/chain/config.hpp>
+#include <eosio/chain/transaction.hpp>
+
+using namespace eosio;
+using namespace chain;
+
+namespace {
+
+access_set reads_writes( vector<name> reads, vector<name> writes ) {
+   access_set s;
+   for( auto t : reads )
+      s.record_read( N(token), N(alice), t );
+   for( auto t : writes )
+      s.record_write( N(token), N(alice), t );
+   return s;
+}
+
+}
+
+BOOST_AUTO_TEST_SUITE(access_set_tests)
+
+BOOST_AUTO_TEST_CASE(conflicts) {
+   auto r = reads_writes( {N(accounts)}, {} );
+   auto w = reads_writes( {}, {N(accounts)} );
+   auto other = reads_writes( {N(stat)}, {N(other)} );
+
+   BOOST_CHECK( !r.conflicts_with( r ) );
+   BOOST_CHECK( r.conflicts_with( w ) );
+   BOOST_CHECK( w.conflicts_with( r ) );
+   BOOST_CHECK( w.conflicts_with( w ) );
+   BOOST_CHECK( !other.conflicts_with( w ) );
+
+   access_set serial;
+   serial.serial = true;
+   BOOST_CHECK( serial.conflicts_with( access_set() ) );
+   BOOST_CHECK( access_set().conflicts_with( serial ) );
+}
+
+BOOST_AUTO_TEST_CASE(waves) {
+   access_set serial;
+   serial.serial = true;
+
+   vector<access_set> trxs = {
+      reads_writes( {N(a)}, {} ),     // 0
+      reads_writes( {N(a)}, {} ),     // 0, readers do not conflict
+      reads_writes( {}, {N(a)} ),     // 1, after both readers
+      reads_writes( {}, {N(b)} ),     // 0, independent
+      reads_writes( {N(a), N(b)}, {} ), // 2, after the writers of a and b
+      serial,                         // 3, after everything
+      reads_writes( {}, {N(c)} ),     // 4, after the serial transaction
+   };
+   BOOST_REQUIRE( schedule_waves( trxs ) == (vector<uint32_t>{ 0, 0, 1, 0, 2, 3, 4 }) );
+
+   // the schedule only orders conflicting transactions, never reorders them
+   auto waves = schedule_waves( trxs );
+   for( size_t i = 0; i < trxs.size(); ++i ) {
+      for( size_t j = 0; j < i; ++j ) {
+         if( trxs[i].conflicts_with( trxs[j] ) )
+            BOOST_CHECK_LT( waves[j], waves[i] );
+      }
+   }
+}
+
+BOOST_AUTO_TEST_CASE(predict) {
+   auto transfer = []( name from ) {
+      transaction trx;
+      trx.actions.emplace_back( vector<permission_level>{{from, config::active_name}}, N(token), N(transfer), bytes() );
+      return predict_access( trx );
+   };
+
+   BOOST_CHECK( transfer( N(alice) ).conflicts_with( transfer( N(bob) ) ) ); // same contract
+   BOOST_CHECK( transfer( N(alice) ).writes.count( state_key{config::system_account_name, N(alice), N(bandwidth)} ) );
+
+   transaction vote;
+   vote.actions.emplace_back( vector<permission_level>{{N(carol), config::active_name}}, N(voting), N(vote), bytes() );
+   BOOST_CHECK( !transfer( N(alice) ).conflicts_with( predict_access( vote ) ) );
+   BOOST_CHECK( transfer( N(carol) ).conflicts_with( predict_access( vote ) ) ); // same actor
+}
+
+BOOST_AUTO_TEST_CASE(plan) {
+   vector<access_set> trxs = {
+      reads_writes( {}, {N(a)} ),     // group 0
+      reads_writes( {}, {N(b)} ),     // group 1
+      reads_writes( {N(a)}, {} ),     // group 0, reads a
+      reads_writes( {}, {N(c)} ),     // group 3
+      reads_writes( {N(b)}, {N(d)} ), // group 1, joins d to b
+      reads_writes( {N(d)}, {} ),     // group 1 through d
+      reads_writes( {N(e)}, {} ),     // group 6, nothing writes e
+   };
+
+   BOOST_REQUIRE( plan_block( trxs, vector<uint64_t>( trxs.size(), 0 ) ) == (vector<size_t>{ 0, 2, 1, 4, 5, 3, 6 }) );
+
+   // a group goes first when any of its transactions has a higher priority, still in its own order
+   BOOST_REQUIRE( plan_block( trxs, {0, 0, 0, 1, 0, 2, 0} ) == (vector<size_t>{ 1, 4, 5, 3, 0, 2, 6 }) );
+
+   // a serial transaction joins every group
+   access_set serial;
+   serial.serial = true;
+   trxs.push_back( serial );
+   BOOST_REQUIRE( plan_block( trxs, {0, 0, 0, 1, 0, 2, 0, 0} ) == (vector<size_t>{ 0, 1, 2, 3, 4, 5, 6, 7 }) );
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -415,6 +415,9 @@ try {
 
    create_acc(acc2);
 
+   // the usage is written to the database when the block is finalized
+   chain.produce_block();
+
    const auto &usage = db.get<resource_usage_object,by_owner>(acc1);
 
    const auto &usage2 = db.get<resource_usage_object,by_owner>(acc1a);
@@ -423,7 +426,6 @@ try {
    BOOST_TEST(usage.net_usage.average() > 0U);
    BOOST_REQUIRE_EQUAL(usage.cpu_usage.average(), usage2.cpu_usage.average());
    BOOST_REQUIRE_EQUAL(usage.net_usage.average(), usage2.net_usage.average());
-   chain.produce_block();
 
 } FC_LOG_AND_RETHROW() }
 
@@ -519,4 +521,43 @@ BOOST_AUTO_TEST_CASE( linkauth_special ) { try {
 } FC_LOG_AND_RETHROW() }
 
 
+BOOST_AUTO_TEST_CASE( authorization_cache ) { try {
+   TESTER chain;
+
+   chain.create_account("alice");
+
+   const auto first_priv_key = chain.get_private_key("alice", "first");
+   const auto first_pub_key = first_priv_key.get_public_key();
+   const auto second_priv_key = chain.get_private_key("alice", "second");
+   const auto second_pub_key = second_priv_key.get_public_key();
+
+   chain.set_authority("alice", "first", first_pub_key, "active");
+   chain.link_authority("alice", "eosio", "first", "reqauth");
+   chain.produce_block();
+
+   // the second check is answered from the cache
+   chain.push_reqauth("alice", { permission_level{N(alice), "first"} }, { first_priv_key });
+   chain.produce_block();
+   chain.push_reqauth("alice", { permission_level{N(alice), "first"} }, { first_priv_key });
+   chain.produce_block();
+
+   // keys the cached check did not use are still irrelevant
+   BOOST_CHECK_THROW(chain.push_reqauth("alice", { permission_level{N(alice), "first"} }, { first_priv_key, second_priv_key }), tx_irrelevant_sig);
+   chain.produce_block();
+
+   // an update invalidates the cache, and undoing it makes the earlier checks valid again
+   chain.set_authority("alice", "first", second_pub_key, "active");
+   BOOST_CHECK_THROW(chain.push_reqauth("alice", { permission_level{N(alice), "first"} }, { first_priv_key }), unsatisfied_authorization);
+   chain.control->abort_block();
+   chain.push_reqauth("alice", { permission_level{N(alice), "first"} }, { first_priv_key });
+   chain.produce_block();
+   BOOST_CHECK_THROW(chain.push_reqauth("alice", { permission_level{N(alice), "first"} }, { second_priv_key }), unsatisfied_authorization);
+
+   // without the link the action requires active, which "first" does not satisfy
+   chain.unlink_authority("alice", "eosio", "reqauth");
+   chain.produce_block();
+   BOOST_CHECK_THROW(chain.push_reqauth("alice", { permission_level{N(alice), "first"} }, { first_priv_key }), irrelevant_auth_exception);
+
+} FC_LOG_AND_RETHROW() }
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,208 @@
+/**
+ *  @file
+ *  @copyright defined in eos/LICENSE
+ */
+#include <atomic>
+#include <fstream>
+#include <thread>
+
+#include <boost/test/unit_test.hpp>
+
+#include <eosio/chain/block_log.hpp>
+#include <fc/filesystem.hpp>
+
+using namespace eosio;
+using namespace chain;
+
+namespace {
+
+signed_block_ptr make_block( const signed_block_ptr& previous ) {
+   auto b = std::make_shared<signed_block>();
+   if( previous ) {
+      b->previous = previous->id();
+      b->timestamp = previous->timestamp.next();
+   }
+   return b;
+}
+
+}
+
+BOOST_AUTO_TEST_SUITE(block_log_tests)
+
+BOOST_AUTO_TEST_CASE(append_and_reopen) { try {
+   fc::temp_directory tempdir;
+   const auto dir = tempdir.path() / "blocks";
+
+   signed_block_ptr last;
+   {
+      block_log log( dir );
+      last = make_block( nullptr );
+      log.reset( genesis_state(), last );
+      for( uint32_t i = 2; i <= 100; ++i ) {
+         last = make_block( last );
+         log.append( last );
+      }
+      BOOST_REQUIRE_EQUAL( log.head()->block_num(), 100u );
+      BOOST_REQUIRE_EQUAL( log.read_block_by_num( 42 )->block_num(), 42u );
+      BOOST_REQUIRE( !log.read_block_by_num( 101 ) );
+   }
+
+   block_log log( dir );
+   BOOST_REQUIRE( log.head()->id() == last->id() );
+   BOOST_REQUIRE( log.read_head()->id() == last->id() );
+   for( uint32_t i = 1; i <= 100; ++i ) {
+      BOOST_REQUIRE_EQUAL( log.read_block_by_num( i )->block_num(), i );
+   }
+
+   // index is rebuilt when missing
+   fc::remove_all( dir / "blocks.index" );
+   block_log rebuilt( dir );
+   BOOST_REQUIRE( rebuilt.read_block_by_num( 100 )->id() == last->id() );
+   BOOST_REQUIRE_EQUAL( rebuilt.get_block_pos( 7 ), log.get_block_pos( 7 ) );
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_CASE(parallel_index_build) { try {
+   fc::temp_directory tempdir;
+   const auto dir = tempdir.path() / "blocks";
+   {
+      block_log log( dir );
+      auto last = make_block( nullptr );
+      log.reset( genesis_state(), last );
+      for( uint32_t i = 2; i <= 500; ++i ) {
+         last = make_block( last );
+         log.append( last );
+      }
+   }
+
+   auto read_file = []( const fc::path& p ) {
+      std::ifstream in( p.generic_string(), std::ios::binary );
+      return std::string( std::istreambuf_iterator<char>( in ), std::istreambuf_iterator<char>() );
+   };
+   const auto expected = read_file( dir / "blocks.index" );
+
+   for( uint32_t threads : { 1u, 3u, 8u } ) {
+      const auto index_file = tempdir.path() / ("blocks-" + std::to_string( threads ) + ".index");
+      uint64_t last_done = 0, last_total = 1;
+      BOOST_REQUIRE_EQUAL( block_log::build_index( dir / "blocks.log", index_file, threads,
+                                                   [&]( uint64_t done, uint64_t total ) { last_done = done; last_total = total; } ), 500u );
+      BOOST_REQUIRE_EQUAL( last_done, last_total );
+      BOOST_REQUIRE( read_file( index_file ) == expected );
+   }
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_CASE(append_batch) { try {
+   fc::temp_directory tempdir;
+   const auto dir = tempdir.path() / "blocks";
+   block_log_config config;
+   config.stride = 10;
+
+   block_log log( dir, config );
+   auto last = make_block( nullptr );
+   log.reset( genesis_state(), last );
+   vector<signed_block_ptr> batch;
+   for( uint32_t i = 2; i <= 25; ++i ) {
+      last = make_block( last );
+      batch.push_back( last );
+   }
+   BOOST_REQUIRE_EQUAL( log.append( vector<signed_block_ptr>() ), block_log::npos );
+   BOOST_REQUIRE_EQUAL( log.append( batch ), log.get_block_pos( 25 ) );
+   BOOST_REQUIRE( log.head()->id() == last->id() );
+   for( uint32_t i = 1; i <= 25; ++i ) {
+      BOOST_REQUIRE_EQUAL( log.read_block_by_num( i )->block_num(), i );
+   }
+   BOOST_REQUIRE( fc::exists( dir / "blocks-11-20.log" ) );
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_CASE(read_while_appending) { try {
+   fc::temp_directory tempdir;
+   block_log log( tempdir.path() / "blocks" );
+
+   auto last = make_block( nullptr );
+   log.reset( genesis_state(), last );
+
+   const uint32_t num_blocks = 2000;
+   std::atomic<uint32_t> appended{1};
+   std::atomic<bool> failed{false};
+
+   auto reader = [&]() {
+      uint32_t reads = 0;
+      while( appended.load() < num_blocks ) {
+         const uint32_t head = appended.load();
+         const uint32_t num = head - reads++ % head;
+         auto b = log.read_block_by_num( num );
+         if( !b || b->block_num() != num )
+            failed = true;
+      }
+   };
+   std::thread reader1( reader );
+   std::thread reader2( reader );
+
+   for( uint32_t i = 2; i <= num_blocks; ++i ) {
+      last = make_block( last );
+      log.append( last );
+      appended = i;
+   }
+   reader1.join();
+   reader2.join();
+
+   BOOST_REQUIRE( !failed );
+   BOOST_REQUIRE( log.read_head()->id() == last->id() );
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_CASE(split_and_archive) { try {
+   fc::temp_directory tempdir;
+   const auto dir = tempdir.path() / "blocks";
+   block_log_config config;
+   config.stride = 10;
+   config.max_retained_files = 2;
+   config.archive_dir = tempdir.path() / "archive";
+
+   signed_block_ptr last;
+   {
+      block_log log( dir, config );
+      last = make_block( nullptr );
+      log.reset( genesis_state(), last );
+      for( uint32_t i = 2; i <= 45; ++i ) {
+         last = make_block( last );
+         log.append( last );
+      }
+      BOOST_REQUIRE_EQUAL( log.first_block_num(), 41u );
+      BOOST_REQUIRE( !log.read_block_by_num( 10 ) );
+      for( uint32_t i = 21; i <= 45; ++i ) {
+         BOOST_REQUIRE_EQUAL( log.read_block_by_num( i )->block_num(), i );
+      }
+   }
+   BOOST_REQUIRE( fc::exists( dir / "blocks-21-30.log" ) );
+   BOOST_REQUIRE( fc::exists( dir / "blocks-31-40.index" ) );
+   BOOST_REQUIRE( fc::exists( config.archive_dir / "blocks-1-10.log" ) );
+   BOOST_REQUIRE( fc::exists( config.archive_dir / "blocks-11-20.index" ) );
+   BOOST_REQUIRE( !fc::exists( dir / "blocks-11-20.log" ) );
+
+   block_log log( dir, config );
+   BOOST_REQUIRE( log.head()->id() == last->id() );
+   BOOST_REQUIRE_EQUAL( log.read_block_by_num( 25 )->block_num(), 25u );
+   BOOST_REQUIRE( block_log::extract_genesis_state( dir ).compute_chain_id() == genesis_state().compute_chain_id() );
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_CASE(pruned) { try {
+   fc::temp_directory tempdir;
+   const auto dir = tempdir.path() / "blocks";
+   block_log_config config;
+   config.retain_blocks = 10;
+
+   block_log log( dir, config );
+   auto last = make_block( nullptr );
+   log.reset( genesis_state(), last );
+   for( uint32_t i = 2; i <= 45; ++i ) {
+      last = make_block( last );
+      log.append( last );
+   }
+   BOOST_REQUIRE( !log.read_block_by_num( 30 ) );
+   for( uint32_t i = 36; i <= 45; ++i ) {
+      BOOST_REQUIRE_EQUAL( log.read_block_by_num( i )->block_num(), i );
+   }
+   BOOST_REQUIRE( !fc::exists( dir / "blocks-21-30.log" ) );
+   BOOST_REQUIRE( fc::exists( dir / "blocks-31-40.log" ) );
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_SUITE_END()
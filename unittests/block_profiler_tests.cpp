@@ -0,0 +1,102 @@
+/**
+ *  @file
+ *  @copyright defined in eos/LICENSE
+ */
+#include <chrono>
+#include <thread>
+
+#include <boost/test/unit_test.hpp>
+
+#include <eosio/chain/block_profiler.hpp>
+
+using namespace eosio;
+using namespace chain;
+
+namespace {
+
+void spin( uint32_t us ) {
+   std::this_thread::sleep_for( std::chrono::microseconds( us ) );
+}
+
+int64_t phases_sum( const block_profile& p ) {
+   int64_t sum = 0;
+   for( size_t i = 0; i < profile_phase_count; ++i )
+      sum += p.phase_us( static_cast<profile_phase>( i ) );
+   return sum;
+}
+
+}
+
+BOOST_AUTO_TEST_SUITE(block_profiler_tests)
+
+BOOST_AUTO_TEST_CASE(inactive) { try {
+   block_profiler profiler;
+   {
+      block_profiler::scope s( profiler, profile_phase::execution );
+      BOOST_REQUIRE( !profiler.active() );
+   }
+   BOOST_REQUIRE( !profiler.finish_block( block_id_type(), 0 ) );
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_CASE(nested_phases) { try {
+   block_profiler profiler;
+   profiler.start_block( 7, true );
+   {
+      block_profiler::scope deserialization( profiler, profile_phase::deserialization );
+      spin( 1000 );
+   }
+   for( int i = 0; i < 2; ++i ) {
+      block_profiler::scope transaction( profiler, profile_phase::execution );
+      {
+         block_profiler::scope action( profiler, N(eosio.token), N(transfer) );
+         spin( 1000 );
+         {
+            block_profiler::scope instantiation( profiler, profile_phase::wasm_instantiation );
+            spin( 1000 );
+         }
+      }
+      block_profiler::scope action( profiler, N(eosio), N(onblock) );
+   }
+   spin( 1000 );
+
+   auto p = profiler.finish_block( block_id_type(), 2 );
+   BOOST_REQUIRE( p );
+   BOOST_REQUIRE( !profiler.active() );
+   BOOST_REQUIRE_EQUAL( p->block_num, 7u );
+   BOOST_REQUIRE( p->produced );
+   BOOST_REQUIRE_EQUAL( p->transactions, 2u );
+
+   // every instant is charged to exactly one phase
+   BOOST_REQUIRE_EQUAL( phases_sum( *p ), p->total_us );
+   BOOST_REQUIRE_GE( p->deserialization_us, 1000 );
+   BOOST_REQUIRE_GE( p->wasm_instantiation_us, 2000 );
+   BOOST_REQUIRE_GE( p->execution_us, 2000 );
+   BOOST_REQUIRE_GE( p->other_us, 1000 );
+   BOOST_REQUIRE_EQUAL( p->signals_us, 0 );
+
+   BOOST_REQUIRE_EQUAL( p->actions.size(), 2u );
+   BOOST_REQUIRE( p->actions[0].receiver == N(eosio.token) );
+   BOOST_REQUIRE( p->actions[0].action == N(transfer) );
+   BOOST_REQUIRE_EQUAL( p->actions[0].count, 2u );
+   BOOST_REQUIRE_GE( p->actions[0].time_us, 2000 );
+   BOOST_REQUIRE_LT( p->actions[0].time_us, p->execution_us + 1 );
+   BOOST_REQUIRE_EQUAL( p->actions[1].count, 2u );
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_CASE(aborted) { try {
+   block_profiler profiler;
+   profiler.start_block( 1, false );
+   {
+      block_profiler::scope s( profiler, profile_phase::execution );
+      profiler.abort_block();
+   }
+   BOOST_REQUIRE( !profiler.active() );
+
+   profiler.start_block( 2, false );
+   block_profiler::scope s( profiler, profile_phase::signals );
+   auto p = profiler.finish_block( block_id_type(), 0 );
+   BOOST_REQUIRE_EQUAL( p->block_num, 2u );
+   BOOST_REQUIRE( p->actions.empty() );
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_SUITE_END()
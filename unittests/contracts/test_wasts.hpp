@@ -634,6 +634,24 @@ static const char memory_growth_memset_test[] = R"=====(
 )
 )=====";
 
+static const char memory_image_reset_wast[] = R"=====(
+(module
+ (export "apply" (func $apply))
+ (import "env" "eosio_assert" (func $eosio_assert (param i32 i32)))
+ (memory $0 2)
+ (data (i32.const 8) "abcd")
+ (func $apply (param $0 i64)(param $1 i64)(param $2 i64)
+   (call $eosio_assert (i32.eq (i32.load (i32.const 8)) (i32.const 0x64636261)) (i32.const 0))
+   (call $eosio_assert (i32.eq (i32.load (i32.const 70000)) (i32.const 0)) (i32.const 0))
+   (call $eosio_assert (i32.eq (grow_memory (i32.const 1)) (i32.const 2)) (i32.const 0))
+   (call $eosio_assert (i32.eq (i32.load (i32.const 140000)) (i32.const 0)) (i32.const 0))
+   (i32.store (i32.const 8) (i32.const 1))
+   (i32.store (i32.const 70000) (i32.const 2))
+   (i32.store (i32.const 140000) (i32.const 3))
+ )
+)
+)=====";
+
 static const char large_maligned_host_ptr[] = R"=====(
 (module
  (export "apply" (func $$apply))
@@ -646,4 +664,102 @@ static const char large_maligned_host_ptr[] = R"=====(
    ))
  )
 )
-)=====";
\ No newline at end of file
+)=====";
+// activates the feature named by the action data on N(activate), ignores any other action
+static const char activate_feature_wast[] = R"=====(
+(module
+ (import "env" "read_action_data" (func $read_action_data (param i32 i32) (result i32)))
+ (import "env" "activate_feature" (func $activate_feature (param i64)))
+ (table 0 anyfunc)
+ (memory $0 1)
+ (export "apply" (func $apply))
+ (func $apply (param $0 i64) (param $1 i64) (param $2 i64)
+  (if (i64.ne (get_local $2) (i64.const 3617214701412286464)) (then (return)))
+  (drop (call $read_action_data (i32.const 8) (i32.const 8)))
+  (call $activate_feature (i64.load (i32.const 8)))
+ )
+)
+)=====";
+
+// action 0 stores 100 rows, action 1 scans them with db_get_batch_i64, action 2 with db_next_i64 and db_get_i64
+// action 1 prints each row copied as key:value, and | after the rows of each batch; action 2 prints each value
+static const char batch_db_wast[] = R"=====(
+(module
+ (import "env" "prints" (func $prints (param i32)))
+ (import "env" "printui" (func $printui (param i64)))
+ (import "env" "db_store_i64" (func $db_store_i64 (param i64 i64 i64 i64 i32 i32) (result i32)))
+ (import "env" "db_lowerbound_i64" (func $db_lowerbound_i64 (param i64 i64 i64 i64) (result i32)))
+ (import "env" "db_get_i64" (func $db_get_i64 (param i32 i32 i32) (result i32)))
+ (import "env" "db_next_i64" (func $db_next_i64 (param i32 i32) (result i32)))
+ (import "env" "db_get_batch_i64" (func $db_get_batch_i64 (param i32 i32 i32 i32) (result i32)))
+ (import "env" "eosio_assert" (func $eosio_assert (param i32 i32)))
+ (table 0 anyfunc)
+ (memory $0 1)
+ (data (i32.const 512) "wrong number of rows\00")
+ (data (i32.const 544) "wrong row contents\00")
+ (data (i32.const 576) ":\00")
+ (data (i32.const 580) ",\00")
+ (data (i32.const 584) "|\00")
+ (export "apply" (func $apply))
+ (func $apply (param $receiver i64) (param $code i64) (param $action i64)
+  (local $id i64)
+  (local $sum i64)
+  (local $itr i32)
+  (local $rows i32)
+  (local $offset i32)
+  (local $total i32)
+  (if (i64.eq (get_local $action) (i64.const 0)) (then
+   (set_local $id (i64.const 1))
+   (loop $store
+    (i64.store (i32.const 8) (get_local $id))
+    (drop (call $db_store_i64 (get_local $receiver) (get_local $receiver) (get_local $receiver) (get_local $id) (i32.const 8) (i32.const 8)))
+    (set_local $id (i64.add (get_local $id) (i64.const 1)))
+    (br_if $store (i64.le_u (get_local $id) (i64.const 100)))
+   )
+   (return)
+  ))
+  (set_local $itr (call $db_lowerbound_i64 (get_local $receiver) (get_local $receiver) (get_local $receiver) (i64.const 0)))
+  (if (i64.eq (get_local $action) (i64.const 1)) (then
+   (loop $scan
+    (set_local $itr (call $db_get_batch_i64 (get_local $itr) (i32.const 64) (i32.const 400) (i32.const 32)))
+    (set_local $rows (i32.load (i32.const 32)))
+    (set_local $offset (i32.const 64))
+    (block $done
+     (loop $row
+      (br_if $done (i32.eqz (get_local $rows)))
+      (call $eosio_assert (i32.eq (i32.load offset=8 (get_local $offset)) (i32.const 8)) (i32.const 544))
+      (call $eosio_assert (i64.eq (i64.load (get_local $offset)) (i64.load offset=12 (get_local $offset))) (i32.const 544))
+      (set_local $sum (i64.add (get_local $sum) (i64.load offset=12 (get_local $offset))))
+      (call $printui (i64.load (get_local $offset)))
+      (call $prints (i32.const 576))
+      (call $printui (i64.load offset=12 (get_local $offset)))
+      (call $prints (i32.const 580))
+      (set_local $offset (i32.add (get_local $offset) (i32.const 20)))
+      (set_local $total (i32.add (get_local $total) (i32.const 1)))
+      (set_local $rows (i32.sub (get_local $rows) (i32.const 1)))
+      (br $row)
+     )
+    )
+    (call $prints (i32.const 584))
+    (br_if $scan (i32.ne (i32.load (i32.const 32)) (i32.const 0)))
+   )
+  ))
+  (if (i64.eq (get_local $action) (i64.const 2)) (then
+   (block $done
+    (loop $row
+     (br_if $done (i32.lt_s (get_local $itr) (i32.const 0)))
+     (call $eosio_assert (i32.eq (call $db_get_i64 (get_local $itr) (i32.const 64) (i32.const 8)) (i32.const 8)) (i32.const 544))
+     (set_local $sum (i64.add (get_local $sum) (i64.load (i32.const 64))))
+     (call $printui (i64.load (i32.const 64)))
+     (call $prints (i32.const 580))
+     (set_local $total (i32.add (get_local $total) (i32.const 1)))
+     (set_local $itr (call $db_next_i64 (get_local $itr) (i32.const 16)))
+     (br $row)
+    )
+   )
+  ))
+  (call $eosio_assert (i32.eq (get_local $total) (i32.const 100)) (i32.const 512))
+  (call $eosio_assert (i64.eq (get_local $sum) (i64.const 5050)) (i32.const 544))
+ )
+)
+)=====";
@@ -3,6 +3,7 @@
  *  @copyright defined in eos/LICENSE
  */
 #include <eosio/chain/global_property_object.hpp>
+#include <eosio/chain/database_header_object.hpp>
 #include <eosio/testing/tester.hpp>
 
 #include <fc/crypto/digest.hpp>
@@ -99,4 +100,20 @@ BOOST_AUTO_TEST_SUITE(database_tests)
       } FC_LOG_AND_RETHROW()
    }
 
+   // A state database written before the current layout is refused instead of being misread
+   BOOST_AUTO_TEST_CASE(refuse_old_state) {
+      try {
+         tester test;
+         test.produce_blocks(2);
+
+         // outside of the pending block, so the removal is not undone when the controller is closed
+         test.control->abort_block();
+         eosio::chain::database& db = const_cast<eosio::chain::database&>( test.control->db() );
+         db.remove( db.get<database_header_object>() );
+         test.close();
+
+         BOOST_REQUIRE_THROW( test.open( nullptr ), bad_database_version_exception );
+      } FC_LOG_AND_RETHROW()
+   }
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,177 @@
+/**
+ *  @file
+ *  @copyright defined in eos/LICENSE
+ */
+#include <fstream>
+
+#include <boost/filesystem.hpp>
+#include <boost/test/unit_test.hpp>
+
+#include <eosio/chain/fork_database.hpp>
+#include <fc/filesystem.hpp>
+
+using namespace eosio;
+using namespace chain;
+
+namespace {
+
+block_state_ptr make_block_state( const block_state_ptr& previous, uint32_t fork = 0 ) {
+   auto s = std::make_shared<block_state>();
+   if( previous ) {
+      s->header.previous = previous->id;
+      s->header.timestamp = previous->header.timestamp.next();
+   }
+   s->header.confirmed = fork;
+   s->id = s->header.id();
+   s->block_num = s->header.block_num();
+   s->block = std::make_shared<signed_block>( s->header );
+   return s;
+}
+
+/// the branches as fetched by walking both heads back one block at a time
+pair<branch_type, branch_type> naive_branches( const fork_database& fork_db, block_state_ptr first, block_state_ptr second ) {
+   pair<branch_type, branch_type> result;
+   while( first->block_num > second->block_num ) {
+      result.first.push_back( first );
+      first = fork_db.get_block( first->header.previous );
+   }
+   while( second->block_num > first->block_num ) {
+      result.second.push_back( second );
+      second = fork_db.get_block( second->header.previous );
+   }
+   while( first->header.previous != second->header.previous ) {
+      result.first.push_back( first );
+      result.second.push_back( second );
+      first = fork_db.get_block( first->header.previous );
+      second = fork_db.get_block( second->header.previous );
+   }
+   result.first.push_back( first );
+   result.second.push_back( second );
+   return result;
+}
+
+void copy_dir( const fc::path& from, const fc::path& to ) {
+   fc::create_directories( to );
+   for( boost::filesystem::directory_iterator itr( from ), end; itr != end; ++itr ) {
+      boost::filesystem::copy_file( itr->path(), to / itr->path().filename() );
+   }
+}
+
+}
+
+BOOST_AUTO_TEST_SUITE(fork_database_tests)
+
+BOOST_AUTO_TEST_CASE(fetch_branch_from) { try {
+   fc::temp_directory tempdir;
+   fork_database fork_db( tempdir.path() );
+
+   auto root = make_block_state( nullptr );
+   fork_db.set( root );
+
+   // main chain up to 300 with forks starting after 20, 150 and 299
+   vector<block_state_ptr> main{ root };
+   vector<block_state_ptr> heads;
+   for( uint32_t num = 2; num <= 300; ++num ) {
+      main.push_back( fork_db.add( make_block_state( main.back() ), false ) );
+      if( num == 20 || num == 150 || num == 299 ) {
+         auto fork = main.back();
+         for( uint32_t i = 0; i < 30; ++i )
+            fork = fork_db.add( make_block_state( fork, num ), false );
+         heads.push_back( fork );
+      }
+   }
+   heads.push_back( main.back() );
+   heads.push_back( main[200] );
+   heads.push_back( main[20] );
+
+   for( const auto& first : heads ) {
+      for( const auto& second : heads ) {
+         auto expected = naive_branches( fork_db, first, second );
+         auto branches = fork_db.fetch_branch_from( first->id, second->id );
+         BOOST_REQUIRE( branches.first == expected.first );
+         BOOST_REQUIRE( branches.second == expected.second );
+      }
+   }
+
+   auto branch = fork_db.fetch_branch( main.back()->id, 250 );
+   BOOST_REQUIRE_EQUAL( branch.size(), 50u );
+   BOOST_REQUIRE( branch.front() == main.back() );
+   BOOST_REQUIRE( branch.back() == main[250] );
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_CASE(recover_from_journal) { try {
+   fc::temp_directory tempdir;
+   const auto dir = tempdir.path() / "state";
+   const auto crashed_dir = tempdir.path() / "crashed";
+
+   block_state_ptr head, fork_head, removed;
+   {
+      fork_database fork_db( dir );
+      auto root = make_block_state( nullptr );
+      fork_db.set( root );
+      head = root;
+      for( uint32_t num = 2; num <= 20; ++num ) {
+         head = fork_db.add( make_block_state( head ), false );
+         fork_db.mark_in_current_chain( head, true );
+         fork_db.set_validity( head, true );
+      }
+      fork_head = fork_db.add( make_block_state( fork_db.get_block( head->header.previous ), 1 ), false );
+      removed = fork_db.add( make_block_state( fork_head, 1 ), false );
+      fork_db.remove( removed->id );
+
+      // the journal is complete without close(), as after a crash
+      copy_dir( dir, crashed_dir );
+   }
+
+   // append a torn record
+   {
+      std::ofstream out( (crashed_dir / config::forkdb_journal_filename).generic_string(), std::ios::binary | std::ios::app );
+      out.put( 0 );
+      out.put( 100 );
+   }
+
+   fork_database fork_db( crashed_dir );
+   BOOST_REQUIRE( fork_db.head() );
+   BOOST_REQUIRE( fork_db.head()->id == head->id );
+   BOOST_REQUIRE( fork_db.head()->in_current_chain );
+   BOOST_REQUIRE( fork_db.head()->validated );
+   BOOST_REQUIRE( fork_db.get_block( fork_head->id ) );
+   BOOST_REQUIRE( !fork_db.get_block( fork_head->id )->in_current_chain );
+   BOOST_REQUIRE( !fork_db.get_block( removed->id ) );
+   BOOST_REQUIRE_EQUAL( fork_db.get_block_in_current_chain_by_num( 10 )->block_num, 10u );
+
+   auto branches = fork_db.fetch_branch_from( head->id, fork_head->id );
+   BOOST_REQUIRE_EQUAL( branches.first.size(), 1u );
+   BOOST_REQUIRE_EQUAL( branches.second.size(), 1u );
+
+   // the recovered journal is appended to
+   auto next = fork_db.add( make_block_state( fork_db.head() ), false );
+   copy_dir( crashed_dir, tempdir.path() / "crashed_again" );
+   fork_database again( tempdir.path() / "crashed_again" );
+   BOOST_REQUIRE( again.head()->id == next->id );
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_CASE(suspend_journal) { try {
+   fc::temp_directory tempdir;
+   const auto dir = tempdir.path() / "state";
+   const auto journal = dir / config::forkdb_journal_filename;
+
+   fork_database fork_db( dir );
+   auto head = make_block_state( nullptr );
+   fork_db.set( head );
+   const auto size_before = boost::filesystem::file_size( journal.generic_string() );
+
+   fork_db.suspend_journal();
+   for( uint32_t num = 2; num <= 20; ++num )
+      head = fork_db.add( make_block_state( head ), false );
+   BOOST_REQUIRE_EQUAL( boost::filesystem::file_size( journal.generic_string() ), size_before );
+
+   // resuming writes the states added while suspended
+   fork_db.resume_journal();
+   copy_dir( dir, tempdir.path() / "crashed" );
+   fork_database recovered( tempdir.path() / "crashed" );
+   BOOST_REQUIRE( recovered.head()->id == head->id );
+   BOOST_REQUIRE( recovered.get_block( head->header.previous ) );
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -6,6 +6,9 @@
 #include <eosio/chain/authority.hpp>
 #include <eosio/chain/authority_checker.hpp>
 #include <eosio/chain/chain_config.hpp>
+#include <eosio/chain/incremental_merkle.hpp>
+#include <eosio/chain/open_address_map.hpp>
+#include <eosio/chain/sha256_batch.hpp>
 #include <eosio/chain/types.hpp>
 #include <eosio/testing/tester.hpp>
 
@@ -1067,6 +1070,84 @@ BOOST_AUTO_TEST_CASE(reflector_init_test) {
    } FC_LOG_AND_RETHROW()
 }
 
+BOOST_AUTO_TEST_CASE(open_address_map_test) { try {
+   open_address_map m;
+   BOOST_CHECK_EQUAL( m.find( 0 ), open_address_map::npos );
+   m.erase( 0 );
+
+   // table ids are small sequential numbers, object addresses are aligned
+   std::map<uint64_t, int> expected;
+   for( int i = 0; i < 1000; ++i ) {
+      m.insert( i, -(i + 2) );
+      expected[i] = -(i + 2);
+      m.insert( 0x7f0000001000ull + i * 64, i );
+      expected[0x7f0000001000ull + i * 64] = i;
+   }
+   for( int i = 0; i < 1000; i += 3 ) {
+      m.erase( 0x7f0000001000ull + i * 64 );
+      expected.erase( 0x7f0000001000ull + i * 64 );
+   }
+   // reinsert over tombstones
+   for( int i = 0; i < 1000; i += 6 ) {
+      m.insert( 0x7f0000001000ull + i * 64, i + 5000 );
+      expected[0x7f0000001000ull + i * 64] = i + 5000;
+   }
+   BOOST_CHECK_EQUAL( m.size(), expected.size() );
+   for( const auto& e : expected )
+      BOOST_CHECK_EQUAL( m.find( e.first ), e.second );
+   BOOST_CHECK_EQUAL( m.find( 0x7f0000001000ull + 3 * 64 ), open_address_map::npos );
+
+   const auto capacity = m.capacity();
+   m.clear();
+   BOOST_CHECK_EQUAL( m.size(), 0u );
+   BOOST_CHECK_EQUAL( m.capacity(), capacity );
+   BOOST_CHECK_EQUAL( m.find( 5 ), open_address_map::npos );
+   m.insert( 5, 7 );
+   BOOST_CHECK_EQUAL( m.find( 5 ), 7 );
+} FC_LOG_AND_RETHROW() }
+
+
+BOOST_AUTO_TEST_CASE(sha256_backends_test) { try {
+   // the merkle root as computed before sha256_pairs, one pair at a time
+   auto naive_merkle = []( vector<digest_type> ids ) {
+      while( ids.size() > 1 ) {
+         if( ids.size() % 2 )
+            ids.push_back( ids.back() );
+         for( size_t i = 0; i < ids.size() / 2; ++i )
+            ids[i] = digest_type::hash( make_canonical_pair( ids[2 * i], ids[2 * i + 1] ) );
+         ids.resize( ids.size() / 2 );
+      }
+      return ids.empty() ? digest_type() : ids.front();
+   };
+
+   vector<digest_type> ids;
+   for( uint32_t i = 0; i < 37; ++i )
+      ids.push_back( digest_type::hash( i ) );
+
+   const auto best = get_sha256_backend();
+   for( auto backend : { sha256_backend::generic, sha256_backend::avx2, sha256_backend::sha_ni } ) {
+      if( !sha256_backend_supported( backend ) ) {
+         BOOST_CHECK_THROW( set_sha256_backend( backend ), unsupported_feature );
+         continue;
+      }
+      set_sha256_backend( backend );
+
+      vector<digest_type> pairs( ids.begin(), ids.begin() + 34 );
+      sha256_pairs( pairs.data(), 17, pairs.data() );
+      for( size_t i = 0; i < 17; ++i )
+         BOOST_CHECK( pairs[i] == digest_type::hash( std::make_pair( ids[2 * i], ids[2 * i + 1] ) ) );
+
+      incremental_merkle incremental;
+      for( size_t count = 0; count <= ids.size(); ++count ) {
+         vector<digest_type> prefix( ids.begin(), ids.begin() + count );
+         BOOST_CHECK( merkle( prefix ) == naive_merkle( prefix ) );
+         BOOST_CHECK( incremental.get_root() == naive_merkle( prefix ) );
+         if( count < ids.size() )
+            incremental.append( ids[count] );
+      }
+   }
+   set_sha256_backend( best );
+} FC_LOG_AND_RETHROW() }
 
 BOOST_AUTO_TEST_SUITE_END()
 
@@ -310,6 +310,46 @@ BOOST_AUTO_TEST_SUITE(resource_limits_test)
    } FC_LOG_AND_RETHROW();
 
 
+   BOOST_FIXTURE_TEST_CASE(undo_pending_usage, resource_limits_fixture) try {
+      const account_name account(1);
+      initialize_account(account);
+      set_account_limits(account, -1, -1, 1);
+      process_account_limit_updates();
+
+      add_transaction_usage({account}, 1000, 0, 1);
+      const auto used = get_account_cpu_limit_ex(account).used;
+      BOOST_REQUIRE_GT(used, 0);
+
+      {  // usage added in an undone session is rewound
+         auto s = start_session();
+         add_transaction_usage({account}, 1000, 0, 1);
+         BOOST_REQUIRE_GT(get_account_cpu_limit_ex(account).used, used);
+         s.undo();
+      }
+      BOOST_REQUIRE_EQUAL(get_account_cpu_limit_ex(account).used, used);
+
+      {  // and kept in a squashed one
+         auto s = start_session();
+         add_transaction_usage({account}, 1000, 0, 1);
+         s.squash();
+      }
+      const auto squashed_used = get_account_cpu_limit_ex(account).used;
+      BOOST_REQUIRE_GT(squashed_used, used);
+
+      process_block_usage(1);
+      BOOST_REQUIRE_EQUAL(get_account_cpu_limit_ex(account).used, squashed_used);
+
+      {  // undoing a block undoes the usage written at its end
+         auto s = start_session();
+         update_account_usage({account}, 2);
+         add_transaction_usage({account}, 1000, 0, 2);
+         process_block_usage(2);
+         BOOST_REQUIRE_NE(get_account_cpu_limit_ex(account).used, squashed_used);
+         s.undo();
+      }
+      BOOST_REQUIRE_EQUAL(get_account_cpu_limit_ex(account).used, squashed_used);
+   } FC_LOG_AND_RETHROW();
+
    BOOST_FIXTURE_TEST_CASE(sanity_check, resource_limits_fixture) try {
       double total_staked_tokens = 1'000'000'000'0000.;
       double user_stake = 1'0000.;
@@ -0,0 +1,102 @@
+/**
+ *  @file
+ *  @copyright defined in eos/LICENSE
+ */
+#include <fstream>
+
+#include <boost/filesystem.hpp>
+#include <boost/test/unit_test.hpp>
+
+#include <eosio/chain/wasm_code_cache.hpp>
+#include <fc/filesystem.hpp>
+
+using namespace eosio;
+using namespace chain;
+
+BOOST_AUTO_TEST_SUITE(wasm_code_cache_tests)
+
+BOOST_AUTO_TEST_CASE(store_and_load) { try {
+   fc::temp_directory tempdir;
+   const auto dir = tempdir.path() / "code_cache";
+   const std::vector<uint8_t> code = { 0, 'a', 's', 'm', 1, 0, 0, 0 };
+   const std::vector<uint8_t> initial_memory( 100, 7 );
+   const auto code_id = fc::sha256::hash( "code" );
+   const auto other_id = fc::sha256::hash( "other" );
+
+   {
+      wasm_code_cache cache( dir, wasm_interface::vm_type::wavm );
+      BOOST_REQUIRE( !cache.load( code_id ) );
+      cache.store( code_id, code, initial_memory, fc::microseconds( 1234 ) );
+      cache.write_hot_list( { code_id, other_id } );
+   }
+
+   wasm_code_cache cache( dir, wasm_interface::vm_type::wavm );
+   auto e = cache.load( code_id );
+   BOOST_REQUIRE( e );
+   BOOST_REQUIRE( std::vector<uint8_t>( e->code, e->code + e->code_size ) == code );
+   BOOST_REQUIRE( e->initial_memory == initial_memory );
+   BOOST_REQUIRE_EQUAL( e->prepare_time.count(), 1234 );
+   BOOST_REQUIRE( cache.read_hot_list() == vector<digest_type>({ code_id, other_id }) );
+
+   // entries prepared for another runtime are discarded
+   wasm_code_cache wabt_cache( dir, wasm_interface::vm_type::wabt );
+   BOOST_REQUIRE( !wabt_cache.load( code_id ) );
+   BOOST_REQUIRE( !cache.load( code_id ) );
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_CASE(corrupted) { try {
+   fc::temp_directory tempdir;
+   const auto dir = tempdir.path() / "code_cache";
+   const auto code_id = fc::sha256::hash( "code" );
+   const auto file = dir / (code_id.str() + ".wasm");
+
+   wasm_code_cache cache( dir, wasm_interface::vm_type::wavm );
+   cache.store( code_id, std::vector<uint8_t>( 64, 1 ), std::vector<uint8_t>( 64, 2 ) );
+   {
+      std::fstream f( file.generic_string(), std::ios::in | std::ios::out | std::ios::binary );
+      f.seekp( -1, std::ios::end );
+      f.put( 3 );
+   }
+   BOOST_REQUIRE( !cache.load( code_id ) );
+   BOOST_REQUIRE( !fc::exists( file ) );
+
+   cache.store( code_id, std::vector<uint8_t>( 64, 1 ), std::vector<uint8_t>() );
+   boost::filesystem::resize_file( file, 16 );
+   BOOST_REQUIRE( !cache.load( code_id ) );
+   BOOST_REQUIRE( !fc::exists( file ) );
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_CASE(eviction) { try {
+   fc::temp_directory tempdir;
+   const auto dir = tempdir.path() / "code_cache";
+   const std::vector<uint8_t> code( 1000, 1 );
+   const auto a = fc::sha256::hash( "a" );
+   const auto b = fc::sha256::hash( "b" );
+   const auto c = fc::sha256::hash( "c" );
+
+   {
+      wasm_code_cache cache( dir, wasm_interface::vm_type::wavm, 2500 );
+      cache.store( a, code, {} );
+      cache.store( b, code, {} );
+      BOOST_REQUIRE( cache.load( a ) );
+      // b is the least recently used
+      cache.store( c, code, {} );
+      BOOST_REQUIRE( cache.size() <= 2500 );
+      BOOST_REQUIRE( !cache.load( b ) );
+      BOOST_REQUIRE( cache.load( a ) );
+      BOOST_REQUIRE( cache.load( c ) );
+   }
+
+   // the entries left are counted again, and trimmed to a smaller size
+   wasm_code_cache cache( dir, wasm_interface::vm_type::wavm, 1500 );
+   BOOST_REQUIRE( cache.size() <= 1500 );
+   BOOST_REQUIRE( cache.size() > 0 );
+   BOOST_REQUIRE( fc::exists( dir / (a.str() + ".wasm") ) != fc::exists( dir / (c.str() + ".wasm") ) );
+
+   // the hot list is replaced as a whole
+   cache.write_hot_list( { a, b } );
+   BOOST_REQUIRE( cache.read_hot_list() == vector<digest_type>({ a, b }) );
+   BOOST_REQUIRE( !fc::exists( dir / "hot.list.tmp" ) );
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -1494,6 +1494,96 @@ BOOST_FIXTURE_TEST_CASE( protect_injected, TESTER ) try {
    produce_blocks(1);
 } FC_LOG_AND_RETHROW()
 
+// a chain whose feature activation hard fork is at block_num
+static controller::config feature_activation_config( const fc::path& p, uint32_t block_num ) {
+   controller::config cfg;
+   cfg.blocks_dir = p / config::default_blocks_dir_name;
+   cfg.state_dir  = p / config::default_state_dir_name;
+   cfg.state_size = 1024*1024*8;
+   cfg.state_guard_size = 0;
+   cfg.reversible_cache_size = 1024*1024*8;
+   cfg.reversible_guard_size = 0;
+   cfg.contracts_console = true;
+   cfg.feature_activation_block_num = block_num;
+
+   cfg.genesis.initial_timestamp = fc::time_point::from_iso_string("2020-01-01T00:00:00.000");
+   cfg.genesis.initial_key = base_tester::get_public_key( config::system_account_name, "active" );
+
+   for(int i = 0; i < boost::unit_test::framework::master_test_suite().argc; ++i) {
+      if(boost::unit_test::framework::master_test_suite().argv[i] == std::string("--wavm"))
+         cfg.wasm_runtime = chain::wasm_interface::vm_type::wavm;
+      else if(boost::unit_test::framework::master_test_suite().argv[i] == std::string("--wabt"))
+         cfg.wasm_runtime = chain::wasm_interface::vm_type::wabt;
+   }
+
+   return cfg;
+}
+
+BOOST_AUTO_TEST_CASE( batch_db_iteration ) try {
+   const uint32_t hard_fork = 20;
+   fc::temp_directory tempdir;
+   TESTER chain( feature_activation_config( tempdir.path(), hard_fork ) );
+   chain.produce_blocks(2);
+
+   chain.create_accounts( {N(scanner)} );
+   chain.produce_block();
+
+   // the intrinsic can not be imported before activation, even if it is never called
+   BOOST_CHECK_THROW(chain.set_code(N(scanner), batch_db_wast), unsupported_feature);
+   chain.set_code(config::system_account_name, activate_feature_wast);
+   chain.produce_blocks(1);
+
+   auto push = [&]( account_name account, action_name name, bytes data ) {
+      signed_transaction trx;
+      action act;
+      act.account = account;
+      act.name = name;
+      act.authorization = vector<permission_level>{{account,config::active_name}};
+      act.data = std::move(data);
+      trx.actions.push_back(act);
+
+      chain.set_transaction_headers(trx);
+      trx.sign(chain.get_private_key( account, "active" ), chain.control->get_chain_id());
+      auto trace = chain.push_transaction(trx);
+      chain.produce_block();
+      return trace;
+   };
+
+   // before the hard fork features can not be activated, as in earlier releases
+   BOOST_REQUIRE_LT(chain.control->head_block_num() + 1, hard_fork);
+   BOOST_CHECK_THROW(push(config::system_account_name, N(activate), fc::raw::pack(config::batch_db_iteration_feature)), unsupported_feature);
+   while( chain.control->head_block_num() + 1 < hard_fork )
+      chain.produce_block();
+
+   push(config::system_account_name, N(activate), fc::raw::pack(config::batch_db_iteration_feature));
+   BOOST_CHECK_THROW(push(config::system_account_name, N(activate), fc::raw::pack(config::batch_db_iteration_feature)), feature_already_activated);
+   BOOST_CHECK_THROW(push(config::system_account_name, N(activate), fc::raw::pack(N(unknown))), unsupported_feature);
+
+   // usable once the block activating it is irreversible
+   BOOST_REQUIRE(!chain.control->is_feature_active(config::batch_db_iteration_feature));
+   for( int i = 0; i < 12 && !chain.control->is_feature_active(config::batch_db_iteration_feature); ++i )
+      chain.produce_block();
+   BOOST_REQUIRE(chain.control->is_feature_active(config::batch_db_iteration_feature));
+
+   chain.set_code(N(scanner), batch_db_wast);
+   chain.produce_blocks(1);
+
+   push(N(scanner), 0, bytes());
+   auto batch_trace = push(N(scanner), 1, bytes());
+   auto row_trace = push(N(scanner), 2, bytes());
+
+   string batch_rows, rows;
+   for( uint64_t key = 1; key <= 100; ++key ) {
+      batch_rows += std::to_string(key) + ":" + std::to_string(key) + ",";
+      rows += std::to_string(key) + ",";
+      if( key % 20 == 0 ) // 20 rows of a 12 byte header and an 8 byte value fill the 400 byte buffer
+         batch_rows += "|";
+   }
+   batch_rows += "|"; // the end iterator returned with the last rows copies no more
+   BOOST_CHECK_EQUAL(batch_trace->action_traces.at(0).console, batch_rows);
+   BOOST_CHECK_EQUAL(row_trace->action_traces.at(0).console, rows);
+} FC_LOG_AND_RETHROW()
+
 BOOST_FIXTURE_TEST_CASE( mem_growth_memset, TESTER ) try {
    produce_blocks(2);
 
@@ -1525,6 +1615,32 @@ BOOST_FIXTURE_TEST_CASE( mem_growth_memset, TESTER ) try {
    }
 } FC_LOG_AND_RETHROW()
 
+// Make sure the initial memory is restored between actions, also when another contract ran in between
+BOOST_FIXTURE_TEST_CASE( memory_image_reset, TESTER ) try {
+   produce_blocks(2);
+   create_accounts( {N(imagereset), N(grower)} );
+   produce_block();
+
+   set_code(N(imagereset), memory_image_reset_wast);
+   set_code(N(grower), memory_growth_memset_store);
+   produce_blocks(1);
+
+   signed_transaction trx;
+   for( auto account : {N(imagereset), N(imagereset), N(grower), N(imagereset)} ) {
+      action act;
+      act.account = account;
+      act.name = N();
+      act.authorization = vector<permission_level>{{account,config::active_name}};
+      trx.actions.push_back(act);
+   }
+   set_transaction_headers(trx);
+   trx.sign(get_private_key( N(imagereset), "active" ), control->get_chain_id());
+   trx.sign(get_private_key( N(grower), "active" ), control->get_chain_id());
+   push_transaction(trx);
+   produce_blocks(1);
+   BOOST_REQUIRE_EQUAL(true, chain_has_transaction(trx.id()));
+} FC_LOG_AND_RETHROW()
+
 INCBIN(fuzz1, "fuzz1.wasm");
 INCBIN(fuzz2, "fuzz2.wasm");
 INCBIN(fuzz3, "fuzz3.wasm");